@@ -0,0 +1,398 @@
+/*
+	ofxNDI benchmark
+
+	Throughput of the ofxNDIutils image and audio functions
+	without Openframeworks or the NDI library.
+
+	Each function is timed for every resolution, instruction set,
+	thread count and buffer alignment. Results are written as JSON
+	for comparison between releases. See readme.md for build options.
+
+	Copyright (C) 2016-2024 Lynn Jarvis.
+
+	http://www.spout.zeal.co
+
+	=========================================================================
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+	=========================================================================
+
+	15.10.26 - Create file
+			 - Verify kernels before timing, --verify option
+	16.10.26 - Add audio conversions for 2 and 16 channels
+
+*/
+#include "ofxNDIutils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <thread>
+
+using namespace ofxNDIutils;
+
+// Buffer alignment for the aligned case
+static const size_t Alignment = 64;
+// Offset from the alignment for the unaligned case (one rgba pixel)
+static const size_t Misalignment = 4;
+
+struct Resolution {
+	const char* name;
+	unsigned int width;
+	unsigned int height;
+};
+
+static const Resolution Resolutions[] = {
+	{ "720p",  1280,  720 },
+	{ "1080p", 1920, 1080 },
+	{ "4K",    3840, 2160 },
+	{ "8K",    7680, 4320 }
+};
+
+// Audio is timed for one second at 48kHz in frames of 1600 samples (30fps)
+// Recorded with the samples as width and the channels as height
+static const Resolution AudioLayouts[] = {
+	{ "audio_2ch",  48000,  2 },
+	{ "audio_16ch", 48000, 16 }
+};
+static const int AudioFrameSamples = 1600;
+
+// Memory with a fixed offset from 64 byte alignment
+class Buffer {
+public:
+	Buffer(size_t size, size_t offset) {
+		m_memory.resize(size + Alignment + offset);
+		uintptr_t p = reinterpret_cast<uintptr_t>(m_memory.data());
+		p = (p + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+		m_data = reinterpret_cast<unsigned char*>(p) + offset;
+		// Mid grey with some variation for the YUV conversions
+		for (size_t i = 0; i < size; i++)
+			m_data[i] = (unsigned char)(64 + (i * 7) % 128);
+	}
+	unsigned char* data() { return m_data; }
+	uint16_t* data16() { return reinterpret_cast<uint16_t*>(m_data); }
+	float* dataf() { return reinterpret_cast<float*>(m_data); }
+private:
+	std::vector<unsigned char> m_memory;
+	unsigned char* m_data = nullptr;
+};
+
+// One timed function
+// bytes - bytes read plus bytes written for each frame
+struct Operation {
+	std::string name;
+	double bytes;
+	std::function<void()> run;
+};
+
+struct Options {
+	int iterations = 20;
+	std::vector<std::string> sizes;
+	std::vector<unsigned int> threads;
+	std::string outfile;
+	bool bVerifyOnly = false;
+};
+
+static std::vector<std::string> SplitList(const char* arg)
+{
+	std::vector<std::string> list;
+	std::string item;
+	for (const char* p = arg; ; p++) {
+		if (*p == ',' || *p == 0) {
+			if (!item.empty())
+				list.push_back(item);
+			item.clear();
+			if (*p == 0)
+				break;
+		}
+		else {
+			item += *p;
+		}
+	}
+	return list;
+}
+
+static bool ParseOptions(int argc, char* argv[], Options& options)
+{
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool bValue = (i + 1 < argc);
+		if (arg == "--iterations" && bValue) {
+			options.iterations = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--sizes" && bValue) {
+			options.sizes = SplitList(argv[++i]);
+		}
+		else if (arg == "--threads" && bValue) {
+			for (const std::string& s : SplitList(argv[++i]))
+				options.threads.push_back((unsigned int)atoi(s.c_str()));
+		}
+		else if (arg == "--out" && bValue) {
+			options.outfile = argv[++i];
+		}
+		else if (arg == "--verify") {
+			options.bVerifyOnly = true;
+		}
+		else {
+			fprintf(stderr, "ofxNDIbenchmark [--iterations n] [--sizes 720p,1080p,4K,8K,audio_2ch,audio_16ch] [--threads 1,4] [--out file.json] [--verify]\n");
+			return false;
+		}
+	}
+	if (options.sizes.empty()) {
+		for (const Resolution& r : Resolutions)
+			options.sizes.push_back(r.name);
+		for (const Resolution& r : AudioLayouts)
+			options.sizes.push_back(r.name);
+	}
+	if (options.threads.empty()) {
+		options.threads.push_back(1);
+		const unsigned int hardware = std::thread::hardware_concurrency();
+		if (hardware > 1)
+			options.threads.push_back(std::min(hardware, 4u));
+	}
+	return true;
+}
+
+// Median milliseconds per frame after one warm up
+static double TimeOperation(const Operation& op, int iterations)
+{
+	std::vector<double> times;
+	op.run();
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		op.run();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+// Functions timed for one resolution and alignment
+static std::vector<Operation> MakeOperations(unsigned int width, unsigned int height, size_t offset,
+	std::vector<Buffer*>& buffers)
+{
+	const size_t rgbaSize = (size_t)width * height * 4;
+	const unsigned int pitch = width * 4 + 256; // padded source lines
+	Buffer* src = new Buffer((size_t)pitch * height, offset);
+	Buffer* dst = new Buffer((size_t)pitch * height, offset);
+	// UYVY, NV12 and I420 source and alpha plane
+	Buffer* yuv = new Buffer((size_t)width * height * 2, offset);
+	Buffer* alpha = new Buffer((size_t)width * height, offset);
+	// 16 bit rgba and P216 planes
+	Buffer* rgba16 = new Buffer(rgbaSize * 2, offset);
+	Buffer* p216 = new Buffer((size_t)width * height * 4, offset);
+	buffers.insert(buffers.end(), { src, dst, yuv, alpha, rgba16, p216 });
+
+	unsigned char* s = src->data();
+	unsigned char* d = dst->data();
+	unsigned char* y = yuv->data();
+	unsigned char* a = alpha->data();
+	uint16_t* r16 = rgba16->data16();
+	uint16_t* py = p216->data16();
+	uint16_t* puv = py + (size_t)width * height;
+	const size_t yuvSize = (size_t)width * height * 2;
+	const size_t nv12Size = (size_t)width * height * 3 / 2;
+
+	std::vector<Operation> ops = {
+		{ "copy_buffer", 2.0 * rgbaSize, [=]() { CopyBuffer(d, s, rgbaSize); } },
+		{ "copy", 2.0 * rgbaSize, [=]() { CopyImage(s, d, width, height, width * 4, width * 4, false, false); } },
+		{ "copy_pitched", 2.0 * rgbaSize, [=]() { CopyImage(s, d, width, height, pitch, width * 4, false, false); } },
+		{ "copy_invert", 2.0 * rgbaSize, [=]() { CopyImage(s, d, width, height, width * 4, width * 4, false, true); } },
+		{ "swap_rb", 2.0 * rgbaSize, [=]() { CopyImage(s, d, width, height, width * 4, width * 4, true, false); } },
+		{ "swap_rb_invert", 2.0 * rgbaSize, [=]() { CopyImage(s, d, width, height, width * 4, width * 4, true, true); } },
+		{ "flip_in_place", 2.0 * rgbaSize, [=]() { FlipVertical(d, width * 4, height); } },
+		{ "yuv422_to_rgba", (double)yuvSize + rgbaSize, [=]() { YUV422_to_RGBA(y, d, width, height, width * 2); } },
+		{ "rgba_to_yuv422", (double)rgbaSize + yuvSize, [=]() { RGBA_to_YUV422(s, y, nullptr, width, height, width * 4); } },
+		{ "rgba_to_yuva", (double)rgbaSize + yuvSize + (double)width * height, [=]() { RGBA_to_YUV422(s, y, a, width, height, width * 4); } },
+		{ "nv12_to_rgba", (double)nv12Size + rgbaSize, [=]() {
+			NV12_to_RGBA(y, y + (size_t)width * height, d, width, height, width, width); } },
+		{ "i420_to_rgba", (double)nv12Size + rgbaSize, [=]() {
+			const unsigned char* u = y + (size_t)width * height;
+			I420_to_RGBA(y, u, u + (size_t)(width / 2) * (height / 2), d, width, height, width, width / 2); } },
+		{ "rgba16_to_p216", 2.0 * rgbaSize + 2.0 * yuvSize, [=]() {
+			RGBA16_to_P216(r16, py, puv, nullptr, width, height, width * 8, width * 2); } },
+		{ "p216_to_rgba16", 2.0 * yuvSize + 2.0 * rgbaSize, [=]() {
+			P216_to_RGBA16(py, puv, nullptr, r16, width, height, width * 2, width * 8); } },
+		{ "scale_half", (double)rgbaSize * 1.25, [=]() { ScaleImage(s, d, width, height, width * 4, width / 2, height / 2); } },
+		{ "scale_quarter", (double)rgbaSize * (1.0 + 1.0 / 16.0), [=]() { ScaleImage(s, d, width, height, width * 4, width / 4, height / 4); } },
+		{ "yuv422_scale_quarter", (double)yuvSize + rgbaSize / 16.0, [=]() {
+			ScaleYUV422_to_RGBA(y, d, width, height, width * 2, width / 4, height / 4); } }
+	};
+	return ops;
+}
+
+// Audio conversions of one second for one channel count and alignment
+// Float source samples are -1 to 1
+static std::vector<Operation> MakeAudioOperations(unsigned int samples, unsigned int channels, size_t offset,
+	std::vector<Buffer*>& buffers)
+{
+	const size_t count = (size_t)samples * channels;
+	Buffer* src = new Buffer(count * 4, offset);
+	Buffer* dst = new Buffer(count * 4, offset);
+	buffers.insert(buffers.end(), { src, dst });
+	float* f = src->dataf();
+	for (size_t i = 0; i < count; i++)
+		f[i] = (float)((int)(i % 2001) - 1000) / 1000.0f;
+
+	const unsigned char* s = src->data();
+	unsigned char* d = dst->data();
+	const int n = AudioFrameSamples;
+	const int nc = (int)channels;
+	const int frames = (int)samples / n;
+	// Frames follow each other in the buffers, as for a stream
+	auto convert = [=](AudioFormat from, bool bFromInterleaved, AudioFormat to, bool bToInterleaved, float gain, bool bDither) {
+		const size_t fromFrame = (size_t)n * nc * (from == AUDIO_INT16 ? 2 : 4);
+		const size_t toFrame = (size_t)n * nc * (to == AUDIO_INT16 ? 2 : 4);
+		for (int i = 0; i < frames; i++)
+			ConvertAudio(s + fromFrame * i, from, bFromInterleaved, 0, d + toFrame * i, to, bToInterleaved, 0, n, nc, gain, bDither);
+	};
+	const double fbytes = (double)count * 4;
+	const double sbytes = (double)count * 2;
+
+	std::vector<Operation> ops = {
+		{ "audio_interleave", 2.0 * fbytes, [=]() { convert(AUDIO_FLOAT, false, AUDIO_FLOAT, true, 1.0f, false); } },
+		{ "audio_deinterleave", 2.0 * fbytes, [=]() { convert(AUDIO_FLOAT, true, AUDIO_FLOAT, false, 1.0f, false); } },
+		{ "audio_to_int16", fbytes + sbytes, [=]() { convert(AUDIO_FLOAT, false, AUDIO_INT16, true, 1.0f, false); } },
+		{ "audio_to_int16_dither", fbytes + sbytes, [=]() { convert(AUDIO_FLOAT, false, AUDIO_INT16, true, 1.0f, true); } },
+		{ "audio_to_int32", 2.0 * fbytes, [=]() { convert(AUDIO_FLOAT, false, AUDIO_INT32, true, 1.0f, false); } },
+		{ "audio_from_int16", sbytes + fbytes, [=]() { convert(AUDIO_INT16, true, AUDIO_FLOAT, false, 1.0f, false); } },
+		{ "audio_from_int32", 2.0 * fbytes, [=]() { convert(AUDIO_INT32, true, AUDIO_FLOAT, false, 1.0f, false); } },
+		{ "audio_gain", 2.0 * fbytes, [=]() { AudioGain((float*)d, count, 0.5f); } }
+	};
+	return ops;
+}
+
+static void WriteResult(std::string& json, bool& bFirst, const std::string& op, const Resolution& res,
+	SimdLevel level, unsigned int threads, bool bAligned, double ms, double bytes)
+{
+	char line[512];
+	snprintf(line, sizeof(line),
+		"%s    { \"op\": \"%s\", \"size\": \"%s\", \"width\": %u, \"height\": %u, \"simd\": \"%s\", "
+		"\"threads\": %u, \"aligned\": %s, \"ms\": %.4f, \"gbps\": %.3f }",
+		bFirst ? "" : ",\n", op.c_str(), res.name, res.width, res.height, GetSimdName(level).c_str(),
+		threads, bAligned ? "true" : "false", ms, ms > 0.0 ? bytes / (ms * 1.0e6) : 0.0);
+	json += line;
+	bFirst = false;
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+		return 1;
+
+	// Compare every instruction set with the C++ functions
+	// before timing, or only that with --verify
+	if (options.bVerifyOnly)
+		return VerifyKernels(true) ? 0 : 1;
+	const bool bVerified = VerifyKernels();
+	if (!bVerified)
+		fprintf(stderr, "ofxNDIbenchmark : kernel verification failed, run with --verify for details\n");
+
+	// All levels supported by this CPU
+	std::vector<SimdLevel> levels;
+	const SimdLevel cpuLevel = GetCpuSimdLevel();
+	for (int i = SIMD_NONE; i <= SIMD_NEON; i++) {
+		SetSimdLevel((SimdLevel)i);
+		if (GetSimdLevel() == (SimdLevel)i)
+			levels.push_back((SimdLevel)i);
+	}
+
+	std::string json = "{\n";
+	json += "  \"version\": \"" + GetVersion() + "\",\n";
+	json += "  \"cpu_simd\": \"" + GetSimdName(cpuLevel) + "\",\n";
+	json += "  \"cache_bytes\": " + std::to_string(GetCacheSize()) + ",\n";
+	json += "  \"hardware_threads\": " + std::to_string(std::thread::hardware_concurrency()) + ",\n";
+	json += "  \"iterations\": " + std::to_string(options.iterations) + ",\n";
+	json += std::string("  \"verified\": ") + (bVerified ? "true" : "false") + ",\n";
+	json += "  \"results\": [\n";
+	bool bFirst = true;
+
+	// Thread every size so that the thread counts compare at 720p
+	const unsigned int threadMinimum = GetThreadMinimum();
+	SetThreadMinimum(0);
+
+	for (const Resolution& res : Resolutions) {
+		if (std::find(options.sizes.begin(), options.sizes.end(), res.name) == options.sizes.end())
+			continue;
+		for (int aligned = 1; aligned >= 0; aligned--) {
+			std::vector<Buffer*> buffers;
+			const std::vector<Operation> ops = MakeOperations(res.width, res.height,
+				aligned ? 0 : Misalignment, buffers);
+			for (SimdLevel level : levels) {
+				SetSimdLevel(level);
+				for (unsigned int threads : options.threads) {
+					SetThreadCount(threads);
+					for (const Operation& op : ops) {
+						const double ms = TimeOperation(op, options.iterations);
+						WriteResult(json, bFirst, op.name, res, level, GetThreadCount(), aligned != 0, ms, op.bytes);
+						fprintf(stderr, "%-22s %-6s %-8s %u thread%s %-9s %8.3f ms\n",
+							op.name.c_str(), res.name, GetSimdName(level).c_str(), GetThreadCount(),
+							GetThreadCount() > 1 ? "s" : " ", aligned ? "aligned" : "unaligned", ms);
+					}
+				}
+			}
+			for (Buffer* b : buffers)
+				delete b;
+		}
+	}
+
+	// Audio is not divided between threads
+	SetThreadCount(1);
+	for (const Resolution& res : AudioLayouts) {
+		if (std::find(options.sizes.begin(), options.sizes.end(), res.name) == options.sizes.end())
+			continue;
+		for (int aligned = 1; aligned >= 0; aligned--) {
+			std::vector<Buffer*> buffers;
+			const std::vector<Operation> ops = MakeAudioOperations(res.width, res.height,
+				aligned ? 0 : Misalignment, buffers);
+			for (SimdLevel level : levels) {
+				SetSimdLevel(level);
+				for (const Operation& op : ops) {
+					const double ms = TimeOperation(op, options.iterations);
+					WriteResult(json, bFirst, op.name, res, level, 1, aligned != 0, ms, op.bytes);
+					fprintf(stderr, "%-22s %-10s %-8s %-9s %8.3f ms\n",
+						op.name.c_str(), res.name, GetSimdName(level).c_str(), aligned ? "aligned" : "unaligned", ms);
+				}
+			}
+			for (Buffer* b : buffers)
+				delete b;
+		}
+	}
+	json += "\n  ]\n}\n";
+
+	// Restore defaults
+	SetSimdLevel(cpuLevel);
+	SetThreadCount();
+	SetThreadMinimum(threadMinimum);
+
+	if (options.outfile.empty()) {
+		fputs(json.c_str(), stdout);
+	}
+	else {
+		FILE* file = fopen(options.outfile.c_str(), "w");
+		if (!file) {
+			fprintf(stderr, "ofxNDIbenchmark : could not open %s\n", options.outfile.c_str());
+			return 1;
+		}
+		fputs(json.c_str(), file);
+		fclose(file);
+	}
+	return 0;
+}
@@ -5,7 +5,7 @@ attribute vec4 position;
 attribute vec2 texcoord;
 
 // Coords for the fragment shader
-vec2 texCoord;
+varying vec2 texCoord;
 
 void main()
 {
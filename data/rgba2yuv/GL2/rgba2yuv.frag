@@ -9,6 +9,9 @@
 
 uniform sampler2DRect tex;     // fbo texture to draw to
 uniform sampler2DRect rgbatex; // rgba source texture
+uniform vec4 ycoeffs; // RGB to Y (r, g, b, offset)
+uniform vec4 ucoeffs; // RGB to U
+uniform vec4 vcoeffs; // RGB to V
 
 void main()
 {
@@ -16,35 +19,32 @@ void main()
 	vec2 currentPosition = gl_TexCoord[0].xy;
 	
 	// Get the pixel color from the rgba texture
-	// U and V from the first of every second pixel
 	// Y0 and Y1 luminance from each of the pair
-	vec4 rgba0 = texture2DRect(rgbatex, vec2(currentPosition.x*2, currentPosition.y));
-	vec4 rgba1 = texture2DRect(rgbatex, vec2(currentPosition.x*2+1, currentPosition.y));
+	// U and V from the average of the pair
+	// Centres of pixels 2x and 2x+1
+	float x = floor(currentPosition.x)*2.0 + 0.5;
+	vec4 rgba0 = texture2DRect(rgbatex, vec2(x, currentPosition.y));
+	vec4 rgba1 = texture2DRect(rgbatex, vec2(x + 1.0, currentPosition.y));
 	
 	// Calculate Y0 Y1 U V
-	// NDI uses Rec.719 for 720p and 1920p
+	// Coefficients for the sender colour matrix and range
+	// from ofxNDIutils::GetRGBtoYUVshaderCoefficients,
+	// the same as for CPU conversion.
+	//   Y = dot(ycoeffs.rgb, rgb) + ycoeffs.w
+	// U and V from the average of the pair.
 	//
-	// BT.709
-	// https://gist.github.com/yohhoy/dafa5a47dade85d8b40625261af3776a
+	// BT.709 limited range for example
 	// https://www.itu.int/rec/R-REC-BT.709
 	// Y  = 0.2126*R + 0.7152*G + 0.0722*B
 	// Cb = (B-Y) / 1.8556
 	// Cr = (R-Y) / 1.5748
+	// Y 16-235, U and V 16-240
 	//
-	float y0 =  0.2126*rgba0.r + 0.7152*rgba0.g + 0.0722*rgba0.b;
-	float y1 =  0.2226*rgba1.r + 0.7152*rgba1.g + 0.0722*rgba1.b;
-	float u  =  (rgba0.b-y0) / 1.8556;
-	float v  =  (rgba0.r-y0) / 1.5748;
-	
-	// Convert Y from 0-255 to 16-235
-	// (0-1 to 0.06274-0.92156)
-	//  y = (y/1.16438)+0.06274
-	y0 = y0/1.16438 + 0.06274;
-	y1 = y1/1.16438 + 0.06274;
-		
-	// Adjust u and v to 0-1 range
-	u += 0.5;
-	v += 0.5;
+	vec3 rgb = (rgba0.rgb + rgba1.rgb)*0.5;
+	float y0 = dot(ycoeffs.rgb, rgba0.rgb) + ycoeffs.w;
+	float y1 = dot(ycoeffs.rgb, rgba1.rgb) + ycoeffs.w;
+	float u  = dot(ucoeffs.rgb, rgb) + ucoeffs.w;
+	float v  = dot(vcoeffs.rgb, rgb) + vcoeffs.w;
 
 	// u y0 v y1
 	vec4 yuv422 = vec4(0.0);
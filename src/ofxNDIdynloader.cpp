@@ -60,10 +60,26 @@
 				- Change addon library path from "libs/NDI/export/vs" to "libs/NDI/bin/vs"
 				- Change headers and dll files to NDI version 6.0.1.0
 	17.05.24	- Return to using GetModuleFileName to get a full path to the dll
+	16.10.26	- Add Acquire and Release for one reference counted runtime
+				  shared by all senders and receivers in the process
+				- Acquire - try again after a failed load
 
 */
 
 #include "ofxNDIdynloader.h"
+#include "ofxNDIutils.h" // for USE_THREADS
+
+#if defined(USE_THREADS)
+#include <mutex>
+#endif
+
+// Shared runtime
+static ofxNDIdynloader* s_pSharedLoader = nullptr;
+static const NDIlib_v5* s_pSharedLib = nullptr;
+static int s_nSharedRefs = 0;
+#if defined(USE_THREADS)
+static std::mutex s_SharedMutex;
+#endif
 
 ofxNDIdynloader::ofxNDIdynloader()
 {
@@ -88,6 +104,47 @@ ofxNDIdynloader::~ofxNDIdynloader()
 }
 
 
+// Load the shared runtime if not already and add a reference
+// Returns nullptr if the runtime could not be loaded.
+// A later Acquire tries again, e.g. after the runtime is installed.
+const NDIlib_v5* ofxNDIdynloader::Acquire()
+{
+#if defined(USE_THREADS)
+	std::lock_guard<std::mutex> lock(s_SharedMutex);
+#endif
+
+	if (!s_pSharedLib) {
+		s_pSharedLoader = new ofxNDIdynloader;
+		s_pSharedLib = s_pSharedLoader->Load();
+		if (!s_pSharedLib) {
+			delete s_pSharedLoader;
+			s_pSharedLoader = nullptr;
+			return nullptr;
+		}
+	}
+
+	s_nSharedRefs++;
+	return s_pSharedLib;
+}
+
+// Release a reference to the shared runtime
+// The runtime is unloaded with the last reference.
+void ofxNDIdynloader::Release()
+{
+#if defined(USE_THREADS)
+	std::lock_guard<std::mutex> lock(s_SharedMutex);
+#endif
+
+	if (s_nSharedRefs <= 0)
+		return;
+
+	if (--s_nSharedRefs == 0) {
+		delete s_pSharedLoader;
+		s_pSharedLoader = nullptr;
+		s_pSharedLib = nullptr;
+	}
+}
+
 #if defined(TARGET_WIN32)
 const NDIlib_v5* ofxNDIdynloader::Load()
 {
@@ -44,6 +44,12 @@ public:
     // load library dynamically
     const NDIlib_v5* Load();
 
+	// Runtime shared by all senders and receivers in the process.
+	// The first Acquire loads the library and the last Release
+	// unloads it. Acquire tries again after a load that failed.
+	static const NDIlib_v5* Acquire();
+	static void Release();
+
 private :
 
 #if defined(TARGET_WIN32)
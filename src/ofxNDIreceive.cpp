@@ -157,6 +157,22 @@
 	29.05.24 - Return to rolling average for received fps calculation with 0.02 update
 			   Add ResetFps to reset starting received frame rate
 	01.06.24 - UpdateFps - rolling average damping based on received frame time
+	15.10.26 - Add CopyVideoData for conversion of the received frame to rgba
+			   Used by ReceiveImage to pixels and available for held frames.
+			   Convert NV12, I420 and YV12 formats
+			 - Add 16 bit and float ReceiveImage and CopyVideoData
+			   for full precision P216 and PA16 receive
+			 - Add SetColorimetry for YUV matrix and range of CPU conversion
+			 - Add ReceiveImage and CopyVideoData with a scaled destination size
+			 - Stage timers "receive.capture" and "receive.convert"
+	16.10.26 - Add GetAudioData with sample format, layout, gain and dither
+			   Add CopyAudioFrame for both ReceiveImage functions.
+			   Copy channels with the frame channel stride.
+			   Use the shared runtime from ofxNDIdynloader::Acquire.
+			   The runtime is loaded by the first finder or receiver
+			   instead of the constructor.
+			   CopyVideoData - flip UYVY and UYVA if bInvert.
+			   LoadRuntime - try the shared runtime once for each receiver.
 
 */
 
@@ -210,12 +226,14 @@ ofxNDIreceive::ofxNDIreceive()
 	p_sources = nullptr;
 	no_sources = 0;
 	bNDIinitialized = false;
+	bNDIloadTried = false;
 	bReceiverCreated = false;
 	m_FrameType = NDIlib_frame_type_none;
 	m_nSenders = 0;
 	m_Width = 0;
 	m_Height = 0;
 	m_Format = NDIlib_recv_color_format_BGRX_BGRA;
+	m_Colorimetry = ofxNDIutils::YUVcolorimetry(); // BT.601 for SD, BT.709 for HD, limited range
 	m_senderIndex = 0;
 	m_senderName = "";
 	// Audio
@@ -247,10 +265,7 @@ ofxNDIreceive::ofxNDIreceive()
 	// (see SetLowBandwidth)
 	m_bandWidth = NDIlib_recv_bandwidth_highest;
 
-	// Find and load the NDI dll
-	p_NDILib = libloader.Load();
-	if (p_NDILib)
-		bNDIinitialized = true;
+	// The NDI runtime is loaded by the first finder or receiver
 
 }
 
@@ -260,14 +275,18 @@ ofxNDIreceive::~ofxNDIreceive()
 	FreeAudioData();
 	if(p_NDILib && pNDI_recv) p_NDILib->recv_destroy(pNDI_recv);
 	if(p_NDILib && pNDI_find) p_NDILib->find_destroy(pNDI_find);
-	// Library is released in ofxNDIdynloader
+	// Release the shared runtime
+	if (p_NDILib)
+		ofxNDIdynloader::Release();
+	p_NDILib = nullptr;
+	bNDIinitialized = false;
 }
 
 
 // Create a finder to look for a sources on the network
 void ofxNDIreceive::CreateFinder()
 {
-	if(!bNDIinitialized) return;
+	if(!LoadRuntime()) return;
 
 	if (pNDI_find) p_NDILib->find_destroy(pNDI_find);
 	const NDIlib_find_create_t NDI_find_create_desc = { true, NULL, NULL }; // Version 2
@@ -307,7 +326,7 @@ bool ofxNDIreceive::FindSenders(int &sendercount)
 	std::string name;
 	uint32_t nsources = 0; // New number of sources
 
-	if (!bNDIinitialized) {
+	if (!LoadRuntime()) {
 		sendercount = 0;
 		m_nSenders = 0;
 		return false;
@@ -397,7 +416,7 @@ int ofxNDIreceive::RefreshSenders(uint32_t timeout)
 	std::string name;
 	uint32_t nsources = 0;
 
-	if(!bNDIinitialized) return 0;
+	if(!LoadRuntime()) return 0;
 
 	// Release the current finder
 	if(pNDI_find) ReleaseFinder();
@@ -630,6 +649,19 @@ void ofxNDIreceive::SetFormat(NDIlib_recv_color_format_e format)
 	m_Format = format;
 }
 
+// Set YUV colorimetry for CPU conversion of received YUV frames
+//  Default YUV_MATRIX_AUTO and YUV_RANGE_LIMITED
+void ofxNDIreceive::SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry)
+{
+	m_Colorimetry = colorimetry;
+}
+
+// Get YUV colorimetry
+ofxNDIutils::YUVcolorimetry ofxNDIreceive::GetColorimetry()
+{
+	return m_Colorimetry;
+}
+
 
 // Return the received frame type
 NDIlib_frame_type_e ofxNDIreceive::GetFrameType()
@@ -715,6 +747,49 @@ void ofxNDIreceive::GetAudioData(float*& output, int& samplerate, int& samples,
 	}
 }
 
+// Return audio frame data in the sample format and layout required
+// Conversion, interleave and gain in one pass over the samples
+//   output - samples * channels of the format
+//   format - ofxNDIutils::AUDIO_FLOAT, AUDIO_INT16 or AUDIO_INT32
+//   bInterleaved - samples of all channels in turn, otherwise planar
+//   gain - multiplier for the samples
+//   bDither - triangular dither for integer formats
+bool ofxNDIreceive::GetAudioData(void* output, ofxNDIutils::AudioFormat format, bool bInterleaved, float gain, bool bDither)
+{
+	if (!m_AudioData || !output)
+		return false;
+	return ofxNDIutils::ConvertAudio(m_AudioData, ofxNDIutils::AUDIO_FLOAT, false, 0,
+		output, format, bInterleaved, 0, m_nAudioSamples, m_nAudioChannels, gain, bDither);
+}
+
+// Copy a received audio frame to the local planar buffer
+// Allocate only for sample size change.
+// The channel stride of the frame can be larger than the samples.
+void ofxNDIreceive::CopyAudioFrame(const NDIlib_audio_frame_v3_t& frame)
+{
+	if (m_nAudioSamples != frame.no_samples
+		|| m_nAudioSampleRate != frame.sample_rate
+		|| m_nAudioChannels != frame.no_channels) {
+		if (m_AudioData) free((void *)m_AudioData);
+		m_AudioData = (float *)malloc((size_t)frame.no_samples * (size_t)frame.no_channels * sizeof(float));
+	}
+	m_nAudioChannels = frame.no_channels;
+	m_nAudioSamples = frame.no_samples;
+	m_nAudioSampleRate = frame.sample_rate;
+	if (m_AudioData) {
+		const size_t size = (size_t)m_nAudioSamples * sizeof(float);
+		const size_t stride = (frame.channel_stride_in_bytes > 0) ? (size_t)frame.channel_stride_in_bytes : size;
+		if (stride == size) {
+			memcpy((void *)m_AudioData, (void *)frame.p_data, size * (size_t)m_nAudioChannels);
+		}
+		else {
+			for (int c = 0; c < m_nAudioChannels; c++)
+				memcpy((void *)(m_AudioData + (size_t)c * m_nAudioSamples), (void *)(frame.p_data + (size_t)c * stride), size);
+		}
+	}
+	m_bAudioFrame = true;
+}
+
 // Test for network change
 // Create receiver if not initialized or a new sender has been selected
 bool ofxNDIreceive::OpenReceiver()
@@ -774,7 +849,7 @@ bool ofxNDIreceive::CreateReceiver(NDIlib_recv_color_format_e colorFormat , int
 {
 	std::string name;
 
-	if (!bNDIinitialized) {
+	if (!LoadRuntime()) {
 		return false;
 	}
 
@@ -963,7 +1038,7 @@ bool ofxNDIreceive::ReceiveImage(unsigned char *pixels,
 	m_FrameType = NDIlib_frame_type_none;
 	bool bRet = false;
 
-	if (!bNDIinitialized) return false;
+	if (!LoadRuntime()) return false;
 
 	// Create receiver if not initialized
 	// or a new sender has been selected
@@ -974,7 +1049,9 @@ bool ofxNDIreceive::ReceiveImage(unsigned char *pixels,
 
 		// NDI_frame_type = p_NDILib->recv_capture_v2(pNDI_recv, &video_frame, &audio_frame, &metadata_frame, 0);
 		// Vers 4.5
+		OFXNDI_TIMER(capture, "receive.capture");
 		NDI_frame_type = p_NDILib->recv_capture_v3(pNDI_recv, &video_frame, &audio_frame, &metadata_frame, 0);
+		OFXNDI_TIMER_STOP(capture);
 
 		// Set frame type for external access
 		m_FrameType = NDI_frame_type;
@@ -1020,21 +1097,7 @@ bool ofxNDIreceive::ReceiveImage(unsigned char *pixels,
 					if (m_bAudio) {
 						// printf("Audio data received (%d samples).\n", audio_frame.no_samples);
 						// Copy the audio data to a local audio buffer
-						// Allocate only for sample size change
-						if (m_nAudioSamples != audio_frame.no_samples
-							|| m_nAudioSampleRate != audio_frame.sample_rate
-							|| m_nAudioChannels != audio_frame.no_channels) {
-							// printf("Creating audio buffer - %d samples, %d channels\n", audio_frame.no_samples, audio_frame.no_channels);
-							if (m_AudioData) free((void *)m_AudioData);
-							m_AudioData = (float *)malloc((size_t)audio_frame.no_samples * (size_t)audio_frame.no_channels * sizeof(float));
-						}
-						// printf("Audio data received data = %x, samples = %d\n", (unsigned int)audio_frame.p_data, audio_frame.no_samples);
-						m_nAudioChannels = audio_frame.no_channels;
-						m_nAudioSamples = audio_frame.no_samples;
-						m_nAudioSampleRate = audio_frame.sample_rate;
-						if (m_AudioData)
-							memcpy((void *)m_AudioData, (void *)audio_frame.p_data, ((size_t)m_nAudioSamples * (size_t)audio_frame.no_channels * sizeof(float)));
-						m_bAudioFrame = true;
+						CopyAudioFrame(audio_frame);
 						// ReceiveImage will return false
 						// Use IsAudioFrame() to determine whether audio has been received
 						// and GetAudioData to retrieve the sample buffer
@@ -1064,40 +1127,8 @@ bool ofxNDIreceive::ReceiveImage(unsigned char *pixels,
 					// Otherwise sizes are current - copy the received frame data to the local buffer
 					else if (video_frame.p_data && (uint8_t*)pixels) {
 
-						// Video frame type
-						switch (video_frame.FourCC) {
-							// Note :
-							// If the receiver is set up to prefer BGRA or RGBA format,
-							// other formats are converted to by the API, and the
-							// slower YUV422_to_RGBA conversion function is not used.
-							case NDIlib_FourCC_type_UYVY: // YCbCr color space
-							// Alpha component of NDIlib_FourCC_type_UYVA not supported
-							case NDIlib_FourCC_type_UYVA: // With alpha (not used)
-								// CPU conversion
-								ofxNDIutils::YUV422_to_RGBA((const unsigned char *)video_frame.p_data, pixels, m_Width, m_Height, (unsigned int)video_frame.line_stride_in_bytes);
-								break;
-							case NDIlib_FourCC_video_type_P216:	break;
-							case NDIlib_FourCC_video_type_PA16:	break;
-							case NDIlib_FourCC_type_RGBA: // RGBA
-							case NDIlib_FourCC_type_RGBX: // RGBX
-								// Do not swap red/green
-								ofxNDIutils::CopyImage((const unsigned char *)video_frame.p_data, pixels, m_Width, m_Height, (unsigned int)video_frame.line_stride_in_bytes, false, bInvert);
-								break;
-							case NDIlib_FourCC_type_BGRA: // BGRA
-							case NDIlib_FourCC_type_BGRX: // BGRX
-								// Swap red/green : BGRA > RGBA
-								ofxNDIutils::CopyImage((const unsigned char *)video_frame.p_data, pixels, m_Width, m_Height, (unsigned int)video_frame.line_stride_in_bytes, true, bInvert);
-								break;
-							
-							// Unsupported formats
-							case NDIlib_FourCC_type_NV12:
-							case NDIlib_FourCC_type_I420:
-							case NDIlib_FourCC_type_YV12:
-							case NDIlib_frame_type_max:
-							default:
-								break;
-
-						} // end switch received format
+						// Convert or copy from the received format to rgba
+						CopyVideoData(pixels, bInvert);
 
 						// Get the current video frame timecode
 						// UTC time since the Unix Epoch (1/1/1970 00:00) with 100 ns precision.
@@ -1139,6 +1170,81 @@ bool ofxNDIreceive::ReceiveImage(unsigned char *pixels,
 
 }
 
+// Receive image pixels scaled to a buffer of a different size
+// - pixels     : rgba buffer of destWidth*destHeight
+// - width      : received image width
+// - height     : received image height
+// - destWidth  : buffer width
+// - destHeight : buffer height
+// - bInvert    : flip the image
+bool ofxNDIreceive::ReceiveImage(unsigned char *pixels,
+	unsigned int &width, unsigned int &height,
+	unsigned int destWidth, unsigned int destHeight,
+	bool bInvert)
+{
+	// Audio and metadata are handled as for other receives
+	if (!ReceiveImage(width, height))
+		return false;
+
+	if (pixels)
+		CopyVideoData(pixels, destWidth, destHeight, bInvert);
+	FreeVideoData();
+
+	return true;
+}
+
+// Receive 16 bit image pixels to a buffer
+// - pixels  : received 16 bit RGBA pixel data
+// - width   : received image width
+// - height  : received image height
+// - pitch   : buffer line pitch in bytes (0 for width*8)
+// - bInvert : flip the image
+bool ofxNDIreceive::ReceiveImage(uint16_t *pixels,
+	unsigned int &width, unsigned int &height,
+	unsigned int pitch, bool bInvert)
+{
+	return ReceiveHighBitDepth(pixels, false, width, height, pitch, bInvert);
+}
+
+// Receive float image pixels to a buffer
+// - pixels  : received float RGBA pixel data
+// - width   : received image width
+// - height  : received image height
+// - pitch   : buffer line pitch in bytes (0 for width*16)
+// - bInvert : flip the image
+bool ofxNDIreceive::ReceiveImage(float *pixels,
+	unsigned int &width, unsigned int &height,
+	unsigned int pitch, bool bInvert)
+{
+	return ReceiveHighBitDepth(pixels, true, width, height, pitch, bInvert);
+}
+
+// Receive a video frame and copy to a 16 bit or float buffer
+// Returns true without copying for changed dimensions
+// for the app to re-allocate the buffer
+bool ofxNDIreceive::ReceiveHighBitDepth(void *pixels, bool bFloat,
+	unsigned int &width, unsigned int &height,
+	unsigned int pitch, bool bInvert)
+{
+	unsigned int frameWidth = 0;
+	unsigned int frameHeight = 0;
+
+	// Audio and metadata are handled as for other receives
+	if (!ReceiveImage(frameWidth, frameHeight))
+		return false;
+
+	if (frameWidth != width || frameHeight != height) {
+		width = frameWidth;
+		height = frameHeight;
+	}
+	else if (pixels) {
+		CopyHighBitDepth(pixels, bFloat, pitch, bInvert);
+	}
+	FreeVideoData();
+
+	return true;
+}
+
 // Receive image pixels without a receiving buffer
 // The received video frame is then held in ofxReceive class.
 // (Used for receiving Openframeworks ofTexture, ofFbo, ofImage and ofPixels)
@@ -1154,7 +1260,7 @@ bool ofxNDIreceive::ReceiveImage(unsigned int &width, unsigned int &height)
 	m_FrameType = NDIlib_frame_type_none;
 	bool bRet = false;
 
-	if (!bNDIinitialized) {
+	if (!LoadRuntime()) {
 		printf("ofxNDIreceive : ReceiveImage not initialized\n");
 		return false;
 	}
@@ -1169,7 +1275,9 @@ bool ofxNDIreceive::ReceiveImage(unsigned int &width, unsigned int &height)
 
 		// NDI_frame_type = p_NDILib->recv_capture_v2(pNDI_recv, &video_frame, &audio_frame, &metadata_frame, 0);
 		// Vers 4.5
+		OFXNDI_TIMER(capture, "receive.capture");
 		NDI_frame_type = p_NDILib->recv_capture_v3(pNDI_recv, &video_frame, &audio_frame, &metadata_frame, 0);
+		OFXNDI_TIMER_STOP(capture);
 
 		// Set frame type for external access
 		m_FrameType = NDI_frame_type;
@@ -1214,20 +1322,7 @@ bool ofxNDIreceive::ReceiveImage(unsigned int &width, unsigned int &height)
 				if (audio_frame.p_data) {
 					if (m_bAudio) {
 						// Copy the audio data to a local audio buffer
-						// Allocate only for sample size change
-						if (m_nAudioSamples != audio_frame.no_samples
-							|| m_nAudioSampleRate != audio_frame.sample_rate
-							|| m_nAudioChannels != audio_frame.no_channels) {
-							// printf("Creating audio buffer - %d samples, %d channels\n", audio_frame.no_samples, audio_frame.no_channels);
-							if (m_AudioData) free((void *)m_AudioData);
-							m_AudioData = (float *)malloc((size_t)audio_frame.no_samples * (size_t)audio_frame.no_channels * sizeof(float));
-						}
-						m_nAudioChannels = audio_frame.no_channels;
-						m_nAudioSamples = audio_frame.no_samples;
-						m_nAudioSampleRate = audio_frame.sample_rate;
-						if (m_AudioData)
-							memcpy((void *)m_AudioData, (void *)audio_frame.p_data, ((size_t)m_nAudioSamples * (size_t)audio_frame.no_channels * sizeof(float)));
-						m_bAudioFrame = true;
+						CopyAudioFrame(audio_frame);
 						//
 						// ReceiveImage will return false (no image received)
 						//
@@ -1295,6 +1390,169 @@ bool ofxNDIreceive::ReceiveImage(unsigned int &width, unsigned int &height)
 	return bRet;
 }
 
+// Copy the current video frame to an rgba buffer
+// Received formats are converted to rgba
+// The buffer must be the size of the received frame
+bool ofxNDIreceive::CopyVideoData(unsigned char *pixels, bool bInvert)
+{
+	if (!pixels || !video_frame.p_data)
+		return false;
+
+	OFXNDI_TIMER(convert, "receive.convert");
+
+	const unsigned char *data = (const unsigned char *)video_frame.p_data;
+	const unsigned int width = (unsigned int)video_frame.xres;
+	const unsigned int height = (unsigned int)video_frame.yres;
+	const unsigned int stride = (unsigned int)video_frame.line_stride_in_bytes;
+	// 4:2:0 chroma planes follow the Y plane
+	const unsigned char *chroma = data + (size_t)stride * height;
+	const size_t chromasize = (size_t)(stride / 2) * ((height + 1) / 2);
+
+	// Video frame type
+	switch (video_frame.FourCC) {
+		// Note :
+		// If the receiver is set up to prefer BGRA or RGBA format,
+		// other formats are converted to by the API, and the
+		// YUV conversion functions are not used.
+		case NDIlib_FourCC_type_UYVY: // YCbCr color space
+		// Alpha component of NDIlib_FourCC_type_UYVA not supported
+		case NDIlib_FourCC_type_UYVA: // With alpha (not used)
+			// CPU conversion
+			ofxNDIutils::YUV422_to_RGBA(data, pixels, width, height, stride, m_Colorimetry, bInvert);
+			return true;
+		case NDIlib_FourCC_type_NV12: // Y plane and interleaved UV plane
+			ofxNDIutils::NV12_to_RGBA(data, chroma, pixels, width, height, stride, stride, false, bInvert, m_Colorimetry);
+			return true;
+		case NDIlib_FourCC_type_I420: // Y, U and V planes
+			ofxNDIutils::I420_to_RGBA(data, chroma, chroma + chromasize, pixels, width, height, stride, stride / 2, false, bInvert, m_Colorimetry);
+			return true;
+		case NDIlib_FourCC_type_YV12: // Y, V and U planes
+			ofxNDIutils::I420_to_RGBA(data, chroma + chromasize, chroma, pixels, width, height, stride, stride / 2, false, bInvert, m_Colorimetry);
+			return true;
+		case NDIlib_FourCC_video_type_P216:	break;
+		case NDIlib_FourCC_video_type_PA16:	break;
+		case NDIlib_FourCC_type_RGBA: // RGBA
+		case NDIlib_FourCC_type_RGBX: // RGBX
+			// Do not swap red/green
+			ofxNDIutils::CopyImage(data, pixels, width, height, stride, false, bInvert);
+			return true;
+		case NDIlib_FourCC_type_BGRA: // BGRA
+		case NDIlib_FourCC_type_BGRX: // BGRX
+			// Swap red/green : BGRA > RGBA
+			ofxNDIutils::CopyImage(data, pixels, width, height, stride, true, bInvert);
+			return true;
+
+		// Unsupported formats
+		case NDIlib_frame_type_max:
+		default:
+			break;
+
+	} // end switch received format
+
+	return false;
+}
+
+// Scale the current video frame to an rgba buffer of a different size
+// UYVY, BGRA and RGBA are scaled while reading the frame
+bool ofxNDIreceive::CopyVideoData(unsigned char *pixels, unsigned int destWidth, unsigned int destHeight, bool bInvert)
+{
+	if (!pixels || !video_frame.p_data || destWidth == 0 || destHeight == 0)
+		return false;
+
+	const unsigned char *data = (const unsigned char *)video_frame.p_data;
+	const unsigned int width = (unsigned int)video_frame.xres;
+	const unsigned int height = (unsigned int)video_frame.yres;
+	const unsigned int stride = (unsigned int)video_frame.line_stride_in_bytes;
+
+	// Same size
+	if (destWidth == width && destHeight == height)
+		return CopyVideoData(pixels, bInvert);
+
+	OFXNDI_TIMER(convert, "receive.convert");
+	switch (video_frame.FourCC) {
+		case NDIlib_FourCC_type_UYVY:
+		case NDIlib_FourCC_type_UYVA:
+			ofxNDIutils::ScaleYUV422_to_RGBA(data, pixels, width, height, stride,
+				destWidth, destHeight, false, bInvert, m_Colorimetry);
+			return true;
+		case NDIlib_FourCC_type_RGBA:
+		case NDIlib_FourCC_type_RGBX:
+			ofxNDIutils::ScaleImage(data, pixels, width, height, stride,
+				destWidth, destHeight, false, bInvert);
+			return true;
+		case NDIlib_FourCC_type_BGRA:
+		case NDIlib_FourCC_type_BGRX:
+			ofxNDIutils::ScaleImage(data, pixels, width, height, stride,
+				destWidth, destHeight, true, bInvert);
+			return true;
+		default:
+			break;
+	}
+
+	// Other formats to full size rgba first
+	// CopyVideoData records its own conversion time
+	OFXNDI_TIMER_STOP(convert);
+	m_rgbaBuffer.resize((size_t)width * height * 4);
+	if (!CopyVideoData(m_rgbaBuffer.data(), bInvert))
+		return false;
+	ofxNDIutils::ScaleImage(m_rgbaBuffer.data(), pixels, width, height, width * 4, destWidth, destHeight);
+
+	return true;
+}
+
+// Copy the current video frame to a 16 bit rgba buffer
+bool ofxNDIreceive::CopyVideoData(uint16_t *pixels, unsigned int pitch, bool bInvert)
+{
+	return CopyHighBitDepth(pixels, false, pitch, bInvert);
+}
+
+// Copy the current video frame to a float rgba buffer
+bool ofxNDIreceive::CopyVideoData(float *pixels, unsigned int pitch, bool bInvert)
+{
+	return CopyHighBitDepth(pixels, true, pitch, bInvert);
+}
+
+// Copy the current video frame to a 16 bit or float rgba buffer
+// P216 and PA16 are converted directly.
+// 8 bit formats are converted to rgba and expanded.
+bool ofxNDIreceive::CopyHighBitDepth(void *pixels, bool bFloat, unsigned int pitch, bool bInvert)
+{
+	if (!pixels || !video_frame.p_data)
+		return false;
+
+	const unsigned char *data = (const unsigned char *)video_frame.p_data;
+	const unsigned int width = (unsigned int)video_frame.xres;
+	const unsigned int height = (unsigned int)video_frame.yres;
+	const unsigned int stride = (unsigned int)video_frame.line_stride_in_bytes;
+
+	if (video_frame.FourCC == NDIlib_FourCC_video_type_P216
+		|| video_frame.FourCC == NDIlib_FourCC_video_type_PA16) {
+		OFXNDI_TIMER(convert, "receive.convert");
+		// UV plane and PA16 alpha plane follow the Y plane with the same stride
+		const uint16_t *y = (const uint16_t *)data;
+		const uint16_t *uv = (const uint16_t *)(data + (size_t)stride * height);
+		const uint16_t *alpha = nullptr;
+		if (video_frame.FourCC == NDIlib_FourCC_video_type_PA16)
+			alpha = (const uint16_t *)(data + (size_t)stride * height * 2);
+		if (bFloat)
+			ofxNDIutils::P216_to_RGBAF(y, uv, alpha, (float *)pixels, width, height, stride, pitch, bInvert, m_Colorimetry);
+		else
+			ofxNDIutils::P216_to_RGBA16(y, uv, alpha, (uint16_t *)pixels, width, height, stride, pitch, bInvert, m_Colorimetry);
+		return true;
+	}
+
+	// 8 bit formats
+	m_rgbaBuffer.resize((size_t)width * height * 4);
+	if (!CopyVideoData(m_rgbaBuffer.data(), bInvert))
+		return false;
+	if (bFloat)
+		ofxNDIutils::RGBA_to_RGBAF(m_rgbaBuffer.data(), (float *)pixels, width, height, pitch);
+	else
+		ofxNDIutils::RGBA_to_RGBA16(m_rgbaBuffer.data(), (uint16_t *)pixels, width, height, pitch);
+
+	return true;
+}
+
 // Get the video type received
 NDIlib_FourCC_video_type_e ofxNDIreceive::GetVideoType()
 {
@@ -1345,7 +1603,7 @@ void ofxNDIreceive::FreeAudioData()
 // Get NDI dll version number
 std::string ofxNDIreceive::GetNDIversion()
 {
-	if (p_NDILib)
+	if (LoadRuntime())
 		return p_NDILib->version();
 	else
 		return "";
@@ -1367,6 +1625,20 @@ void ofxNDIreceive::ResetFps(double fps)
 // Private functions
 //
 
+// Acquire the shared NDI runtime if not already
+bool ofxNDIreceive::LoadRuntime()
+{
+	// Tried once for each receiver, as when the runtime was loaded
+	// by the constructor, not for every FindSenders or ReceiveImage.
+	// A new receiver tries again.
+	if (!bNDIinitialized && !bNDIloadTried) {
+		bNDIloadTried = true;
+		p_NDILib = ofxNDIdynloader::Acquire();
+		bNDIinitialized = (p_NDILib != nullptr);
+	}
+	return bNDIinitialized;
+}
+
 // Version 2
 // Replacement for deprecated NDIlib_find_get_sources.
 // If no timeout specified, return the sources that exist right now.
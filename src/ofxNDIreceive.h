@@ -50,6 +50,13 @@
 	06.12.19 - Add dynamic load class (https://github.com/IDArnhem/ofxNDI)
 	27.02.20 - Add std::chrono functions for fps timing
 	14.12.23 - Add m_VideoTimecode, GetVideoTimecode()
+	15.10.26 - Add CopyVideoData
+			   Add 16 bit and float ReceiveImage and CopyVideoData
+			   Add SetColorimetry
+			   Add scaled ReceiveImage and CopyVideoData
+	16.10.26 - Add GetAudioData with sample format and layout
+			   Add CopyAudioFrame
+			   Use the shared NDI runtime, loaded on first use
 
 */
 #pragma once
@@ -139,6 +146,42 @@ public:
 		unsigned int &width, unsigned int &height,
 		bool bInvert = false);
 
+	// Receive image pixels scaled to a buffer of a different size
+	// For preview and thumbnail display. The received frame is scaled
+	// as it is read, without a full size copy.
+	// Half or quarter size (width/2, height/2 or width/4, height/4)
+	// uses a box filter, other sizes are bilinear.
+	// - pixels | rgba buffer of destWidth*destHeight
+	// - width | received image width
+	// - height | received image height
+	// - destWidth, destHeight | buffer size
+	// - bInvert | flip the image
+	bool ReceiveImage(unsigned char *pixels,
+		unsigned int &width, unsigned int &height,
+		unsigned int destWidth, unsigned int destHeight,
+		bool bInvert = false);
+
+	// Receive 16 bit image pixels to a buffer
+	// P216 and PA16 frames keep full precision.
+	// Other formats are expanded from 8 bits.
+	// For high bit depth sources, create the receiver
+	// with NDIlib_recv_color_format_best.
+	// - pixels | received 16 bit RGBA pixel data
+	// - width | received image width
+	// - height | received image height
+	// - pitch | buffer line pitch in bytes (0 for width*8)
+	// - bInvert | flip the image
+	bool ReceiveImage(uint16_t *pixels,
+		unsigned int &width, unsigned int &height,
+		unsigned int pitch, bool bInvert = false);
+
+	// Receive float image pixels to a buffer
+	// As above with float RGBA 0-1
+	// - pitch | buffer line pitch in bytes (0 for width*16)
+	bool ReceiveImage(float *pixels,
+		unsigned int &width, unsigned int &height,
+		unsigned int pitch, bool bInvert = false);
+
 	// Receive image pixels without a receiving buffer
 	// The received video frame is held in ofxReceive class.
 	// Use the video frame data pointer externally with GetVideoData()
@@ -159,6 +202,29 @@ public:
 	// Get a pointer to the current video frame data
 	unsigned char *GetVideoData();
 
+	// Copy the current video frame to an rgba buffer
+	// UYVY, NV12, I420, YV12, BGRA and RGBA are converted to rgba
+	// - pixels | buffer of the received frame size
+	// - bInvert | flip the image
+	// Returns false for unsupported formats
+	bool CopyVideoData(unsigned char *pixels, bool bInvert = false);
+
+	// Scale the current video frame to an rgba buffer of a different size
+	// UYVY, BGRA and RGBA are scaled as they are read.
+	// Other formats are converted to full size first.
+	// - pixels | buffer of destWidth*destHeight
+	// - bInvert | flip the image
+	// Returns false for unsupported formats
+	bool CopyVideoData(unsigned char *pixels, unsigned int destWidth, unsigned int destHeight, bool bInvert = false);
+
+	// Copy the current video frame to a 16 bit or float rgba buffer
+	// - pixels | buffer of the received frame size
+	// - pitch | buffer line pitch in bytes (0 for no padding)
+	// - bInvert | flip the image
+	// Returns false for unsupported formats
+	bool CopyVideoData(uint16_t *pixels, unsigned int pitch, bool bInvert = false);
+	bool CopyVideoData(float *pixels, unsigned int pitch, bool bInvert = false);
+
 	// Free NDI video frame buffers
 	// Must be done after successful receive of a video frame
 	// if using ReceiveImage without a receiving buffer
@@ -231,6 +297,14 @@ public:
 	// Set receiver preferred format
 	void SetFormat(NDIlib_recv_color_format_e format);
 
+	// Set YUV colorimetry for CPU conversion of received YUV frames
+	// Matrix (BT.601, BT.709, BT.2020 or auto) and range (limited or full)
+	// Initialized YUV_MATRIX_AUTO, YUV_RANGE_LIMITED
+	void SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry);
+
+	// Get YUV colorimetry
+	ofxNDIutils::YUVcolorimetry GetColorimetry();
+
 	// Received frame type
 	NDIlib_frame_type_e GetFrameType();
 
@@ -269,6 +343,15 @@ public:
 	// Return audio frame data
 	void GetAudioData(float*& output, int& samplerate, int& samples, int& nChannels);
 
+	// Return audio frame data in the sample format and layout required
+	// output - samples * channels of the format
+	// format - ofxNDIutils::AUDIO_FLOAT, AUDIO_INT16 or AUDIO_INT32
+	// bInterleaved - samples of all channels in turn, otherwise planar
+	// gain - multiplier for the samples
+	// bDither - triangular dither for integer formats
+	bool GetAudioData(void* output, ofxNDIutils::AudioFormat format,
+		bool bInterleaved = true, float gain = 1.0f, bool bDither = false);
+
 	// Free audio frame buffer
 	void FreeAudioData();
 
@@ -285,8 +368,7 @@ public:
 
 private:
 
-	ofxNDIdynloader libloader;
-	const NDIlib_v4* p_NDILib;
+	const NDIlib_v4* p_NDILib; // Shared runtime
 
 	const NDIlib_source_t* p_sources;
 	uint32_t no_sources;
@@ -299,12 +381,15 @@ private:
 	unsigned int m_Width;
 	unsigned int m_Height;
 	NDIlib_recv_color_format_e m_Format;
+	ofxNDIutils::YUVcolorimetry m_Colorimetry; // Matrix and range for YUV to rgba conversion
 
 	std::vector<std::string> NDIsenders; // List of sender names
 	int m_nSenders;// Sender count
 	int m_senderIndex; // Current sender index
 	std::string m_senderName; // Current sender name
 	bool bNDIinitialized; // Is NDI initialized properly
+	bool bNDIloadTried; // Runtime load has been tried
+	bool LoadRuntime(); // Acquire the shared runtime on first use
 	bool bReceiverCreated; // Is the receiver created
 	bool bReceiverConnected; // Is the receiver connected and receiving frames
 	NDIlib_recv_bandwidth_e m_bandWidth; // Bandwidth receive option
@@ -322,6 +407,14 @@ private:
 	double m_frameTimeTotal;
 	double m_frameTimeNumber;
 	void UpdateFps();
+	void CopyAudioFrame(const NDIlib_audio_frame_v3_t& frame);
+
+	// High bit depth receive
+	std::vector<unsigned char> m_rgbaBuffer; // 8 bit formats before expanding or scaling
+	bool ReceiveHighBitDepth(void *pixels, bool bFloat,
+		unsigned int &width, unsigned int &height,
+		unsigned int pitch, bool bInvert);
+	bool CopyHighBitDepth(void *pixels, bool bFloat, unsigned int pitch, bool bInvert);
 
 	// Metadata
 	bool m_bMetadata;
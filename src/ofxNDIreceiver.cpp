@@ -75,6 +75,15 @@
 	28.05.24 - ReceiveImage(ofTexture &texture) Check for changed sender dimensions
 			   GetPixelData - test RGBA for upload flag as well as BGRA
 	29.05.24 - SetUpload - reset starting received frame rate
+	15.10.26 - ReceiveImage pixels / GetPixelData - convert UYVY, UYVA,
+			   NV12, I420 and YV12 to rgba with ofxNDIreceive::CopyVideoData
+			 - ReceiveImage pixels - single pass copy of RGBA and BGRA frames
+			   with line stride and bgra > rgba using CopyVideoData
+			 - LoadTexturePixels - copy with the source line pitch
+			 - Add SetColorimetry
+			 - LoadTexturePixels - stage timer "receiver.upload"
+	16.10.26 - Add GetAudioData with sample format, layout, gain and dither
+			 - ReceiveImage(ofPixels) - reallocate a buffer that is not rgba
 
 */
 #include "ofxNDIreceiver.h"
@@ -244,9 +253,12 @@ bool ofxNDIreceiver::ReceiveImage(ofPixels &buffer)
 	// Receive a pixel image first
 	if (NDIreceiver.ReceiveImage(width, height)) {
 
-		// Check for changed sender dimensions
-		if (width != (unsigned int)buffer.getWidth() || height != (unsigned int)buffer.getHeight())
-			buffer.allocate(width, height, OF_IMAGE_COLOR_ALPHA);
+		// Check for changed sender dimensions or a buffer that is not rgba.
+		// CopyVideoData writes width*height*4 bytes.
+		if (width != (unsigned int)buffer.getWidth()
+			|| height != (unsigned int)buffer.getHeight()
+			|| buffer.getPixelFormat() != OF_PIXELS_RGBA)
+			buffer.allocate(width, height, OF_PIXELS_RGBA);
 
 		// Get the video frame buffer pointer
 		unsigned char *videoData = NDIreceiver.GetVideoData();
@@ -260,9 +272,13 @@ bool ofxNDIreceiver::ReceiveImage(ofPixels &buffer)
 		switch (NDIreceiver.GetVideoType()) {
 			// Note : the receiver is set up to prefer BGRA format by default
 			case NDIlib_FourCC_type_UYVY: // YCbCr using 4:2:2
-				printf("ReceiveImage pixels - UYVY format not supported\n"); break;
-			case NDIlib_FourCC_type_UYVA: // YCbCr using 4:2:2:4
-				printf("ReceiveImage pixels - UYVA format not supported\n"); break;
+			case NDIlib_FourCC_type_UYVA: // YCbCr using 4:2:2:4 (alpha not used)
+			case NDIlib_FourCC_type_NV12: // YCbCr using 4:2:0 (Y and UV planes)
+			case NDIlib_FourCC_type_I420: // YCbCr using 4:2:0 (Y, U and V planes)
+			case NDIlib_FourCC_type_YV12: // YCbCr using 4:2:0 (Y, V and U planes)
+				// Convert to rgba
+				NDIreceiver.CopyVideoData(buffer.getData());
+				break;
 			case NDIlib_FourCC_type_P216: // YCbCr using 4:2:2 in 16bpp
 				printf("ReceiveImage pixels - P216 format not supported\n"); break;
 			case NDIlib_FourCC_type_PA16: // YCbCr using 4:2:2:4 in 16bpp
@@ -270,13 +286,11 @@ bool ofxNDIreceiver::ReceiveImage(ofPixels &buffer)
 				break;
 			case NDIlib_FourCC_type_RGBA: // RGBA
 			case NDIlib_FourCC_type_RGBX: // RGBX
-				// setFromPixels copies between buffers so that the videoData pointer can be freed
-				buffer.setFromPixels((unsigned char *)videoData, width, height, OF_PIXELS_RGBA);
-				break;
 			case NDIlib_FourCC_type_BGRA: // BGRA
 			case NDIlib_FourCC_type_BGRX: // BGRX
-				buffer.setFromPixels((unsigned char *)videoData, width, height, OF_PIXELS_RGBA);
-				buffer.swapRgb();
+				// Copy with the frame line stride and bgra > rgba in one pass
+				// so that the videoData pointer can be freed
+				NDIreceiver.CopyVideoData(buffer.getData());
 				break;
 			default:
 				// Unsupported format
@@ -464,6 +478,12 @@ void ofxNDIreceiver::SetLowBandwidth(bool bLow)
 	NDIreceiver.SetLowBandwidth(bLow);
 }
 
+// Set YUV colorimetry for CPU conversion of received YUV frames
+void ofxNDIreceiver::SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry)
+{
+	NDIreceiver.SetColorimetry(colorimetry);
+}
+
 // Set asynchronous upload of pixels to texture
 // Default false
 void ofxNDIreceiver::SetUpload(bool bUpload)
@@ -522,6 +542,13 @@ void ofxNDIreceiver::GetAudioData(float*& output, int& samplerate, int& samples,
 	NDIreceiver.GetAudioData(output, samplerate, samples, nChannels);
 }
 
+// Return audio frame data in the sample format and layout required
+// output - samples * channels of the format
+bool ofxNDIreceiver::GetAudioData(void* output, ofxNDIutils::AudioFormat format, bool bInterleaved, float gain, bool bDither)
+{
+	return NDIreceiver.GetAudioData(output, format, bInterleaved, gain, bDither);
+}
+
 // Return the NDI dll version number
 std::string ofxNDIreceiver::GetNDIversion()
 {
@@ -553,11 +580,20 @@ bool ofxNDIreceiver::GetPixelData(ofTexture &texture)
 	switch (NDIreceiver.GetVideoType()) {
 		// Note : the receiver is set up to prefer BGRA format by default
 		// If set to prefer NDIlib_recv_color_format_fastest, YUV data is received.
-		// YCbCr - Load texture with YUV data by way of PBO
+		// YCbCr - convert to rgba and load texture
 		case NDIlib_FourCC_type_UYVY: // YCbCr using 4:2:2
-			printf("GetPixelData - UYVY format not supported\n"); break;
-		case NDIlib_FourCC_type_UYVA: // YCbCr using 4:2:2:4
-			printf("GetPixelData - UYVA format not supported\n"); break;
+		case NDIlib_FourCC_type_UYVA: // YCbCr using 4:2:2:4 (alpha not used)
+		case NDIlib_FourCC_type_NV12: // YCbCr using 4:2:0 (Y and UV planes)
+		case NDIlib_FourCC_type_I420: // YCbCr using 4:2:0 (Y, U and V planes)
+		case NDIlib_FourCC_type_YV12: // YCbCr using 4:2:0 (Y, V and U planes)
+			if (m_rgbaBuffer.getWidth() != texture.getWidth() || m_rgbaBuffer.getHeight() != texture.getHeight())
+				m_rgbaBuffer.allocate((size_t)texture.getWidth(), (size_t)texture.getHeight(), OF_IMAGE_COLOR_ALPHA);
+			NDIreceiver.CopyVideoData(m_rgbaBuffer.getData());
+			if (m_bUpload)
+				LoadTexturePixels(texture.getTextureData().textureID, texture.getTextureData().textureTarget, (unsigned int)texture.getWidth(), (unsigned int)texture.getHeight(), m_rgbaBuffer.getData(), GL_RGBA);
+			else
+				texture.loadData(m_rgbaBuffer.getData(), (int)texture.getWidth(), (int)texture.getHeight(), GL_RGBA);
+			break;
 		case NDIlib_FourCC_type_P216: // YCbCr using 4:2:2 in 16bpp
 			printf("GetPixelData - P216 format not supported\n"); break;
 		case NDIlib_FourCC_type_PA16: // YCbCr using 4:2:2:4 in 16bpp
@@ -566,7 +602,7 @@ bool ofxNDIreceiver::GetPixelData(ofTexture &texture)
 		case NDIlib_FourCC_type_RGBX: // RGBX
 		case NDIlib_FourCC_type_RGBA: // RGBA
 			if (m_bUpload)
-				LoadTexturePixels(texture.getTextureData().textureID, texture.getTextureData().textureTarget, (unsigned int)texture.getWidth(), (unsigned int)texture.getHeight(), (unsigned char*)videoData, GL_RGBA);
+				LoadTexturePixels(texture.getTextureData().textureID, texture.getTextureData().textureTarget, (unsigned int)texture.getWidth(), (unsigned int)texture.getHeight(), (unsigned char*)videoData, GL_RGBA, NDIreceiver.GetVideoStride());
 			else
 				texture.loadData((const unsigned char*)videoData, (int)texture.getWidth(), (int)texture.getHeight(), GL_RGBA);
 			break;
@@ -574,7 +610,7 @@ bool ofxNDIreceiver::GetPixelData(ofTexture &texture)
 		case NDIlib_FourCC_type_BGRA: // BGRA
 		default: // BGRA
 			if(m_bUpload)
-				LoadTexturePixels(texture.getTextureData().textureID, texture.getTextureData().textureTarget, (unsigned int)texture.getWidth(),	(unsigned int)texture.getHeight(),	(unsigned char*)videoData, GL_BGRA);
+				LoadTexturePixels(texture.getTextureData().textureID, texture.getTextureData().textureTarget, (unsigned int)texture.getWidth(),	(unsigned int)texture.getHeight(),	(unsigned char*)videoData, GL_BGRA, NDIreceiver.GetVideoStride());
 			else
 				texture.loadData((const unsigned char*)videoData, (int)texture.getWidth(), (int)texture.getHeight(), GL_BGRA);
 			break;
@@ -591,9 +627,13 @@ bool ofxNDIreceiver::GetPixelData(ofTexture &texture)
 // From : http://www.songho.ca/opengl/gl_pbo.html
 // Approximately 20% faster than using glTexSubImage2D alone
 // GLformat can be default GL_BGRA or GL_RGBA
+// sourcePitch is the data line pitch in bytes (0 for width*4)
 bool ofxNDIreceiver::LoadTexturePixels(GLuint TextureID, GLuint TextureTarget,
-	unsigned int width, unsigned int height, unsigned char* data, int GLformat)
+	unsigned int width, unsigned int height, unsigned char* data, int GLformat,
+	unsigned int sourcePitch)
 {
+	OFXNDI_TIMER(upload, "receiver.upload");
+
 	void* pboMemory = NULL;
 
 	PboIndex = (PboIndex + 1) % 2;
@@ -618,9 +658,9 @@ bool ofxNDIreceiver::LoadTexturePixels(GLuint TextureID, GLuint TextureTarget,
 	pboMemory = (void*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
 	// Update the mapped buffer directly
 	if (pboMemory) {
-		// RGBA pixel data
-		// Use sse2 if the width is divisible by 16
-		ofxNDIutils::CopyImage(data, (unsigned char*)pboMemory, width, height);
+		// RGBA or BGRA pixel data
+		// Source lines can be padded, the PBO is not
+		ofxNDIutils::CopyImage((const void*)data, pboMemory, width, height, sourcePitch, width * 4, false, false);
 		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER); // release the mapped buffer
 	}
 	else {
@@ -25,6 +25,10 @@
 	=========================================================================
 
 	08.07.16 - Use ofxNDIreceive class
+	15.10.26 - Add rgba buffer for YUV texture load
+			   LoadTexturePixels - source line pitch
+			   Add SetColorimetry
+	16.10.26 - Add GetAudioData with sample format and layout
 
 */
 
@@ -188,6 +192,10 @@ public:
 	// Default false
 	void SetLowBandwidth(bool bLow = true);
 
+	// Set YUV colorimetry for CPU conversion of received YUV frames
+	// Initialized YUV_MATRIX_AUTO, YUV_RANGE_LIMITED
+	void SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry);
+
 	// Set asynchronous upload of pixels to texture
 	// Default false
 	void SetUpload(bool bUpload = true);
@@ -217,6 +225,10 @@ public:
 	// Return audio frame data
 	void GetAudioData(float*& output, int& samplerate, int& samples, int& nChannels);
 
+	// Return audio frame data in the sample format and layout required
+	bool GetAudioData(void* output, ofxNDIutils::AudioFormat format,
+		bool bInterleaved = true, float gain = 1.0f, bool bDither = false);
+
 	// The NDI SDK version number
 	std::string GetNDIversion();
 
@@ -230,11 +242,13 @@ private :
 
 	bool GetPixelData(ofTexture &texture);
 	bool LoadTexturePixels(GLuint TextureID, GLuint TextureTarget, 
-		unsigned int width, unsigned int height, unsigned char* data, int GLformat = GL_BGRA);
+		unsigned int width, unsigned int height, unsigned char* data, int GLformat = GL_BGRA,
+		unsigned int sourcePitch = 0);
 	GLuint m_pbo[2]; // PBOs used for asynchronous pixel load
 	int PboIndex = 0; // Index used for asynchronous pixel load
 	int NextPboIndex = 0;
 	bool m_bUpload = false; // Asynchronous upload of pixels to texture using two PBOs
+	ofPixels m_rgbaBuffer; // YUV formats converted to rgba for texture load
 
 };
 
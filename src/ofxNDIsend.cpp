@@ -101,16 +101,123 @@
 	27/05/24	- ReleaseSender - clear metadata
 				- CreateSender - add sender name to metadata
 	16.09.24	- SetVideoStride - remove test for global format
+	15.10.26	- SendImage - convert RGBA to UYVY or UYVA for YUV output formats
+				- Add SendVideoFrame for data already in the output format
+				- Add SetYUVmatrix
+				- SetVideoStride - UYVA line stride is that of the UYVY plane
+				- Common code in ResizeFrame, AllocateFrame and SubmitFrame
+				- Always use the local buffer for rgba<>bgra and invert
+				- Add 16 bit and float SendImage for P216 and PA16 output
+				- SetVideoStride - P216 and PA16 line stride is that of the Y plane
+				- SendImage - single pass CopyImage for pitch, bgra and invert
+				  Pitched source lines are copied if they differ from the frame stride
+				- Add SetInvertInPlace to flip the caller's buffer without a local copy
+				- Add SetColorimetry for matrix and range. SetYUVmatrix sets the matrix only.
+				- Add SetPacing to hold the frame rate in async mode with a FramePacer
+				- Stage timers "send.convert" and "send.submit"
+				- Add SetFrameBuffers. Async frames rotate through 2 to 4 aligned
+				  local buffers so that a frame is not converted into the buffer
+				  NDI is sending from. AllocateFrame selects the next buffer.
+				- SetAsync - wait for the async frame when async is disabled
+				- Add LeaseFrame, SendLeasedFrame, CancelLease, SetReleaseCallback
+				  and IsFrameReleased. The application renders into aligned buffers
+				  from a pool and is notified when NDI has released each buffer.
+				- Add WaitAsyncFrame for all waits on the async frame
+	16.10.26	- Add SetWorkerThread to send from a worker thread with a bounded queue
+				  Add SetSendQueue for the queue size and QUEUE_DROP_OLDEST,
+				  QUEUE_DROP_NEWEST or QUEUE_BLOCK when full. Add GetQueueCounters.
+				- UpdateSender, SetFormat and ReleaseSender wait for a frame being sent
+				- Add SetAudioFifo and PushAudio. Audio is sent from a lock-free FIFO
+				  in chunks of the frame duration, with audio and video timecodes
+				  from the video frame timeline.
+				- Add SetConnectionSkip. Conversion and sending are skipped while
+				  no receivers are connected. send_get_no_connections is polled
+				  at an interval and the count cached. Add GetConnections,
+				  SkipFrame and GetSkippedFrames.
+				- Add SetTallyPolicy. Tally is polled with the connections and
+				  senders not on program send one frame in a divisor, at a
+				  reduced frame rate and optionally a reduced size.
+				  Add GetTally, GetTallyDivisor and GetTallySkipped.
+				- Use the shared runtime from ofxNDIdynloader::Acquire. The runtime
+				  is loaded by the first CreateSender instead of the constructor.
+				- Add SetFrameInfo with a FrameInfo timecode and metadata for the
+				  next video frame, and SendImage, SendVideoFrame and SendLeasedFrame
+				  overloads with a FrameInfo. Queued frames keep their own FrameInfo.
+				- SkipFrame - discard a pass left by a frame that was not sent.
+				  Add CancelFrame.
+				- LeaseFrame and SendLeasedFrame - buffers of the sender size, not
+				  the video frame size, which the tally policy may have scaled
+				- LoadRuntime - try the shared runtime once for each sender
+				- CompleteLease - read the buffer before the slot is free
+				- SubmitFrame - pace at the frame rate reduced by the tally policy
+				- SkipSend - hold the frame rate for frames skipped while not connected
 
 */
 #include "ofxNDIsend.h"
 
+// Copy lines of video data of any length with option to invert
+static void CopyFrameLines(const unsigned char* src, unsigned char* dst,
+	unsigned int lineBytes, unsigned int height, bool bInvert)
+{
+	if (lineBytes % 4 == 0) {
+		ofxNDIutils::CopyImage((const void*)src, (void*)dst, lineBytes / 4, height, lineBytes, lineBytes, bInvert);
+	}
+	else {
+		for (unsigned int y = 0; y < height; y++) {
+			const unsigned char* line = src + (size_t)(bInvert ? height - 1 - y : y) * lineBytes;
+			memcpy((void*)(dst + (size_t)y * lineBytes), (const void*)line, lineBytes);
+		}
+	}
+}
+
+// Bytes for a video frame of a format
+// UYVA alpha plane follows the UYVY data
+// P216 UV plane and PA16 alpha plane follow the Y plane
+static size_t FormatFrameSize(NDIlib_FourCC_video_type_e format,
+	unsigned int width, unsigned int height)
+{
+	const size_t pixels = (size_t)width * height;
+	switch (format) {
+		case NDIlib_FourCC_video_type_UYVY:
+			return pixels * 2;
+		case NDIlib_FourCC_video_type_UYVA:
+			return pixels * 3;
+		case NDIlib_FourCC_video_type_P216:
+			return pixels * 4;
+		case NDIlib_FourCC_video_type_PA16:
+			return pixels * 6;
+		default:
+			return pixels * 4;
+	}
+}
 
 ofxNDIsend::ofxNDIsend()
 {
 	p_NDILib = nullptr;
 	pNDI_send = nullptr;
 	p_frame = nullptr;
+	for (unsigned int i = 0; i < MaxFrameBuffers; i++)
+		m_frameBuffers[i] = nullptr;
+	m_nFrameBuffers = 2;
+	m_FrameIndex = 0;
+	for (unsigned int i = 0; i < MaxLeaseFrames; i++) {
+		m_Leases[i].data = nullptr;
+		m_Leases[i].size = 0;
+		m_Leases[i].state = LEASE_FREE;
+	}
+	m_LeaseInFlight = -1;
+	m_ReleaseCallback = nullptr;
+	m_ReleaseUserData = nullptr;
+#if defined(USE_THREADS)
+	m_bWorker = false;
+	m_nQueueFrames = 2;
+	m_QueuePolicy = QUEUE_DROP_OLDEST;
+	m_bWorkerQuit = false;
+	m_QueueEnqueued = 0;
+	m_QueueSent = 0;
+	m_QueueDropped = 0;
+	m_pSendingFrame = nullptr;
+#endif
 	m_frame_rate_N = 60000; // 60 fps default : 30000 - 29.97 fps
 	m_frame_rate_D = 1000; // 1001 - 29.97 fps
 	m_horizontal_aspect = 1; // source aspect ratio by default
@@ -119,9 +226,15 @@ ofxNDIsend::ofxNDIsend()
 	m_bProgressive = true; // progressive default
 	m_bClockVideo = true; // clock video default
 	m_bAsync = false;
+#ifdef USE_CHRONO
+	m_bPacing = false;
+#endif
+	m_bInvertInPlace = false;
 	m_bMetadata = false;
 	m_Format = NDIlib_FourCC_video_type_RGBA; // Default output format
+	m_Colorimetry = ofxNDIutils::YUVcolorimetry(); // BT.601 for SD, BT.709 for HD, limited range
 	m_bNDIinitialized = false;
+	m_bNDIloadTried = false;
 	m_Width = m_Height = 0;
 	bSenderInitialized = false;
 
@@ -132,11 +245,36 @@ ofxNDIsend::ofxNDIsend()
 	m_AudioSamples = 1602; // Default up to 1602 samples for NTSC 29.97, can be changed on the fly
 	m_AudioTimecode = NDIlib_send_timecode_synthesize; // Timecode (synthesized for us !)
 	m_AudioData = nullptr; // Audio buffer
-
-	// Find and load the Newtek NDI dll
-    p_NDILib = libloader.Load();
-	if(p_NDILib)
-		m_bNDIinitialized = true;
+	m_bAudioFifo = false; // Audio from SetAudioData
+	m_bTimeline = false;
+	m_TimeOrigin = 0;
+	m_TimelineN = m_TimelineD = 0;
+	m_VideoTime = 0;
+	m_VideoFrames = 0;
+	m_AudioChunks = 0;
+	m_AudioSent = 0;
+
+	// Connection skip
+	m_bConnectionSkip = false;
+	m_ConnectionInterval = 1000;
+	m_SkippedFrames = 0;
+	m_SkippedSent = 0;
+	m_bTallyPolicy = false;
+	m_TallyDivisor = 1;
+	m_TallyScale = 1;
+	m_PreviewDivisor = 2;
+	m_IdleDivisor = 4;
+	m_bTallyScale = false;
+	m_TallyCount = 0;
+	m_TallySkipped = 0;
+	m_TallySent = 0;
+	ResetConnections();
+
+	// Frame timecode and metadata
+	m_bFrameInfo = false;
+	m_FrameMetadataIndex = 0;
+
+	// The NDI runtime is loaded by the first CreateSender
 
 }
 
@@ -148,7 +286,16 @@ ofxNDIsend::~ofxNDIsend()
 		ReleaseSender();
 	bSenderInitialized = false;
 
-	// Library is released in ofxNDIdynloader
+#if defined(USE_THREADS)
+	// Stop the worker thread
+	StopWorker();
+	FreeQueue();
+#endif
+
+	// Release the shared runtime
+	if (p_NDILib)
+		ofxNDIdynloader::Release();
+	p_NDILib = nullptr;
 	m_bNDIinitialized = false;
 
 }
@@ -156,7 +303,7 @@ ofxNDIsend::~ofxNDIsend()
 // Create an RGBA sender
 bool ofxNDIsend::CreateSender(const char *sendername, unsigned int width, unsigned int height)
 {
-	if (!m_bNDIinitialized) {
+	if (!LoadRuntime()) {
 		printf("ofxNDIsend::CreateSender - not initialized\n");
 		return false;
 	}
@@ -217,8 +364,7 @@ bool ofxNDIsend::CreateSender(const char *sendername, unsigned int width, unsign
 		p_NDILib->send_add_connection_metadata(pNDI_send, &NDI_connection_type);
 		
 		// Create an non-interlaced frame at 60fps
-		if(p_frame) free((void *)p_frame);
-		p_frame = nullptr; // invert  buffer
+		ReleaseFrames(); // conversion and invert buffers
 
 		// Dimensions
 		video_frame.xres = (int)width;
@@ -233,7 +379,7 @@ bool ofxNDIsend::CreateSender(const char *sendername, unsigned int width, unsign
 
 		// Framerate
 		video_frame.frame_rate_N = m_frame_rate_N; // (default 60fps)
-		video_frame.frame_rate_D = m_frame_rate_D;
+		video_frame.frame_rate_D = m_frame_rate_D * (int)m_TallyDivisor.load();
 		video_frame.picture_aspect_ratio = m_picture_aspect_ratio; // default source (width/height)
 
 		// 24-1-17 SDK Change to NDI v2
@@ -249,6 +395,7 @@ bool ofxNDIsend::CreateSender(const char *sendername, unsigned int width, unsign
 		// Keep the sender dimensions locally
 		m_Width = width;
 		m_Height = height;
+		ResetConnections();
 		bSenderInitialized = true;
 
 		if(m_bAudio) {
@@ -280,6 +427,11 @@ bool ofxNDIsend::UpdateSender(unsigned int width, unsigned int height)
 	if (width == 0 || height == 0)
 		return false;
 
+#if defined(USE_THREADS)
+	// Wait for a frame being sent by the worker thread
+	std::lock_guard<std::mutex> lock(m_SendMutex);
+#endif
+
 	if(pNDI_send && m_bAsync) {
 		// NDI documentation :
 		// Because one buffer is in flight we need to make sure that 
@@ -287,12 +439,11 @@ bool ofxNDIsend::UpdateSender(unsigned int width, unsigned int height)
 		// You can ensure this either by sending another frame, or just by
 		// sending a frame with a NULL pointer, which will wait for any 
 		// unscheduled asynchronous frames to be completed before returning.
-		p_NDILib->send_send_video_async_v2(pNDI_send, nullptr);
+		WaitAsyncFrame();
 	}
 
-	// Free the local invert buffer, it is re-created in SendImage if invert is needed
-	if(p_frame) free((void *)p_frame);
-	p_frame = nullptr;
+	// Free the local buffers, they are re-created in SendImage if needed
+	ReleaseFrames();
 	video_frame.p_data = nullptr;
 
 	// Update the sender dimensions
@@ -310,8 +461,9 @@ bool ofxNDIsend::UpdateSender(unsigned int width, unsigned int height)
 	SetVideoStride(m_Format);
 	
 	// Reset frame rate
+	// Reduced by the tally policy
 	video_frame.frame_rate_N = m_frame_rate_N;
-	video_frame.frame_rate_D = m_frame_rate_D;
+	video_frame.frame_rate_D = m_frame_rate_D * (int)m_TallyDivisor.load();
 
 	// Re-calculate aspect ratio
 	if (m_horizontal_aspect == 1 && m_vertical_aspect == 1)
@@ -349,30 +501,44 @@ bool ofxNDIsend::SendImage(const unsigned char * pixels,
 		return false;
 
 	if (pNDI_send && bSenderInitialized && pixels && width > 0 && height > 0) {
+
+		// Nothing to do without receivers or for the tally policy
+		if (SkipSend())
+			return true;
+
+#if defined(USE_THREADS)
+		// Queue a copy for the worker thread
+		if (m_bWorker && !IsWorkerThread())
+			return QueueFrame(QUEUED_RGBA, pixels, width, height, width * 4, bSwapRB, bInvert);
+#endif
+
+		// Reduced size for the tally policy
+		if (m_TallyScale > 1)
+			return SendScaled(pixels, width, height, width * 4, bSwapRB, bInvert);
+
 		// Allow for forgotten UpdateSender
-		if (video_frame.xres != (int)width || video_frame.yres != (int)height) {
-			video_frame.xres = (int)width;
-			video_frame.yres = (int)height;
-			video_frame.FourCC = m_Format;
-			SetVideoStride(m_Format);
-			// Release pframe for invert because the size is different
-			// It will be re-created at the correct size
-			if (p_frame) free((void *)p_frame);
-			p_frame = nullptr;
+		ResizeFrame(width, height);
+
+		OFXNDI_TIMER(convert, "send.convert");
+		if (m_Format == NDIlib_FourCC_video_type_UYVY || m_Format == NDIlib_FourCC_video_type_UYVA) {
+			// Convert rgba or bgra to YUV in the local buffer
+			// with invert if required
+			if (!AllocateFrame())
+				return false;
+			ConvertToYUV(pixels, width * 4, bSwapRB, bInvert);
 		}
-
-		if (bSwapRB || bInvert) {
+		else if (bInvert && !bSwapRB && m_bInvertInPlace) {
+			// Flip the caller's pixels and use them directly
+			ofxNDIutils::FlipVertical((void*)pixels, width * 4, height);
+			video_frame.p_data = (uint8_t*)pixels;
+		}
+		else if (bSwapRB || bInvert) {
 			// Local memory buffer is only needed for rgba to bgra or invert
-			if (!p_frame) {
-				p_frame = (uint8_t*)malloc((size_t)width * (size_t)height * 4L * sizeof(unsigned char));
-				if (!p_frame) {
-					printf("Out of memory in SendImage\n");
-					return false;
-				}
-				video_frame.p_data = p_frame;
-			}
-			ofxNDIutils::CopyImage((const unsigned char *)pixels, (unsigned char *)video_frame.p_data,
-				width, height, (unsigned int)video_frame.line_stride_in_bytes, bSwapRB, bInvert);
+			if (!AllocateFrame())
+				return false;
+			ofxNDIutils::CopyImage((const void *)pixels, (void *)p_frame, width, height,
+				width * 4, (unsigned int)video_frame.line_stride_in_bytes, bSwapRB, bInvert);
+			video_frame.p_data = p_frame;
 		}
 		else {
 			// No bgra conversion or invert, so use the pointer directly
@@ -382,39 +548,10 @@ bool ofxNDIsend::SendImage(const unsigned char * pixels,
 			// char fourChar[5] = { (aCode >> 24) & 0xFF, (aCode >> 16) & 0xFF, (aCode >> 8) & 0xFF, aCode & 0xFF, 0 };
 			// printf("    SendImage format FourCC = %d (%s)\n", video_frame.FourCC, fourChar); // 1094862674, 1094862674
 		}
+		OFXNDI_TIMER_STOP(convert);
 
-		// Submit the audio buffer first.
-		// Refer to the NDI SDK example where for 48000 sample rate
-		// and 29.97 fps, an alternating sample number is used.
-		// Do this in the application using SetAudioSamples(nSamples);
-		// General reference : http://jacklinstudios.com/docs/post-primer.html
-		if (m_bAudio && m_audio_frame.p_data != nullptr) {
-			p_NDILib->send_send_audio_v2(pNDI_send, &m_audio_frame);
-		}
-
-		// Metadata
-		if (m_bMetadata && !m_metadataString.empty()) {
-			metadata_frame.length = (int)m_metadataString.size();
-			metadata_frame.timecode = NDIlib_send_timecode_synthesize;
-			metadata_frame.p_data = (char *)m_metadataString.c_str(); // XML message format
-			p_NDILib->send_send_metadata(pNDI_send, &metadata_frame);
-		}
-
-		if (m_bAsync) {
-			// Submit the frame asynchronously. This means that this call will return 
-			// immediately and the API will "own" the memory location until there is
-			// a synchronizing event. A synchronizing event is one of : 
-			//  - NDIlib_send_send_video_async
-			//  - NDIlib_send_send_video, NDIlib_send_destroy.
-			// NDIlib_send_send_video_async_v2 will wait for the previous frame to finish
-			// before submitting the current one.
-			p_NDILib->send_send_video_async_v2(pNDI_send, &video_frame);
-		}
-		else {
-			// Submit the frame. Note that this call will be clocked
-			// so that we end up submitting at exactly the predetermined fps.
-			p_NDILib->send_send_video_v2(pNDI_send, &video_frame);
-		}
+		// Audio, metadata and video
+		SubmitFrame();
 
 		return true;
 	}
@@ -449,61 +586,147 @@ bool ofxNDIsend::SendImage(const unsigned char * pixels,
 
 	if (pNDI_send && bSenderInitialized && pixels && width > 0 && height > 0) {
 
+		// Nothing to do without receivers or for the tally policy
+		if (SkipSend())
+			return true;
+
+#if defined(USE_THREADS)
+		// Queue a copy for the worker thread
+		if (m_bWorker && !IsWorkerThread())
+			return QueueFrame(QUEUED_RGBA_PITCH, pixels, width, height, sourcePitch, false, bInvert);
+#endif
+
+		// Reduced size for the tally policy
+		if (m_TallyScale > 1)
+			return SendScaled(pixels, width, height, sourcePitch, false, bInvert);
+
 		// Allow for forgotten UpdateSender
-		if (video_frame.xres != (int)width || video_frame.yres != (int)height) {
-			video_frame.xres = (int)width;
-			video_frame.yres = (int)height;
-			video_frame.FourCC = m_Format;
-			SetVideoStride(m_Format);
-			// Free pframe for invert because the size is different
-			// It is re-created in SendImage if invert is needed
-			if (p_frame) free((void *)p_frame);
-			p_frame = nullptr;
+		ResizeFrame(width, height);
+
+		OFXNDI_TIMER(convert, "send.convert");
+		if (m_Format == NDIlib_FourCC_video_type_UYVY || m_Format == NDIlib_FourCC_video_type_UYVA) {
+			// Convert to YUV in the local buffer
+			if (!AllocateFrame())
+				return false;
+			ConvertToYUV(pixels, sourcePitch, false, bInvert);
 		}
-
-		if (bInvert) {
-			// Local memory buffer is only needed for invert
-			if (!p_frame) {
-				p_frame = (uint8_t*)malloc((size_t)sourcePitch * (size_t)height * sizeof(unsigned char));
-				if (!p_frame) {
-					printf("Out of memory in SendImage\n");
-					return false;
-				}
-			}
-			// Flip from the sending buffer to the invert buffer
-			ofxNDIutils::FlipBuffer(pixels, p_frame, width, height);
-			// Use the invert buffer as the source of video data
+		else if (bInvert && m_bInvertInPlace && sourcePitch == (unsigned int)video_frame.line_stride_in_bytes) {
+			// Flip the caller's pixels and use them directly
+			ofxNDIutils::FlipVertical((void*)pixels, width * 4, height, sourcePitch);
+			video_frame.p_data = (uint8_t*)pixels;
+		}
+		else if (bInvert || sourcePitch != (unsigned int)video_frame.line_stride_in_bytes) {
+			// Local memory buffer is only needed for invert or padded source lines
+			if (!AllocateFrame())
+				return false;
+			// Copy and flip from the sending buffer to the local buffer in one pass
+			ofxNDIutils::CopyImage((const void*)pixels, (void*)p_frame, width, height,
+				sourcePitch, (unsigned int)video_frame.line_stride_in_bytes, false, bInvert);
+			// Use the local buffer as the source of video data
 			video_frame.p_data = (uint8_t*)p_frame;
 		}
 		else {
-			// No invert, so use the source pointer directly
+			// No invert or line padding, so use the source pointer directly
 			video_frame.p_data = (uint8_t*)pixels;
 		}
+		OFXNDI_TIMER_STOP(convert);
 
-		// Submit the audio buffer first.
-		// See comments in SendImage above
-		if (m_bAudio && m_audio_frame.p_data != nullptr) {
-			p_NDILib->send_send_audio_v2(pNDI_send, &m_audio_frame);
-		}
+		// Audio, metadata and video
+		SubmitFrame();
 
-		// Metadata
-		if (m_bMetadata && !m_metadataString.empty()) {
-			metadata_frame.length = (int)m_metadataString.size();
-			metadata_frame.timecode = NDIlib_send_timecode_synthesize;
-			metadata_frame.p_data = (char *)m_metadataString.c_str(); // XML message format
-			p_NDILib->send_send_metadata(pNDI_send, &metadata_frame);
-		}
+		return true;
+	}
+
+	return false;
+}
 
-		if (m_bAsync) {
-			// Submit the frame asynchronously. 
-			// See comments in SendImage above
-			p_NDILib->send_send_video_async_v2(pNDI_send, &video_frame);
+// Send 16 bit image pixels for P216 or PA16 output format
+// - image   : 16 bit RGBA pixel data
+// - width   : image width
+// - height  : image height
+// - pitch   : source buffer pitch (0 for width*8)
+// - bInvert : flip the image - default false
+bool ofxNDIsend::SendImage(const uint16_t * pixels,
+	unsigned int width, unsigned int height,
+	unsigned int sourcePitch, bool bInvert)
+{
+	return SendHighBitDepth(pixels, false, width, height, sourcePitch, bInvert);
+}
+
+// Send float image pixels for P216 or PA16 output format
+// - image   : float RGBA pixel data
+// - width   : image width
+// - height  : image height
+// - pitch   : source buffer pitch (0 for width*16)
+// - bInvert : flip the image - default false
+bool ofxNDIsend::SendImage(const float * pixels,
+	unsigned int width, unsigned int height,
+	unsigned int sourcePitch, bool bInvert)
+{
+	return SendHighBitDepth(pixels, true, width, height, sourcePitch, bInvert);
+}
+
+// Send video data that is already in the output format
+// - data    : video data with the line stride of the format
+//             (e.g. UYVY from the rgba2yuv shader)
+// - width   : image width
+// - height  : image height
+// - bInvert : flip the image - default false
+bool ofxNDIsend::SendVideoFrame(const unsigned char * data,
+	unsigned int width, unsigned int height, bool bInvert)
+{
+	if (!m_bNDIinitialized)
+		return false;
+
+	if (pNDI_send && bSenderInitialized && data && width > 0 && height > 0) {
+
+		// Nothing to do without receivers or for the tally policy
+		if (SkipSend())
+			return true;
+
+#if defined(USE_THREADS)
+		// Queue a copy for the worker thread
+		if (m_bWorker && !IsWorkerThread())
+			return QueueFrame(QUEUED_VIDEO, data, width, height, 0, false, bInvert);
+#endif
+
+		// Allow for forgotten UpdateSender
+		ResizeFrame(width, height);
+
+		OFXNDI_TIMER(convert, "send.convert");
+		if (bInvert) {
+			if (!m_bInvertInPlace && !AllocateFrame())
+				return false;
+			// Line bytes of each plane
+			// UYVA alpha plane follows the UYVY data
+			// P216 UV plane and PA16 alpha plane follow the Y plane with the same stride
+			const unsigned int stride = (unsigned int)video_frame.line_stride_in_bytes;
+			unsigned int lineBytes[3] = { stride, stride, stride };
+			unsigned int planes = 1;
+			if (m_Format == NDIlib_FourCC_video_type_UYVA) {
+				lineBytes[1] = width;
+				planes = 2;
+			}
+			else if (m_Format == NDIlib_FourCC_video_type_P216)
+				planes = 2;
+			else if (m_Format == NDIlib_FourCC_video_type_PA16)
+				planes = 3;
+			size_t offset = 0;
+			for (unsigned int i = 0; i < planes; i++) {
+				if (m_bInvertInPlace)
+					ofxNDIutils::FlipVertical((void*)(data + offset), lineBytes[i], height);
+				else
+					CopyFrameLines(data + offset, p_frame + offset, lineBytes[i], height, true);
+				offset += (size_t)lineBytes[i] * height;
+			}
+			video_frame.p_data = m_bInvertInPlace ? (uint8_t*)data : p_frame;
 		}
 		else {
-			// Submit the frame. Note that this call will be clocked
-			// See comments in SendImage above
-			p_NDILib->send_send_video_v2(pNDI_send, &video_frame);
+			video_frame.p_data = (uint8_t*)data;
 		}
+		OFXNDI_TIMER_STOP(convert);
+
+		SubmitFrame();
 
 		return true;
 	}
@@ -511,9 +734,141 @@ bool ofxNDIsend::SendImage(const unsigned char * pixels,
 	return false;
 }
 
+// Lease a frame buffer from the sender's pool
+// Aligned buffer for a frame of the current format and size
+unsigned char* ofxNDIsend::LeaseFrame()
+{
+	if (!m_bNDIinitialized || !pNDI_send || !bSenderInitialized)
+		return nullptr;
+
+	const size_t size = LeaseSize();
+	for (unsigned int i = 0; i < MaxLeaseFrames; i++) {
+		FrameLease& lease = m_Leases[i];
+		if (lease.state != LEASE_FREE)
+			continue;
+		// Re-create the buffer if the size or format has changed
+		if (lease.data && lease.size != size) {
+			ofxNDIutils::AlignedFree(lease.data);
+			lease.data = nullptr;
+		}
+		if (!lease.data) {
+			lease.data = (uint8_t*)ofxNDIutils::AlignedAlloc(size);
+			if (!lease.data) {
+				printf("Out of memory in LeaseFrame\n");
+				return nullptr;
+			}
+			lease.size = size;
+		}
+		lease.state = LEASE_HELD;
+		return lease.data;
+	}
+
+	// All buffers are leased or in flight
+	return nullptr;
+}
+
+// Send a leased frame buffer without copying
+bool ofxNDIsend::SendLeasedFrame(unsigned char* buffer)
+{
+	const int index = FindLease(buffer);
+	if (index < 0 || m_Leases[index].state != LEASE_HELD) {
+		printf("ofxNDIsend::SendLeasedFrame - buffer is not leased\n");
+		return false;
+	}
+
+	if (!m_bNDIinitialized || !pNDI_send || !bSenderInitialized) {
+		m_Leases[index].state = LEASE_FREE;
+		return false;
+	}
+
+	// Nothing to do without receivers or for the tally policy.
+	// The buffer is released.
+	if (SkipSend()) {
+		CompleteLease(index);
+		return true;
+	}
+
+	m_Leases[index].state = LEASE_SENT;
+
+#if defined(USE_THREADS)
+	// The worker thread sends the buffer without copying
+	if (m_bWorker && !IsWorkerThread())
+		return QueueFrame(QUEUED_LEASE, buffer, 0, 0, 0, false, false);
+#endif
+
+	return SubmitLease(index);
+}
+
+// Set the timecode and metadata of the next video frame sent
+void ofxNDIsend::SetFrameInfo(const FrameInfo& info)
+{
+	m_FrameInfo = info;
+	m_bFrameInfo = true;
+}
+
+// Send image pixels with a timecode and metadata
+// - info    : timecode and metadata of this frame
+bool ofxNDIsend::SendImage(const unsigned char* pixels,
+	unsigned int width, unsigned int height,
+	const FrameInfo& info, bool bSwapRB, bool bInvert)
+{
+	SetFrameInfo(info);
+	const bool bResult = SendImage(pixels, width, height, bSwapRB, bInvert);
+	// Not used by a frame that was not sent
+	m_bFrameInfo = false;
+	return bResult;
+}
+
+// Send video data with a timecode and metadata
+bool ofxNDIsend::SendVideoFrame(const unsigned char* data,
+	unsigned int width, unsigned int height,
+	const FrameInfo& info, bool bInvert)
+{
+	SetFrameInfo(info);
+	const bool bResult = SendVideoFrame(data, width, height, bInvert);
+	m_bFrameInfo = false;
+	return bResult;
+}
+
+// Send a leased frame buffer with a timecode and metadata
+bool ofxNDIsend::SendLeasedFrame(unsigned char* buffer, const FrameInfo& info)
+{
+	SetFrameInfo(info);
+	const bool bResult = SendLeasedFrame(buffer);
+	m_bFrameInfo = false;
+	return bResult;
+}
+
+// Return a leased buffer to the pool without sending it
+void ofxNDIsend::CancelLease(unsigned char* buffer)
+{
+	const int index = FindLease(buffer);
+	if (index >= 0 && m_Leases[index].state == LEASE_HELD)
+		m_Leases[index].state = LEASE_FREE;
+}
+
+// Set a function to be called when a leased buffer is released
+void ofxNDIsend::SetReleaseCallback(FrameReleaseCallback callback, void* userdata)
+{
+	m_ReleaseCallback = callback;
+	m_ReleaseUserData = userdata;
+}
+
+// Whether a leased buffer has been released
+bool ofxNDIsend::IsFrameReleased(const unsigned char* buffer)
+{
+	return FindLease(buffer) < 0;
+}
+
 // Close sender and release resources
 void ofxNDIsend::ReleaseSender()
 {
+#if defined(USE_THREADS)
+	// Discard queued frames and wait for a frame being sent
+	ClearQueue();
+	std::lock_guard<std::mutex> lock(m_SendMutex);
+#endif
+
 	bSenderInitialized = false; // Do this now so no more frames are sent
 
 	if (!m_bNDIinitialized) return;
@@ -528,11 +883,11 @@ void ofxNDIsend::ReleaseSender()
 	if (pNDI_send)
 		p_NDILib->send_destroy(pNDI_send);
 	pNDI_send = nullptr;
+	ResetConnections();
 
-	// Release the invert buffer
-	if (p_frame)
-		free((void*)p_frame);
-	p_frame = nullptr;
+	// Release the local buffers and leased buffers
+	ReleaseFrames();
+	FreeLeases();
 
 	// Reset sender dimensions
 	m_Width = m_Height = 0;
@@ -582,9 +937,20 @@ std::string ofxNDIsend::GetNDIname()
 // Set video frame format
 //  Default NDIlib_FourCC_video_type_RGBA
 //  Can be NDIlib_FourCC_video_type_BGRA to match texture format
-//  NDIlib_FourCC_video_type_UYVY with OpenFrameworks shaders only
+//  NDIlib_FourCC_video_type_UYVY or NDIlib_FourCC_video_type_UYVA
+//  rgba pixels are converted by SendImage
+//  NDIlib_FourCC_video_type_P216 or NDIlib_FourCC_video_type_PA16
+//  16 bit and float pixels are converted by SendImage
 void ofxNDIsend::SetFormat(NDIlib_FourCC_video_type_e format)
 {
+#if defined(USE_THREADS)
+	// Wait for a frame being sent by the worker thread
+	std::lock_guard<std::mutex> lock(m_SendMutex);
+#endif
+	// The local buffer size depends on the format
+	// It is re-created at the correct size when needed
+	if (format != m_Format)
+		ReleaseFrames();
 	m_Format = format;
 	// For debugging
 	// NDI_LIB_FOURCC(ch0, ch1, ch2, ch3)
@@ -600,6 +966,33 @@ NDIlib_FourCC_video_type_e ofxNDIsend::GetFormat()
 	return m_Format;
 }
 
+// Set YUV colour matrix for UYVY, UYVA, P216 and PA16 output
+//  Default YUV_MATRIX_AUTO
+//  BT.601 for SD (width < 1920) and BT.709 for HD
+void ofxNDIsend::SetYUVmatrix(ofxNDIutils::YUVmatrix matrix)
+{
+	m_Colorimetry.matrix = matrix;
+}
+
+// Get YUV colour matrix
+ofxNDIutils::YUVmatrix ofxNDIsend::GetYUVmatrix()
+{
+	return m_Colorimetry.matrix;
+}
+
+// Set YUV colorimetry for UYVY, UYVA, P216 and PA16 output
+//  Default YUV_MATRIX_AUTO and YUV_RANGE_LIMITED
+void ofxNDIsend::SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry)
+{
+	m_Colorimetry = colorimetry;
+}
+
+// Get YUV colorimetry
+ofxNDIutils::YUVcolorimetry ofxNDIsend::GetColorimetry()
+{
+	return m_Colorimetry;
+}
+
 // Set frame rate - frames per second whole number
 void ofxNDIsend::SetFrameRate(int framerate)
 {
@@ -681,6 +1074,10 @@ bool ofxNDIsend::GetClockVideo()
 // Set asynchronous sending mode
 void ofxNDIsend::SetAsync(bool bActive)
 {
+	// Wait for the async frame to complete before
+	// clocked frames re-use the first local buffer
+	if (m_bAsync && !bActive)
+		WaitAsyncFrame();
 	m_bAsync = bActive;
 }
 
@@ -690,6 +1087,59 @@ bool ofxNDIsend::GetAsync()
 	return m_bAsync;
 }
 
+#ifdef USE_CHRONO
+// Set to hold the frame rate in async sending mode
+void ofxNDIsend::SetPacing(bool bPacing)
+{
+	m_bPacing = bPacing;
+	m_Pacer.Reset();
+}
+
+// Get whether async frames are paced
+bool ofxNDIsend::GetPacing()
+{
+	return m_bPacing;
+}
+
+// Number of frame deadlines missed by the pacer
+uint64_t ofxNDIsend::GetMissedFrames()
+{
+	return m_Pacer.GetMissedCount();
+}
+#endif
+
+// Set the number of local buffers used in rotation for async sending
+void ofxNDIsend::SetFrameBuffers(unsigned int nBuffers)
+{
+	if (nBuffers < 2)
+		nBuffers = 2;
+	if (nBuffers > MaxFrameBuffers)
+		nBuffers = MaxFrameBuffers;
+	if (nBuffers != m_nFrameBuffers) {
+		ReleaseFrames();
+		m_nFrameBuffers = nBuffers;
+	}
+}
+
+// Get the number of local buffers for async sending
+unsigned int ofxNDIsend::GetFrameBuffers()
+{
+	return m_nFrameBuffers;
+}
+
+// Set to flip the image being sent in place for invert
+// The caller's buffer is modified instead of copying to the local buffer
+void ofxNDIsend::SetInvertInPlace(bool bInPlace)
+{
+	m_bInvertInPlace = bInPlace;
+}
+
+// Get whether invert is done in place
+bool ofxNDIsend::GetInvertInPlace()
+{
+	return m_bInvertInPlace;
+}
+
 // Set to send Audio
 void ofxNDIsend::SetAudio(bool bAudio)
 {
@@ -752,6 +1202,41 @@ void ofxNDIsend::SetAudioData(const float *data)
 	m_audio_frame.p_data = (float *)data;
 }
 
+// Set to send audio from a FIFO
+void ofxNDIsend::SetAudioFifo(bool bFifo, int capacity)
+{
+	m_bAudioFifo = false;
+	if (bFifo) {
+		m_AudioFifo.Allocate(m_AudioChannels, capacity > 0 ? capacity : m_AudioSampleRate);
+		m_bTimeline = false; // Restart at the next frame
+		m_bAudioFifo = true;
+	}
+	else {
+		// Return to timecodes synthesized by NDI
+		video_frame.timecode = NDIlib_send_timecode_synthesize;
+	}
+}
+
+// Get whether audio is sent from a FIFO
+bool ofxNDIsend::GetAudioFifo()
+{
+	return m_bAudioFifo;
+}
+
+// Push audio samples to the FIFO
+int ofxNDIsend::PushAudio(const float *data, int nSamples, bool bInterleaved, int channelStride)
+{
+	if (!m_bAudioFifo)
+		return 0;
+	return m_AudioFifo.Push(data, nSamples, bInterleaved, channelStride);
+}
+
+// Samples per channel dropped because the FIFO was full
+uint64_t ofxNDIsend::GetAudioDropped()
+{
+	return m_AudioFifo.GetDropped();
+}
+
 // Set to send metadata
 void ofxNDIsend::SetMetadata(bool bMetadata)
 {
@@ -767,27 +1252,992 @@ void ofxNDIsend::SetMetadataString(std::string datastring)
 // Get the current NDI SDK version
 std::string ofxNDIsend::GetNDIversion()
 {
-	if (p_NDILib)
+	if (LoadRuntime())
 		return p_NDILib->version();
 	else
 		return "";
 }
 
+// Set to skip frames while no receivers are connected
+// - interval | milliseconds between polls of the connections
+void ofxNDIsend::SetConnectionSkip(bool bSkip, unsigned int interval)
+{
+	m_ConnectionInterval = interval;
+	m_bConnectionSkip = bSkip;
+	ResetConnections();
+}
+
+// Get whether unconnected frames are skipped
+bool ofxNDIsend::GetConnectionSkip()
+{
+	return m_bConnectionSkip;
+}
+
+// Milliseconds for the connection poll interval
+// -1 if there is no timer, to poll every time
+static int64_t ConnectionTime()
+{
+#ifdef USE_CHRONO
+	return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#elif defined(TARGET_WIN32)
+	return (int64_t)GetTickCount64();
+#else
+	return -1;
+#endif
+}
+
+// Number of receivers connected
+int ofxNDIsend::GetConnections()
+{
+	PollConnections();
+	return m_Connections.load();
+}
+
+// Whether to skip this frame because no receivers are connected
+// or for the tally policy. A frame that is not skipped is
+// passed by the next send function without a second check.
+bool ofxNDIsend::SkipFrame()
+{
+	// A pass left by a frame that was not sent is not used
+	m_bFramePassed = false;
+	if (SkipSend())
+		return true;
+	if (m_bConnectionSkip || m_bTallyPolicy)
+		m_bFramePassed = true;
+	return false;
+}
+
+// A frame passed by SkipFrame is not being sent
+void ofxNDIsend::CancelFrame()
+{
+	m_bFramePassed = false;
+}
+
+// Number of frames skipped while not connected
+uint64_t ofxNDIsend::GetSkippedFrames()
+{
+	return m_SkippedFrames.load();
+}
+
+// Set to reduce the frame rate by tally
+// - previewDivisor | frame rate divisor on preview only
+// - idleDivisor | frame rate divisor on neither program nor preview
+// - bScale | half size on preview and quarter size on neither
+void ofxNDIsend::SetTallyPolicy(bool bPolicy, unsigned int previewDivisor,
+	unsigned int idleDivisor, bool bScale)
+{
+	m_PreviewDivisor = (previewDivisor > 0) ? previewDivisor : 1;
+	m_IdleDivisor = (idleDivisor > 0) ? idleDivisor : 1;
+	m_bTallyScale = bScale;
+	m_bTallyPolicy = bPolicy;
+	// Full rate and size until the next poll
+	ResetConnections();
+	if (m_TallyDivisor != 1 || m_TallyScale != 1) {
+		m_TallyDivisor = 1;
+		m_TallyScale = 1;
+		if (bSenderInitialized)
+			UpdateSender(m_Width, m_Height);
+	}
+}
+
+// Get whether the tally policy is enabled
+bool ofxNDIsend::GetTallyPolicy()
+{
+	return m_bTallyPolicy;
+}
+
+// Tally of the sender
+void ofxNDIsend::GetTally(bool &bOnProgram, bool &bOnPreview)
+{
+	PollConnections();
+	bOnProgram = m_bOnProgram;
+	bOnPreview = m_bOnPreview;
+}
+
+// Frame rate divisor currently applied by the tally policy
+unsigned int ofxNDIsend::GetTallyDivisor()
+{
+	return m_TallyDivisor;
+}
+
+// Number of frames not sent because of the tally policy
+uint64_t ofxNDIsend::GetTallySkipped()
+{
+	return m_TallySkipped.load();
+}
+
 //
 // Private
 //
 
+// Acquire the shared NDI runtime if not already
+bool ofxNDIsend::LoadRuntime()
+{
+	// Tried once for each sender, as when the runtime was loaded
+	// by the constructor. A new sender tries again.
+	if (!m_bNDIinitialized && !m_bNDIloadTried) {
+		m_bNDIloadTried = true;
+		p_NDILib = ofxNDIdynloader::Acquire();
+		m_bNDIinitialized = (p_NDILib != nullptr);
+	}
+	return m_bNDIinitialized;
+}
+
+// Poll the connections at the next frame
+// Tally is reset to program, full rate and size
+void ofxNDIsend::ResetConnections()
+{
+	m_ConnectionPoll = -1;
+	m_Connections = 0;
+	m_bOnProgram = true;
+	m_bOnPreview = false;
+	m_bFramePassed = false;
+}
+
+// Poll connections and tally with no timeout at most once per interval.
+// One thread polls if several threads find the interval has passed.
+void ofxNDIsend::PollConnections()
+{
+	if (!m_bNDIinitialized || !pNDI_send || !bSenderInitialized)
+		return;
+
+	const int64_t now = ConnectionTime();
+	int64_t last = m_ConnectionPoll.load();
+	if (now >= 0 && last >= 0 && now - last < (int64_t)m_ConnectionInterval.load())
+		return;
+	if (!m_ConnectionPoll.compare_exchange_strong(last, now < 0 ? 0 : now) && now >= 0)
+		return;
+
+	m_Connections = p_NDILib->send_get_no_connections(pNDI_send, 0);
+	NDIlib_tally_t tally;
+	p_NDILib->send_get_tally(pNDI_send, &tally, 0);
+	m_bOnProgram = tally.on_program;
+	m_bOnPreview = tally.on_preview;
+}
+
+// Whether the send functions skip this frame
+// SkipFrame may have passed it already.
+bool ofxNDIsend::SkipSend()
+{
+	if (!m_bConnectionSkip && !m_bTallyPolicy)
+		return false;
+
+#if defined(USE_THREADS)
+	// Frames queued before the connections or tally changed are sent
+	if (IsWorkerThread())
+		return false;
+#endif
+
+	if (m_bFramePassed.exchange(false))
+		return false;
+
+	const int connections = GetConnections();
+	if (m_bConnectionSkip && connections == 0) {
+		m_SkippedFrames++;
+		m_bFrameInfo = false;
+		HoldSkippedFrame();
+		return true;
+	}
+
+	if (m_bTallyPolicy) {
+		ApplyTally();
+		const unsigned int divisor = m_TallyDivisor;
+		if (divisor > 1 && (m_TallyCount++ % divisor) != 0) {
+			m_TallySkipped++;
+			m_bFrameInfo = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Hold the frame rate for a frame skipped while not connected.
+// Sent frames are clocked by NDI or held by the pacer, so the
+// application cycle is held at the same rate while skipping.
+// Frames skipped by the tally policy are not held, because the
+// frames that are sent wait for the reduced frame rate.
+void ofxNDIsend::HoldSkippedFrame()
+{
+#ifdef USE_CHRONO
+	if (m_bClockVideo || (m_bAsync && m_bPacing)) {
+		m_SkipPacer.SetRate(m_frame_rate_N, m_frame_rate_D);
+		m_SkipPacer.Wait();
+	}
+#endif
+}
+
+// Frame rate and image size divisors for the current tally
+// The sender is updated with the reduced frame rate.
+void ofxNDIsend::ApplyTally()
+{
+	unsigned int divisor = 1;
+	unsigned int scale = 1;
+	if (!m_bOnProgram) {
+		divisor = m_bOnPreview ? m_PreviewDivisor : m_IdleDivisor;
+		if (m_bTallyScale)
+			scale = m_bOnPreview ? 2 : 4;
+	}
+	if (divisor == m_TallyDivisor && scale == m_TallyScale)
+		return;
+
+	m_TallyDivisor = divisor;
+	m_TallyScale = scale;
+	m_TallyCount = 0;
+	UpdateSender(m_Width, m_Height);
+}
+
+// Send 8 bit rgba or bgra at reduced size for the tally policy
+// The scaled image is converted for YUV formats.
+bool ofxNDIsend::SendScaled(const unsigned char* pixels, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, bool bSwapRB, bool bInvert)
+{
+	const unsigned int scale = m_TallyScale;
+	const unsigned int w = width / scale;
+	const unsigned int h = height / scale;
+	if (w == 0 || h == 0)
+		return false;
+
+	ResizeFrame(w, h);
+	if (!AllocateFrame())
+		return false;
+
+	OFXNDI_TIMER(convert, "send.convert");
+	if (m_Format == NDIlib_FourCC_video_type_UYVY || m_Format == NDIlib_FourCC_video_type_UYVA) {
+		m_TallyPixels.resize((size_t)w * h * 4);
+		ofxNDIutils::ScaleImage(pixels, m_TallyPixels.data(), width, height, sourcePitch, w, h, bSwapRB, bInvert);
+		ConvertToYUV(m_TallyPixels.data(), w * 4, false, false);
+	}
+	else {
+		ofxNDIutils::ScaleImage(pixels, p_frame, width, height, sourcePitch, w, h, bSwapRB, bInvert);
+		video_frame.p_data = p_frame;
+	}
+	OFXNDI_TIMER_STOP(convert);
+
+	SubmitFrame();
+	return true;
+}
+
 // Set video frame line stride in bytes.
 // Uses the global variable "video_frame".
 // Dimensions xres and yres must have been set already.
 void ofxNDIsend::SetVideoStride(NDIlib_FourCC_video_type_e format)
 {
 	// Stop async send before changing the video frame
-	if (pNDI_send && m_bAsync)
-		p_NDILib->send_send_video_async_v2(pNDI_send, nullptr);
-	if (format == NDIlib_FourCC_video_type_UYVY)
+	WaitAsyncFrame();
+	// UYVA alpha plane follows with stride xres
+	// P216 UV plane and PA16 alpha plane follow with the same stride
+	if (format == NDIlib_FourCC_video_type_UYVY || format == NDIlib_FourCC_video_type_UYVA
+		|| format == NDIlib_FourCC_video_type_P216 || format == NDIlib_FourCC_video_type_PA16)
 		video_frame.line_stride_in_bytes = video_frame.xres * 2;
 	else
 		video_frame.line_stride_in_bytes = video_frame.xres * 4;
 }
 
+// Reset the video frame for a change of image size
+// Allows for UpdateSender not called
+void ofxNDIsend::ResizeFrame(unsigned int width, unsigned int height)
+{
+	if (video_frame.xres != (int)width || video_frame.yres != (int)height) {
+		video_frame.xres = (int)width;
+		video_frame.yres = (int)height;
+		video_frame.FourCC = m_Format;
+		SetVideoStride(m_Format);
+		// Release the local buffers because the size is different
+		// They are re-created at the correct size when needed
+		ReleaseFrames();
+	}
+}
+
+// Local buffer for format conversion or invert.
+// NDI owns an async frame until the next send, so async
+// frames use the next buffer of the ring. Buffers are
+// created when first used.
+bool ofxNDIsend::AllocateFrame()
+{
+	m_FrameIndex = m_bAsync ? (m_FrameIndex + 1) % m_nFrameBuffers : 0;
+	if (!m_frameBuffers[m_FrameIndex]) {
+		m_frameBuffers[m_FrameIndex] = (uint8_t*)ofxNDIutils::AlignedAlloc(FrameSize());
+		if (!m_frameBuffers[m_FrameIndex]) {
+			printf("Out of memory in SendImage\n");
+			p_frame = nullptr;
+			return false;
+		}
+	}
+	p_frame = m_frameBuffers[m_FrameIndex];
+	return true;
+}
+
+// Free the local buffers
+void ofxNDIsend::ReleaseFrames()
+{
+	// NDI may still be sending from one of the buffers
+	WaitAsyncFrame();
+	for (unsigned int i = 0; i < MaxFrameBuffers; i++) {
+		ofxNDIutils::AlignedFree(m_frameBuffers[i]);
+		m_frameBuffers[i] = nullptr;
+	}
+	p_frame = nullptr;
+	m_FrameIndex = 0;
+}
+
+// Bytes for a frame of the current format and size
+size_t ofxNDIsend::FrameSize()
+{
+	return FormatFrameSize(m_Format, (unsigned int)video_frame.xres, (unsigned int)video_frame.yres);
+}
+
+// Bytes for a leased frame of the current format at the sender size
+size_t ofxNDIsend::LeaseSize()
+{
+	return FormatFrameSize(m_Format, m_Width, m_Height);
+}
+
+// Wait for NDI to finish with the async frame.
+// Sending a null frame waits for it to complete.
+// A leased buffer being sent is then released.
+void ofxNDIsend::WaitAsyncFrame()
+{
+	if (pNDI_send && m_bAsync)
+		p_NDILib->send_send_video_async_v2(pNDI_send, nullptr);
+	if (m_LeaseInFlight >= 0) {
+		CompleteLease(m_LeaseInFlight);
+		m_LeaseInFlight = -1;
+	}
+}
+
+// Index of a leased buffer or -1
+int ofxNDIsend::FindLease(const unsigned char* buffer)
+{
+	if (!buffer)
+		return -1;
+	for (int i = 0; i < (int)MaxLeaseFrames; i++) {
+		// The data of a free buffer can be changed by LeaseFrame
+		if (m_Leases[i].state != LEASE_FREE && m_Leases[i].data == buffer)
+			return i;
+	}
+	return -1;
+}
+
+// Return a sent lease to the pool and notify the application
+void ofxNDIsend::CompleteLease(int index)
+{
+	// Read the buffer before the slot is free. LeaseFrame may then
+	// reallocate it on the caller thread while this runs on the worker.
+	uint8_t* data = m_Leases[index].data;
+	m_Leases[index].state = LEASE_FREE;
+	if (m_ReleaseCallback)
+		m_ReleaseCallback(data, m_ReleaseUserData);
+}
+
+// Send a leased buffer
+// The buffer is the size of a frame when it was leased
+bool ofxNDIsend::SubmitLease(int index)
+{
+	if (m_Leases[index].size != LeaseSize()) {
+		printf("ofxNDIsend::SendLeasedFrame - sender size or format changed\n");
+		CompleteLease(index);
+		return false;
+	}
+	// Leased frames are sent at the sender size,
+	// also after images scaled by the tally policy
+	ResizeFrame(m_Width, m_Height);
+	video_frame.p_data = m_Leases[index].data;
+	SubmitFrame();
+	return true;
+}
+
+// Free the lease buffers
+void ofxNDIsend::FreeLeases()
+{
+	WaitAsyncFrame();
+	for (unsigned int i = 0; i < MaxLeaseFrames; i++) {
+		ofxNDIutils::AlignedFree(m_Leases[i].data);
+		m_Leases[i].data = nullptr;
+		m_Leases[i].size = 0;
+		m_Leases[i].state = LEASE_FREE;
+	}
+}
+
+// Convert rgba or bgra pixels to UYVY or UYVA in the local buffer
+void ofxNDIsend::ConvertToYUV(const unsigned char* pixels, unsigned int sourcePitch, bool bSwapRB, bool bInvert)
+{
+	const unsigned int width = (unsigned int)video_frame.xres;
+	const unsigned int height = (unsigned int)video_frame.yres;
+	// UYVA alpha plane follows the UYVY data
+	unsigned char* alpha = nullptr;
+	if (m_Format == NDIlib_FourCC_video_type_UYVA)
+		alpha = p_frame + (size_t)video_frame.line_stride_in_bytes * height;
+	ofxNDIutils::RGBA_to_YUV422(pixels, p_frame, alpha, width, height, sourcePitch, bSwapRB, bInvert, m_Colorimetry);
+	video_frame.p_data = p_frame;
+}
+
+// Timecode and metadata of the frame being sent, or nullptr
+// Frames sent by the worker thread have them in the queue.
+const ofxNDIsend::FrameInfo* ofxNDIsend::TakeFrameInfo()
+{
+#if defined(USE_THREADS)
+	if (IsWorkerThread())
+		return (m_pSendingFrame && m_pSendingFrame->bInfo) ? &m_pSendingFrame->info : nullptr;
+#endif
+	if (!m_bFrameInfo)
+		return nullptr;
+	m_bFrameInfo = false;
+	return &m_FrameInfo;
+}
+
+// Convert 16 bit or float rgba pixels to P216 or PA16
+// in the local buffer and send
+bool ofxNDIsend::SendHighBitDepth(const void* pixels, bool bFloat,
+	unsigned int width, unsigned int height, unsigned int sourcePitch, bool bInvert)
+{
+	if (!m_bNDIinitialized)
+		return false;
+
+	if (m_Format != NDIlib_FourCC_video_type_P216 && m_Format != NDIlib_FourCC_video_type_PA16) {
+		printf("ofxNDIsend::SendImage - 16 bit and float images require P216 or PA16 format\n");
+		return false;
+	}
+
+	if (pNDI_send && bSenderInitialized && pixels && width > 0 && height > 0) {
+
+		// Nothing to do without receivers or for the tally policy
+		if (SkipSend())
+			return true;
+
+#if defined(USE_THREADS)
+		// Queue a copy for the worker thread
+		if (m_bWorker && !IsWorkerThread()) {
+			if (sourcePitch == 0)
+				sourcePitch = width * (bFloat ? 16 : 8);
+			return QueueFrame(bFloat ? QUEUED_RGBAF : QUEUED_RGBA16, pixels, width, height, sourcePitch, false, bInvert);
+		}
+#endif
+
+		// Allow for forgotten UpdateSender
+		ResizeFrame(width, height);
+
+		if (!AllocateFrame())
+			return false;
+
+		// UV plane and PA16 alpha plane follow the Y plane
+		const unsigned int stride = (unsigned int)video_frame.line_stride_in_bytes;
+		uint16_t* y = (uint16_t*)p_frame;
+		uint16_t* uv = (uint16_t*)(p_frame + (size_t)stride * height);
+		uint16_t* alpha = nullptr;
+		if (m_Format == NDIlib_FourCC_video_type_PA16)
+			alpha = (uint16_t*)(p_frame + (size_t)stride * height * 2);
+
+		OFXNDI_TIMER(convert, "send.convert");
+		if (bFloat)
+			ofxNDIutils::RGBAF_to_P216((const float*)pixels, y, uv, alpha, width, height, sourcePitch, stride, bInvert, m_Colorimetry);
+		else
+			ofxNDIutils::RGBA16_to_P216((const uint16_t*)pixels, y, uv, alpha, width, height, sourcePitch, stride, bInvert, m_Colorimetry);
+		video_frame.p_data = p_frame;
+		OFXNDI_TIMER_STOP(convert);
+
+		// Audio, metadata and video
+		SubmitFrame();
+
+		return true;
+	}
+
+	return false;
+}
+
+// Send audio, metadata and the current video frame
+void ofxNDIsend::SubmitFrame()
+{
+	// Submit the audio buffer first.
+	// Refer to the NDI SDK example where for 48000 sample rate
+	// and 29.97 fps, an alternating sample number is used.
+	// Do this in the application using SetAudioSamples(nSamples);
+	// General reference : http://jacklinstudios.com/docs/post-primer.html
+	// Audio from the FIFO is independent of the frame rate.
+	if (m_bAudioFifo) {
+		// After frames were skipped, discard the audio pushed
+		// meanwhile and start the timeline again
+		const uint64_t skipped = m_SkippedFrames.load();
+		if (skipped != m_SkippedSent) {
+			m_SkippedSent = skipped;
+			m_AudioFifo.Pop(nullptr, m_AudioFifo.Available());
+			m_bTimeline = false;
+		}
+		// Frames not sent for the tally policy keep their place
+		// on the timeline, so timecodes stay at the nominal rate
+		const uint64_t tallySkipped = m_TallySkipped.load();
+		const uint64_t dropped = tallySkipped - m_TallySent;
+		m_TallySent = tallySkipped;
+		const bool bTimeline = m_bTimeline;
+		UpdateTimeline();
+		if (bTimeline)
+			m_VideoFrames += dropped;
+		if (m_bAudio)
+			SendAudioFifo();
+		// Timecode of this frame on the same timeline
+		video_frame.timecode = m_TimeOrigin + m_VideoTime
+			+ ofxNDIutils::FramesToTime(m_VideoFrames, m_TimelineN, m_TimelineD);
+		m_VideoFrames++;
+	}
+	else if (m_bAudio && m_audio_frame.p_data != nullptr) {
+		p_NDILib->send_send_audio_v2(pNDI_send, &m_audio_frame);
+	}
+
+	// Timecode and metadata given for this frame
+	const FrameInfo* info = TakeFrameInfo();
+	if (!m_bAudioFifo)
+		video_frame.timecode = NDIlib_send_timecode_synthesize;
+	if (info && info->timecode != NDIlib_send_timecode_synthesize)
+		video_frame.timecode = info->timecode;
+	video_frame.p_metadata = nullptr;
+	if (info && !info->metadata.empty()) {
+		// NDI owns an async frame and its metadata until the next send
+		m_FrameMetadataIndex = (m_FrameMetadataIndex + 1) % 2;
+		m_FrameMetadata[m_FrameMetadataIndex] = info->metadata;
+		video_frame.p_metadata = m_FrameMetadata[m_FrameMetadataIndex].c_str();
+	}
+
+	// Metadata
+	if (m_bMetadata && !m_metadataString.empty()) {
+		metadata_frame.length = (int)m_metadataString.size();
+		metadata_frame.timecode = NDIlib_send_timecode_synthesize;
+		metadata_frame.p_data = (char *)m_metadataString.c_str(); // XML message format
+		p_NDILib->send_send_metadata(pNDI_send, &metadata_frame);
+	}
+
+	if (m_bAsync) {
+		// Submit the frame asynchronously. This means that this call will return 
+		// immediately and the API will "own" the memory location until there is
+		// a synchronizing event. A synchronizing event is one of : 
+		//  - NDIlib_send_send_video_async
+		//  - NDIlib_send_send_video, NDIlib_send_destroy.
+		// NDIlib_send_send_video_async_v2 will wait for the previous frame to finish
+		// before submitting the current one.
+#ifdef USE_CHRONO
+		// Video is not clocked by NDI, hold the frame rate here.
+		// The frame rate of the sender is reduced by the tally policy.
+		if (m_bPacing) {
+			m_Pacer.SetRate(video_frame.frame_rate_N, video_frame.frame_rate_D);
+			m_Pacer.Wait();
+		}
+#endif
+		OFXNDI_TIMER(submit, "send.submit");
+		p_NDILib->send_send_video_async_v2(pNDI_send, &video_frame);
+		OFXNDI_TIMER_STOP(submit);
+		// The previous frame has been released.
+		// A leased frame is owned by NDI until the next send.
+		const int lease = FindLease(video_frame.p_data);
+		if (m_LeaseInFlight >= 0)
+			CompleteLease(m_LeaseInFlight);
+		m_LeaseInFlight = lease;
+	}
+	else {
+		// Submit the frame. Note that this call will be clocked
+		// so that we end up submitting at exactly the predetermined fps.
+		OFXNDI_TIMER(submit, "send.submit");
+		p_NDILib->send_send_video_v2(pNDI_send, &video_frame);
+		OFXNDI_TIMER_STOP(submit);
+		// Both the frame and any previous async frame are released
+		const int lease = FindLease(video_frame.p_data);
+		if (m_LeaseInFlight >= 0)
+			CompleteLease(m_LeaseInFlight);
+		m_LeaseInFlight = -1;
+		if (lease >= 0)
+			CompleteLease(lease);
+	}
+}
+
+//
+// Audio FIFO timeline
+//
+// Audio and video timecodes count from the same origin.
+// Video frame k is at k*D/N seconds and audio sample s is at
+// s/rate seconds. Chunk j of the cadence holds the samples from
+// round(j*rate*D/N) to round((j+1)*rate*D/N), so chunks of one frame
+// duration alternate where the duration is not a whole number of
+// samples, e.g. 1602, 1601, 1602, 1601, 1602 at 29.97 fps.
+// When the frame rate changes, the timeline continues from the
+// current time at the new rate.
+//
+
+// Start the timeline or change the frame rate
+void ofxNDIsend::UpdateTimeline()
+{
+	if (!m_bTimeline) {
+#ifdef USE_CHRONO
+		// 100ns intervals since the epoch, as for synthesized timecodes
+		m_TimeOrigin = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count() * 10;
+#else
+		m_TimeOrigin = 0;
+#endif
+		m_TimelineN = m_frame_rate_N;
+		m_TimelineD = m_frame_rate_D;
+		m_VideoTime = 0;
+		m_VideoFrames = 0;
+		m_AudioChunks = 0;
+		m_AudioSent = 0;
+		m_bTimeline = true;
+	}
+	else if (m_TimelineN != m_frame_rate_N || m_TimelineD != m_frame_rate_D) {
+		m_VideoTime += ofxNDIutils::FramesToTime(m_VideoFrames, m_TimelineN, m_TimelineD);
+		m_VideoFrames = 0;
+		m_AudioChunks = 0;
+		m_TimelineN = m_frame_rate_N;
+		m_TimelineD = m_frame_rate_D;
+	}
+}
+
+// Send complete chunks from the FIFO
+void ofxNDIsend::SendAudioFifo()
+{
+	const int channels = m_AudioFifo.GetChannels();
+	if (channels == 0 || m_TimelineN <= 0 || m_TimelineD <= 0)
+		return;
+
+	// Samples per frame duration times N
+	const uint64_t rateD = (uint64_t)m_AudioSampleRate * (uint64_t)m_TimelineD;
+	const uint64_t N = (uint64_t)m_TimelineN;
+	for (;;) {
+		const int nSamples = (int)(((m_AudioChunks + 1) * rateD + N / 2) / N
+			- (m_AudioChunks * rateD + N / 2) / N);
+		if (nSamples <= 0 || m_AudioFifo.Available() < nSamples)
+			break;
+
+		m_AudioChunk.resize((size_t)nSamples * channels);
+		m_AudioFifo.Pop(m_AudioChunk.data(), nSamples);
+
+		NDIlib_audio_frame_v2_t frame;
+		frame.sample_rate = m_AudioSampleRate;
+		frame.no_channels = channels;
+		frame.no_samples = nSamples;
+		frame.timecode = m_TimeOrigin + ofxNDIutils::FramesToTime(m_AudioSent, m_AudioSampleRate, 1);
+		frame.p_data = m_AudioChunk.data();
+		frame.channel_stride_in_bytes = nSamples * (int)sizeof(float);
+		p_NDILib->send_send_audio_v2(pNDI_send, &frame);
+
+		m_AudioSent += (uint64_t)nSamples;
+		m_AudioChunks++;
+	}
+}
+
+#if defined(USE_THREADS)
+
+//
+// Worker thread
+//
+// Send functions copy the frame to a queue and return.
+// The worker thread sends queued frames in order with
+// the same functions, so conversion, audio, metadata
+// and clocked video do not hold up the caller.
+// m_SendMutex is held while a frame is sent and by functions
+// that change the sender size or format.
+//
+
+// Set to send from a worker thread
+void ofxNDIsend::SetWorkerThread(bool bWorker)
+{
+	if (bWorker == m_bWorker)
+		return;
+	if (bWorker) {
+		m_bWorker = true;
+		StartWorker();
+	}
+	else {
+		StopWorker();
+		m_bWorker = false;
+	}
+}
+
+// Get whether frames are sent from a worker thread
+bool ofxNDIsend::GetWorkerThread()
+{
+	return m_bWorker;
+}
+
+// Set the number of frames that can wait to be sent
+// and the action when the queue is full
+void ofxNDIsend::SetSendQueue(unsigned int nFrames, QueuePolicy policy)
+{
+	if (nFrames < 1) nFrames = 1;
+	if (nFrames > 8) nFrames = 8;
+
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		m_QueuePolicy = policy;
+		if (nFrames == m_nQueueFrames)
+			return;
+	}
+
+	// Send queued frames before the queue is re-created
+	const bool bRunning = m_WorkerThread.joinable();
+	StopWorker();
+	FreeQueue();
+	m_nQueueFrames = nFrames;
+	if (bRunning)
+		StartWorker();
+}
+
+// Get the number of frames that can wait to be sent
+unsigned int ofxNDIsend::GetSendQueueSize()
+{
+	return m_nQueueFrames;
+}
+
+// Get the action when the queue is full
+ofxNDIsend::QueuePolicy ofxNDIsend::GetSendQueuePolicy()
+{
+	std::lock_guard<std::mutex> lock(m_QueueMutex);
+	return m_QueuePolicy;
+}
+
+// Get the worker thread frame counts
+ofxNDIsend::QueueCounters ofxNDIsend::GetQueueCounters()
+{
+	QueueCounters counters;
+	counters.enqueued = m_QueueEnqueued.load();
+	counters.sent = m_QueueSent.load();
+	counters.dropped = m_QueueDropped.load();
+	return counters;
+}
+
+// Reset the worker thread frame counts
+void ofxNDIsend::ResetQueueCounters()
+{
+	m_QueueEnqueued = 0;
+	m_QueueSent = 0;
+	m_QueueDropped = 0;
+}
+
+// Called from the worker thread
+bool ofxNDIsend::IsWorkerThread()
+{
+	return std::this_thread::get_id() == m_WorkerThread.get_id();
+}
+
+// Copy a frame to the queue for the worker thread
+// Leased buffers are queued without a copy
+bool ofxNDIsend::QueueFrame(QueuedType type, const void* data,
+	unsigned int width, unsigned int height, unsigned int pitch,
+	bool bSwapRB, bool bInvert)
+{
+	int index = -1;
+	unsigned char* dropped = nullptr; // Leased buffer of a dropped frame
+	// Timecode and metadata go with the frame
+	const bool bInfo = m_bFrameInfo;
+	m_bFrameInfo = false;
+	{
+		std::unique_lock<std::mutex> lock(m_QueueMutex);
+		for (;;) {
+			for (int i = 0; i < (int)m_Queue.size(); i++) {
+				if (m_Queue[i].state == QUEUED_FREE) {
+					index = i;
+					break;
+				}
+			}
+			if (index >= 0)
+				break;
+			// The queue is full
+			if (m_QueuePolicy == QUEUE_DROP_OLDEST && !m_ReadyFrames.empty()) {
+				index = m_ReadyFrames.front();
+				m_ReadyFrames.pop_front();
+				dropped = DropQueuedFrame(index);
+				break;
+			}
+			if (m_QueuePolicy == QUEUE_DROP_NEWEST) {
+				m_QueueDropped++;
+				lock.unlock();
+				if (type == QUEUED_LEASE)
+					ReleaseQueuedLease((unsigned char*)data);
+				return false;
+			}
+			// Wait for the worker to send a frame
+			m_QueueFree.wait(lock);
+		}
+		m_Queue[index].state = QUEUED_FILLING;
+	}
+	ReleaseQueuedLease(dropped);
+
+	// Copy the frame outside the lock
+	QueuedFrame& frame = m_Queue[index];
+	frame.type = type;
+	frame.width = width;
+	frame.height = height;
+	frame.pitch = pitch;
+	frame.bSwapRB = bSwapRB;
+	frame.bInvert = bInvert;
+	frame.bInfo = bInfo;
+	if (bInfo)
+		frame.info = m_FrameInfo;
+	frame.lease = nullptr;
+	if (type == QUEUED_LEASE) {
+		frame.lease = (unsigned char*)data;
+	}
+	else {
+		const size_t size = (type == QUEUED_VIDEO) ? FormatFrameSize(m_Format, width, height) : (size_t)pitch * height;
+		if (frame.size < size) {
+			ofxNDIutils::AlignedFree(frame.data);
+			frame.data = (uint8_t*)ofxNDIutils::AlignedAlloc(size);
+			frame.size = frame.data ? size : 0;
+		}
+		if (!frame.data) {
+			printf("Out of memory in SendImage\n");
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			frame.state = QUEUED_FREE;
+			m_QueueDropped++;
+			return false;
+		}
+		ofxNDIutils::CopyBuffer(frame.data, data, size);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		frame.state = QUEUED_READY;
+		m_ReadyFrames.push_back(index);
+		m_QueueEnqueued++;
+	}
+	m_QueueReady.notify_one();
+
+	return true;
+}
+
+// Discard a frame waiting to be sent
+// Returns the leased buffer of the frame, if any,
+// to be released after m_QueueMutex is unlocked.
+// m_QueueMutex must be locked
+unsigned char* ofxNDIsend::DropQueuedFrame(int index)
+{
+	QueuedFrame& frame = m_Queue[index];
+	unsigned char* lease = (frame.type == QUEUED_LEASE) ? frame.lease : nullptr;
+	frame.lease = nullptr;
+	frame.state = QUEUED_FREE;
+	m_QueueDropped++;
+	return lease;
+}
+
+// Return the leased buffer of a dropped frame to the pool
+void ofxNDIsend::ReleaseQueuedLease(unsigned char* buffer)
+{
+	const int lease = FindLease(buffer);
+	if (lease >= 0)
+		CompleteLease(lease);
+}
+
+// Discard all frames waiting to be sent
+void ofxNDIsend::ClearQueue()
+{
+	std::vector<unsigned char*> leases;
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		while (!m_ReadyFrames.empty()) {
+			unsigned char* lease = DropQueuedFrame(m_ReadyFrames.front());
+			if (lease)
+				leases.push_back(lease);
+			m_ReadyFrames.pop_front();
+		}
+	}
+	m_QueueFree.notify_all();
+	for (size_t i = 0; i < leases.size(); i++)
+		ReleaseQueuedLease(leases[i]);
+}
+
+void ofxNDIsend::StartWorker()
+{
+	if (m_WorkerThread.joinable())
+		return;
+	// Frames waiting, plus one being sent
+	// The queue is not resized while the worker is running
+	if (m_Queue.size() != m_nQueueFrames + 1)
+		m_Queue.resize(m_nQueueFrames + 1, QueuedFrame());
+	m_bWorkerQuit = false;
+	m_WorkerThread = std::thread(&ofxNDIsend::WorkerThread, this);
+}
+
+// Send queued frames and stop the worker thread
+void ofxNDIsend::StopWorker()
+{
+	if (!m_WorkerThread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		m_bWorkerQuit = true;
+	}
+	m_QueueReady.notify_one();
+	m_WorkerThread.join();
+}
+
+// Free queued frame buffers
+// The worker thread must be stopped
+void ofxNDIsend::FreeQueue()
+{
+	for (size_t i = 0; i < m_Queue.size(); i++)
+		ofxNDIutils::AlignedFree(m_Queue[i].data);
+	m_Queue.clear();
+	m_ReadyFrames.clear();
+}
+
+// Worker thread function
+// Send frames in the order queued until stopped
+void ofxNDIsend::WorkerThread()
+{
+	for (;;) {
+		int index = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_QueueMutex);
+			m_QueueReady.wait(lock, [this] { return m_bWorkerQuit || !m_ReadyFrames.empty(); });
+			if (m_ReadyFrames.empty())
+				break; // Quit with no frames waiting
+			index = m_ReadyFrames.front();
+			m_ReadyFrames.pop_front();
+			m_Queue[index].state = QUEUED_SENDING;
+		}
+
+		bool bSent = false;
+		{
+			std::lock_guard<std::mutex> lock(m_SendMutex);
+			m_pSendingFrame = &m_Queue[index];
+			bSent = SendQueuedFrame(m_Queue[index]);
+			m_pSendingFrame = nullptr;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_Queue[index].state = QUEUED_FREE;
+			if (bSent) m_QueueSent++;
+			else m_QueueDropped++;
+		}
+		m_QueueFree.notify_one();
+	}
+}
+
+// Send a queued frame from the worker thread
+bool ofxNDIsend::SendQueuedFrame(const QueuedFrame& frame)
+{
+	switch (frame.type) {
+		case QUEUED_RGBA:
+			return SendImage(frame.data, frame.width, frame.height, frame.bSwapRB, frame.bInvert);
+		case QUEUED_RGBA_PITCH:
+			return SendImage(frame.data, frame.width, frame.height, frame.pitch, frame.bInvert);
+		case QUEUED_RGBA16:
+			return SendHighBitDepth(frame.data, false, frame.width, frame.height, frame.pitch, frame.bInvert);
+		case QUEUED_RGBAF:
+			return SendHighBitDepth(frame.data, true, frame.width, frame.height, frame.pitch, frame.bInvert);
+		case QUEUED_VIDEO:
+			return SendVideoFrame(frame.data, frame.width, frame.height, frame.bInvert);
+		case QUEUED_LEASE: {
+			const int lease = FindLease(frame.lease);
+			if (lease < 0)
+				return false;
+			if (!bSenderInitialized) {
+				CompleteLease(lease);
+				return false;
+			}
+			return SubmitLease(lease);
+		}
+		default:
+			return false;
+	}
+}
+
+#endif
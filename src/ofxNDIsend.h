@@ -40,6 +40,24 @@
 			 - Add changes for OSX (https://github.com/ThomasLengeling/ofxNDI)
 			 - add "m_" prefix to all class variables
 	15.11.19 - Change to dynamic load of Newtek NDI dlls
+	15.10.26 - Add SendVideoFrame and SetYUVmatrix
+			   SendImage converts to UYVY or UYVA for YUV formats
+			   Add 16 bit and float SendImage for P216 and PA16 formats
+			   Add SetInvertInPlace
+			   Add SetColorimetry
+			   Add SetPacing for async mode
+			   Add SetFrameBuffers for async sending
+			   Add LeaseFrame and SendLeasedFrame for zero copy sending
+	16.10.26 - Add SetWorkerThread and SetSendQueue for sending from a worker thread
+			   Add SetAudioFifo and PushAudio for audio independent of the video frame rate
+			   Add SetConnectionSkip, GetConnections and SkipFrame
+			   Add SetTallyPolicy and GetTally
+			   Use the shared NDI runtime, loaded by the first CreateSender
+			   Add CancelFrame for a frame passed by SkipFrame but not sent
+			   Add SetFrameInfo and SendImage, SendVideoFrame and SendLeasedFrame
+			   with a frame timecode and metadata
+			   SetConnectionSkip - skipped frames wait for the frame rate
+			   Friend class ofxNDIsendTest if OFXNDI_TEST is defined
 
 */
 #pragma once
@@ -48,10 +66,19 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include <atomic>
 
 #include "ofxNDIdynloader.h" // NDI library loader
 #include "ofxNDIutils.h" // buffer copy utilities
 
+#if defined(USE_THREADS)
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
 // Definition is in WinBase.h
 // define for compilers that don't include this
 #ifndef MAX_COMPUTERNAME_LENGTH
@@ -82,6 +109,7 @@ public:
 	bool UpdateSender(unsigned int width, unsigned int height);
 
 	// Send image pixels
+	// For UYVY or UYVA output format, pixels are converted to YUV
 	// - image | pixel data BGRA or RGBA
 	// - width | image width
 	// - height | image height
@@ -107,6 +135,98 @@ public:
 		unsigned int width, unsigned int height, 
 		unsigned int sourcePitch, bool bInvert = false);
 
+	// Send 16 bit image pixels for P216 or PA16 output format
+	// - image | 16 bit RGBA pixel data (0-65535)
+	// - width | image width
+	// - height | image height
+	// - sourcePitch | source line pitch in bytes (0 for width*8)
+	// - bInvert | flip the image - default false
+	bool SendImage(const uint16_t *image,
+		unsigned int width, unsigned int height,
+		unsigned int sourcePitch, bool bInvert = false);
+
+	// Send float image pixels for P216 or PA16 output format
+	// - image | float RGBA pixel data (0-1)
+	// - width | image width
+	// - height | image height
+	// - sourcePitch | source line pitch in bytes (0 for width*16)
+	// - bInvert | flip the image - default false
+	bool SendImage(const float *image,
+		unsigned int width, unsigned int height,
+		unsigned int sourcePitch, bool bInvert = false);
+
+	// Send video data already in the output format
+	// - data | video data with the line stride of the format
+	//          e.g. UYVY converted by shader
+	// - width | image width
+	// - height | image height
+	// - bInvert | flip the image - default false
+	bool SendVideoFrame(const unsigned char *data,
+		unsigned int width, unsigned int height, bool bInvert = false);
+
+	// Timecode and metadata of one video frame
+	// - timecode | 100ns intervals or NDIlib_send_timecode_synthesize
+	// - metadata | XML metadata sent with the frame, or empty for none
+	struct FrameInfo {
+		int64_t timecode;
+		std::string metadata;
+		explicit FrameInfo(int64_t tc = NDIlib_send_timecode_synthesize,
+			const std::string& md = "") : timecode(tc), metadata(md) {}
+	};
+
+	// Set the timecode and metadata of the next video frame sent
+	// Used by the next SendImage, SendVideoFrame or SendLeasedFrame,
+	// and queued with the frame for the worker thread. Senders driven
+	// from the same loop and given the same timecode can be aligned
+	// downstream. The timecode replaces the synthesized timecode
+	// or the audio FIFO timeline timecode for that frame only.
+	// Discarded if the frame is skipped.
+	void SetFrameInfo(const FrameInfo& info);
+
+	// Send image pixels with a timecode and metadata
+	// - info | timecode and metadata of this frame
+	// Other arguments as for SendImage
+	bool SendImage(const unsigned char *image, unsigned int width, unsigned int height,
+		const FrameInfo& info, bool bSwapRB = false, bool bInvert = false);
+
+	// Send video data already in the output format with a timecode and metadata
+	bool SendVideoFrame(const unsigned char *data, unsigned int width, unsigned int height,
+		const FrameInfo& info, bool bInvert = false);
+
+	// Lease a frame buffer from the sender's pool
+	// The buffer is 64 byte aligned and the size of a frame of the current
+	// output format (GetWidth x GetHeight), with the line stride of the format
+	// as for SendVideoFrame. Render or decode directly into the buffer and
+	// send it with SendLeasedFrame. Up to 4 buffers can be leased or in flight.
+	// Returns nullptr if the sender is not created or all buffers are in use.
+	// Leased buffers are freed by ReleaseSender.
+	unsigned char* LeaseFrame();
+
+	// Send a leased frame buffer without copying
+	// The buffer is owned by NDI until it is released (see SetReleaseCallback).
+	// In async mode this is when the next frame is sent. The lease is
+	// cancelled if the sender size or format changed since LeaseFrame.
+	bool SendLeasedFrame(unsigned char* buffer);
+
+	// Send a leased frame buffer with a timecode and metadata
+	bool SendLeasedFrame(unsigned char* buffer, const FrameInfo& info);
+
+	// Return a leased buffer to the pool without sending it
+	void CancelLease(unsigned char* buffer);
+
+	// Function called when a leased buffer is released by NDI
+	// and returned to the pool. Called from the sending thread,
+	// which is the worker thread if SetWorkerThread is enabled.
+	// Do not send frames from the callback.
+	typedef void (*FrameReleaseCallback)(unsigned char* buffer, void* userdata);
+
+	// Set a function to be called when a leased buffer is released
+	void SetReleaseCallback(FrameReleaseCallback callback, void* userdata = nullptr);
+
+	// Whether a leased buffer has been released
+	// False while the buffer is leased or owned by NDI
+	bool IsFrameReleased(const unsigned char* buffer);
+
 	// Close sender and release resources
 	void ReleaseSender();
 
@@ -131,6 +251,22 @@ public:
 	// Get output format
 	NDIlib_FourCC_video_type_e GetFormat();
 
+	// Set YUV colour matrix for UYVY, UYVA, P216 and PA16 output
+	// Initialized YUV_MATRIX_AUTO
+	// (BT.601 for SD and BT.709 for HD)
+	void SetYUVmatrix(ofxNDIutils::YUVmatrix matrix);
+
+	// Get YUV colour matrix
+	ofxNDIutils::YUVmatrix GetYUVmatrix();
+
+	// Set YUV colorimetry for UYVY, UYVA, P216 and PA16 output
+	// Matrix (BT.601, BT.709, BT.2020 or auto) and range (limited or full)
+	// Initialized YUV_MATRIX_AUTO, YUV_RANGE_LIMITED
+	void SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry);
+
+	// Get YUV colorimetry
+	ofxNDIutils::YUVcolorimetry GetColorimetry();
+
 	// Set frame rate
 	// - framerate - frames per second
 	// Initialized 60fps
@@ -183,6 +319,84 @@ public:
 	// Get whether async sending mode
 	bool GetAsync();
 
+#ifdef USE_CHRONO
+	// Set to hold the frame rate in async sending mode
+	// Each frame is sent at an exact N/D frame rate deadline
+	// (see SetFrameRate and ofxNDIutils::FramePacer).
+	// Has no effect for clocked video.
+	// Initialized false
+	void SetPacing(bool bPacing = true);
+
+	// Get whether async frames are paced
+	bool GetPacing();
+
+	// Number of frame deadlines missed by the pacer
+	uint64_t GetMissedFrames();
+#endif
+
+	// Set the number of local buffers used in rotation for async sending
+	// NDI owns an async frame until the next send, so each frame is
+	// converted into a different buffer from the one being sent.
+	// 2 to 4 buffers. Initialized 2.
+	void SetFrameBuffers(unsigned int nBuffers = 2);
+
+	// Get the number of local buffers for async sending
+	unsigned int GetFrameBuffers();
+
+#if defined(USE_THREADS)
+	// Set to send from a worker thread
+	// SendImage, SendVideoFrame and SendLeasedFrame queue the frame and
+	// return immediately. Image data is copied to the queue. A worker thread
+	// converts and sends queued frames, so the caller does not wait for
+	// clocked video. Queued frames are sent before the worker stops.
+	// Change sender settings other than size and format with the worker stopped.
+	// Initialized false
+	void SetWorkerThread(bool bWorker = true);
+
+	// Get whether frames are sent from a worker thread
+	bool GetWorkerThread();
+
+	// Action when a frame is sent and the queue is full
+	enum QueuePolicy {
+		QUEUE_DROP_OLDEST = 0, // Replace the oldest queued frame
+		QUEUE_DROP_NEWEST, // Discard the new frame
+		QUEUE_BLOCK // Wait until the worker has sent a frame
+	};
+
+	// Set the number of frames that can wait to be sent (1 - 8)
+	// and the action when the queue is full
+	// Initialized 2 frames and QUEUE_DROP_OLDEST
+	void SetSendQueue(unsigned int nFrames = 2, QueuePolicy policy = QUEUE_DROP_OLDEST);
+
+	// Get the number of frames that can wait to be sent
+	unsigned int GetSendQueueSize();
+
+	// Get the action when the queue is full
+	QueuePolicy GetSendQueuePolicy();
+
+	// Frames queued, sent and dropped by the worker thread
+	struct QueueCounters {
+		uint64_t enqueued;
+		uint64_t sent;
+		uint64_t dropped;
+	};
+
+	// Get the worker thread frame counts
+	QueueCounters GetQueueCounters();
+
+	// Reset the worker thread frame counts
+	void ResetQueueCounters();
+#endif
+
+	// Set to flip the image being sent in place for invert
+	// The caller's pixel buffer is modified and remains flipped.
+	// No local buffer copy is made for invert.
+	// Initialized false
+	void SetInvertInPlace(bool bInPlace = true);
+
+	// Get whether invert is done in place
+	bool GetInvertInPlace();
+
 	// Set to send Audio
 	// Initialized false
 	void SetAudio(bool bAudio = true);
@@ -214,6 +428,31 @@ public:
 	// - data | data to send (float)
 	void SetAudioData(const float *data = NULL); // Audio data
 
+	// Set to send audio from a FIFO instead of SetAudioData
+	// Samples pushed with PushAudio are sent once, in chunks of one frame
+	// duration at the sender frame rate (e.g. 1602, 1601, 1602, 1601, 1602
+	// at 29.97 fps and 48kHz) however often frames are sent. Audio and video
+	// timecodes are set from the video frame timeline so that they stay aligned.
+	// SetAudio must also be enabled. Set the sample rate and channels first.
+	// Not thread safe, set before audio is pushed.
+	// - capacity | samples per channel the FIFO holds (0 for one second)
+	void SetAudioFifo(bool bFifo = true, int capacity = 0);
+
+	// Get whether audio is sent from a FIFO
+	bool GetAudioFifo();
+
+	// Push audio samples to the FIFO
+	// Can be called from an audio thread. Never waits.
+	// - data | float samples, planar or interleaved
+	// - nSamples | samples per channel
+	// - bInterleaved | samples of all channels in turn - default false
+	// - channelStride | planar channel stride in samples (0 for nSamples)
+	// Returns the number of samples pushed. Samples that do not fit are dropped.
+	int PushAudio(const float *data, int nSamples, bool bInterleaved = false, int channelStride = 0);
+
+	// Samples per channel dropped because the FIFO was full
+	uint64_t GetAudioDropped();
+
 	// Set to send metadata
 	// Initialized false
 	void SetMetadata(bool bMetadata = true);
@@ -225,17 +464,89 @@ public:
 	// Get the current NDI SDK version
 	std::string GetNDIversion();
 
+	// Set to skip frames while no receivers are connected
+	// Conversion, audio, metadata and video are skipped and the
+	// send functions return true. The number of connections is
+	// polled at the interval, not for every frame, so a receiver
+	// that connects gets frames within the interval.
+	// Audio pushed to the FIFO meanwhile is discarded when a receiver
+	// connects and the audio and video timeline starts again.
+	// Skipped frames wait for the frame rate if video is clocked or
+	// async frames are paced, so the application cycle is held at
+	// the frame rate as it is while sending. Otherwise, or if
+	// USE_CHRONO is not defined, the application must limit its rate.
+	// - bSkip | skip unconnected frames
+	// - interval | milliseconds between polls of the connections
+	// Initialized false
+	void SetConnectionSkip(bool bSkip = true, unsigned int interval = 1000);
+
+	// Get whether unconnected frames are skipped
+	bool GetConnectionSkip();
+
+	// Number of receivers connected
+	// Polled from NDI at most once per interval
+	int GetConnections();
+
+	// Whether to skip this frame because no receivers are connected
+	// or for the tally policy. Used for work before sending,
+	// e.g. texture readback. A skipped frame is counted and
+	// a frame that is not skipped is not checked again by the
+	// next send function. Call CancelFrame if the frame is then
+	// not sent, e.g. if the readback failed.
+	bool SkipFrame();
+
+	// A frame passed by SkipFrame is not being sent
+	// The next send function checks the frame again.
+	void CancelFrame();
+
+	// Number of frames skipped while not connected
+	uint64_t GetSkippedFrames();
+
+	// Set to reduce the frame rate by tally
+	// A sender on program is sent at full rate. On preview only,
+	// or on neither, only one frame in the divisor is sent and the
+	// frame rate of the video frame is reduced to match.
+	// Paced async frames are held at the reduced rate.
+	// Tally is polled at the SetConnectionSkip interval.
+	// - previewDivisor | frame rate divisor on preview only
+	// - idleDivisor | frame rate divisor on neither program nor preview
+	// - bScale | also send 8 bit rgba images at half size on preview
+	//            and quarter size on neither
+	// Initialized false
+	void SetTallyPolicy(bool bPolicy = true, unsigned int previewDivisor = 2,
+		unsigned int idleDivisor = 4, bool bScale = false);
+
+	// Get whether the tally policy is enabled
+	bool GetTallyPolicy();
+
+	// Tally of the sender
+	// Polled from NDI at most once per interval
+	void GetTally(bool &bOnProgram, bool &bOnPreview);
+
+	// Frame rate divisor currently applied by the tally policy
+	unsigned int GetTallyDivisor();
+
+	// Number of frames not sent because of the tally policy
+	uint64_t GetTallySkipped();
+
 private:
 
-	const NDIlib_v4* p_NDILib;
+	const NDIlib_v4* p_NDILib; // Shared runtime
 	bool m_bNDIinitialized;
-
-	ofxNDIdynloader libloader;
+	bool m_bNDIloadTried; // Runtime load has been tried
+	bool LoadRuntime(); // Acquire the shared runtime on first use
 
 	NDIlib_send_create_t NDI_send_create_desc;
 	NDIlib_send_instance_t pNDI_send;
 	NDIlib_video_frame_v2_t video_frame;
-	uint8_t* p_frame;
+	uint8_t* p_frame; // Current local buffer
+
+	// Local buffers for conversion or invert
+	// Async frames rotate through m_nFrameBuffers buffers
+	enum { MaxFrameBuffers = 4 };
+	uint8_t* m_frameBuffers[MaxFrameBuffers];
+	unsigned int m_nFrameBuffers; // Buffers in rotation
+	unsigned int m_FrameIndex; // Current buffer
 
 	// Sender dimensions
 	unsigned int m_Width, m_Height;
@@ -250,8 +561,85 @@ private:
 	bool m_bProgressive; // Progressive output flag
 	bool m_bClockVideo; // Clock video flag
 	bool m_bAsync; // NDI asynchronous sender
+	bool m_bInvertInPlace; // Flip the caller's buffer for invert
+#ifdef USE_CHRONO
+	bool m_bPacing; // Pace async frames at the frame rate
+	ofxNDIutils::FramePacer m_Pacer;
+	ofxNDIutils::FramePacer m_SkipPacer; // Frames skipped while not connected
+#endif
 	NDIlib_FourCC_video_type_e m_Format; // Output format. Default RGBA. May also be BGRA or YUV.
 	void SetVideoStride(NDIlib_FourCC_video_type_e format); // Set line stride for YUV or RGBA
+	ofxNDIutils::YUVcolorimetry m_Colorimetry; // Matrix and range for rgba to YUV conversion
+
+	void ResizeFrame(unsigned int width, unsigned int height); // Video frame for changed image size
+	bool AllocateFrame(); // Next local buffer for conversion or invert
+	void ReleaseFrames(); // Free the local buffers
+	size_t FrameSize(); // Bytes for a frame of the current format and size
+	size_t LeaseSize(); // Bytes for a leased frame at the sender size
+	void WaitAsyncFrame(); // Wait for NDI to finish with the async frame
+
+	// Frame buffers leased to the application
+	enum { MaxLeaseFrames = 4 };
+	enum LeaseState { LEASE_FREE = 0, LEASE_HELD, LEASE_SENT };
+	struct FrameLease {
+		uint8_t* data;
+		size_t size;
+		std::atomic<int> state; // LeaseState, released by the worker thread
+	};
+	FrameLease m_Leases[MaxLeaseFrames];
+	int m_LeaseInFlight; // Lease owned by NDI as the async frame (-1 for none)
+	FrameReleaseCallback m_ReleaseCallback;
+	void* m_ReleaseUserData;
+	int FindLease(const unsigned char* buffer); // Index of a leased buffer or -1
+	void CompleteLease(int index); // Return a sent lease to the pool
+	void FreeLeases(); // Free the lease buffers
+	bool SubmitLease(int index); // Send a leased buffer
+
+#if defined(USE_THREADS)
+	// Frames queued for the worker thread
+	enum QueuedType { QUEUED_RGBA = 0, QUEUED_RGBA_PITCH, QUEUED_RGBA16, QUEUED_RGBAF, QUEUED_VIDEO, QUEUED_LEASE };
+	enum QueuedState { QUEUED_FREE = 0, QUEUED_FILLING, QUEUED_READY, QUEUED_SENDING };
+	struct QueuedFrame {
+		uint8_t* data; // Copy of the frame
+		size_t size; // Allocated size
+		unsigned char* lease; // Leased buffer, not copied
+		QueuedType type;
+		QueuedState state;
+		unsigned int width, height, pitch;
+		bool bSwapRB, bInvert;
+		bool bInfo; // Timecode and metadata given
+		FrameInfo info;
+	};
+	bool m_bWorker; // Send from the worker thread
+	unsigned int m_nQueueFrames; // Frames that can wait to be sent
+	QueuePolicy m_QueuePolicy; // Action when the queue is full
+	std::vector<QueuedFrame> m_Queue; // Frames waiting and being sent
+	std::deque<int> m_ReadyFrames; // Frames waiting in order of sending
+	std::thread m_WorkerThread;
+	std::mutex m_QueueMutex; // Protects the queue
+	std::condition_variable m_QueueReady; // A frame is ready to send
+	std::condition_variable m_QueueFree; // A queued frame is free
+	bool m_bWorkerQuit;
+	std::mutex m_SendMutex; // Held while a frame is sent or the sender changed
+	std::atomic<uint64_t> m_QueueEnqueued;
+	std::atomic<uint64_t> m_QueueSent;
+	std::atomic<uint64_t> m_QueueDropped;
+	bool IsWorkerThread(); // Called from the worker thread
+	bool QueueFrame(QueuedType type, const void* data, unsigned int width, unsigned int height,
+		unsigned int pitch, bool bSwapRB, bool bInvert); // Copy a frame to the queue
+	unsigned char* DropQueuedFrame(int index); // Discard a frame waiting to be sent
+	void ReleaseQueuedLease(unsigned char* buffer); // Release the leased buffer of a dropped frame
+	void ClearQueue(); // Discard all frames waiting to be sent
+	void StartWorker();
+	void StopWorker(); // Send queued frames and stop the worker thread
+	void FreeQueue(); // Free queued frame buffers
+	void WorkerThread(); // Worker thread function
+	bool SendQueuedFrame(const QueuedFrame& frame); // Send from the worker thread
+	const QueuedFrame* m_pSendingFrame; // Frame being sent by the worker thread
+#endif
+	void ConvertToYUV(const unsigned char *pixels, unsigned int sourcePitch, bool bSwapRB, bool bInvert);
+	bool SendHighBitDepth(const void *pixels, bool bFloat, unsigned int width, unsigned int height, unsigned int sourcePitch, bool bInvert);
+	void SubmitFrame(); // Send audio, metadata and video frame
 
 	// Audio
 	bool m_bAudio;
@@ -262,11 +650,65 @@ private:
 	int64_t m_AudioTimecode;
 	float *m_AudioData;
 
+	// Audio FIFO and the timeline of audio and video timecodes
+	std::atomic<bool> m_bAudioFifo;
+	ofxNDIutils::AudioFifo m_AudioFifo;
+	std::vector<float> m_AudioChunk; // Planar samples of one chunk
+	bool m_bTimeline; // Timeline started
+	int64_t m_TimeOrigin; // Timecode of the start in 100ns units
+	int m_TimelineN, m_TimelineD; // Frame rate of the cadence
+	int64_t m_VideoTime; // Time of the first frame at the current frame rate
+	uint64_t m_VideoFrames; // Frames at the current frame rate
+	uint64_t m_AudioChunks; // Chunks at the current frame rate
+	uint64_t m_AudioSent; // Samples per channel sent
+	void UpdateTimeline(); // Start the timeline or change the frame rate
+	void SendAudioFifo(); // Send complete chunks from the FIFO
+
+	// Connection skip
+	std::atomic<bool> m_bConnectionSkip;
+	std::atomic<unsigned int> m_ConnectionInterval; // Milliseconds
+	std::atomic<int64_t> m_ConnectionPoll; // Time of the last poll in milliseconds, -1 to poll
+	std::atomic<int> m_Connections; // Connections at the last poll
+	std::atomic<uint64_t> m_SkippedFrames;
+	uint64_t m_SkippedSent; // Skipped frames when the last frame was sent
+	std::atomic<bool> m_bFramePassed; // SkipFrame passed a frame for the next send
+	void ResetConnections(); // Poll at the next frame
+	void PollConnections(); // Poll connections and tally at the interval
+	bool SkipSend(); // SkipFrame for the send functions
+	void HoldSkippedFrame(); // Wait for the frame rate while skipping
+
+	// Tally policy
+	std::atomic<bool> m_bTallyPolicy;
+	std::atomic<bool> m_bOnProgram;
+	std::atomic<bool> m_bOnPreview;
+	std::atomic<unsigned int> m_TallyDivisor; // Frame rate divisor applied
+	std::atomic<unsigned int> m_TallyScale; // Image size divisor applied
+	unsigned int m_PreviewDivisor;
+	unsigned int m_IdleDivisor;
+	bool m_bTallyScale;
+	unsigned int m_TallyCount; // Frames since the tally changed
+	std::atomic<uint64_t> m_TallySkipped;
+	uint64_t m_TallySent; // Tally skipped frames when the last frame was sent
+	std::vector<unsigned char> m_TallyPixels; // Scaled rgba for YUV formats
+	void ApplyTally(); // Divisors for the current tally
+	bool SendScaled(const unsigned char* pixels, unsigned int width, unsigned int height,
+		unsigned int sourcePitch, bool bSwapRB, bool bInvert); // Reduced size for the tally policy
+#if defined(OFXNDI_TEST)
+	friend class ofxNDIsendTest; // Sets the tally in tests/ofxNDIsendTest.cpp
+#endif
+
 	// Metadata
 	bool m_bMetadata;
 	NDIlib_metadata_frame_t metadata_frame; // The frame that will be sent
 	std::string m_metadataString; // XML message format string NULL terminated - application provided
 
+	// Timecode and metadata of the next frame
+	FrameInfo m_FrameInfo;
+	bool m_bFrameInfo;
+	std::string m_FrameMetadata[2]; // Held for the async frame owned by NDI
+	unsigned int m_FrameMetadataIndex;
+	const FrameInfo* TakeFrameInfo(); // FrameInfo of the frame being sent
+
 };
 
 
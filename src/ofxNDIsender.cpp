@@ -90,6 +90,24 @@
 			   SendImage ofTexture - quit is not initialized, texture or sending buffers
 			   not allocated, or if the texture is not RGBA, RGBA8, BGRA, RGB or BGR
 			   ReadPixels - use glGetTexImage instead of readToPixels to support RGB textures
+	15.10.26 - SetFormat - UYVY and UYVA converted on the CPU if the shader is not found
+			   SendImage ofTexture - send shader YUV data with SendVideoFrame
+			   SendImage pixels - allow UYVY and UYVA output formats
+			   Add SetYUVmatrix
+			   Add SetColorimetry
+			   ReadYUVpixels - shader coefficients from the sender colorimetry
+			   Add SetPacing
+			   ReadTexturePixels - stage timer "sender.readback"
+			   Add SetFrameBuffers
+	16.10.26 - Add SetWorkerThread
+			   Add SetAudioFifo and PushAudio
+			   Add SetConnectionSkip. SendImage texture - no readback while
+			   no receivers are connected.
+			   Add SetTallyPolicy and GetTally
+			   Add SetFrameInfo
+			   ReadYUVpixels - texelSize uniform for the ES2 rgba2yuv shader
+			   SendImage texture - CancelFrame if there are no pixels to send
+			   SetPacing and GetPacing only if USE_CHRONO
 
 */
 #include "ofxNDIsender.h"
@@ -128,6 +146,7 @@ ofxNDIsender::ofxNDIsender()
 
 	m_SenderName = "";
 	m_bReadback = false; // Asynchronous fbo pixel data readback option
+	m_bYUVshader = false; // rgba2yuv shader not found yet
 	m_pbo[0] = m_pbo[1] = m_pbo[2] = 0;
 
 }
@@ -270,6 +289,10 @@ bool ofxNDIsender::SendImage(ofTexture tex, bool bInvert)
 		return false;
 	}
 
+	// No texture readback without receivers or for the tally policy
+	if (NDIsender.SkipFrame())
+		return true;
+
 	ofDisableDepthTest(); // In case this was enabled, or textures do not show
 
 	unsigned int width  = (unsigned int)tex.getWidth();
@@ -285,23 +308,28 @@ bool ofxNDIsender::SendImage(ofTexture tex, bool bInvert)
 
 	// Read texture pixels into a pixel buffer
 	bool bResult = false;
-	// NDIlib_FourCC_video_type_UYVY can only be enabled by SetFormat
-	// Path to required shaders is tested
-	if (NDIsender.GetFormat() == NDIlib_FourCC_video_type_UYVY) {
+	// UYVY by shader if the required shaders were found by SetFormat
+	if (m_bYUVshader && NDIsender.GetFormat() == NDIlib_FourCC_video_type_UYVY) {
 		// Convert to the YUV format at the same time.
 		// YUV output width is half that of the RGBA input
 		bResult = ReadYUVpixels(tex, width/2, height, ndiBuffer[m_idx]);
+		// Send YUV data
+		// NDI video frame line stride has been set to match the data format.
+		// (see ofxNDIsend::SetVideoStride)
+		if (bResult)
+			return NDIsender.SendVideoFrame((const unsigned char *)ndiBuffer[m_idx].getData(), width, height, bInvert);
 	}
 	else {
 		bResult = ReadPixels(tex, width, height, ndiBuffer[m_idx]);
+		// Send RGBA pixel data
+		// Converted to UYVY or UYVA for YUV formats
+		if (bResult)
+			return NDIsender.SendImage((const unsigned char *)ndiBuffer[m_idx].getData(), width, height, false, bInvert);
 	}
 
-	// Send pixel data
-	// NDI video frame line stride has been set to match the data format.
-	// (see ofxNDIsend::SetVideoStride)
-	if (bResult)
-		return NDIsender.SendImage((const unsigned char *)ndiBuffer[m_idx].getData(), width, height, false, bInvert);
-
+	// No pixels to send, e.g. the first frames of asynchronous readback,
+	// so the next frame is checked again for receivers and tally
+	NDIsender.CancelFrame();
 	return false;
 
 }
@@ -352,8 +380,11 @@ bool ofxNDIsender::SendImage(const unsigned char * pixels,
 		return false;
 
 	// NDI format must be set to RGBA to match the pixel data
+	// or to YUV for conversion from RGBA
 	if (!(GetFormat() == NDIlib_FourCC_video_type_RGBA
-	   || GetFormat() == NDIlib_FourCC_video_type_RGBX)) {
+	   || GetFormat() == NDIlib_FourCC_video_type_RGBX
+	   || GetFormat() == NDIlib_FourCC_video_type_UYVY
+	   || GetFormat() == NDIlib_FourCC_video_type_UYVA)) {
 			SetFormat(NDIlib_FourCC_video_type_RGBA);
 	}
 
@@ -367,24 +398,33 @@ bool ofxNDIsender::SendImage(const unsigned char * pixels,
 
 }
 
+// Set the timecode and metadata of the next frame sent
+void ofxNDIsender::SetFrameInfo(const ofxNDIsend::FrameInfo& info)
+{
+	NDIsender.SetFrameInfo(info);
+}
+
 // Set output format
 void ofxNDIsender::SetFormat(NDIlib_FourCC_video_type_e format)
 {
-	if (format == NDIlib_FourCC_video_type_UYVY) {
-		// For YUV format, test existence of required rgba2yuv shader folder
-		std::string shaderpath = ofFilePath::getCurrentExeDir();
-		shaderpath += "data\\rgba2yuv\\";
-		if (ofDirectory::doesDirectoryExist(shaderpath, false)) {
-			NDIsender.SetFormat(format);
-			// Buffer size will change between YUV and RGBA
-			// Retain sender dimensions, but update the sender
-			// to re-create pbos, buffers and NDI video frame
-			// Update sender if already created (UpdateSender checks)
-			UpdateSender(NDIsender.GetWidth(), NDIsender.GetHeight());
-		}
-		else {
-			printf("rgba2yuv shader not found\n");
+	if (format == NDIlib_FourCC_video_type_UYVY || format == NDIlib_FourCC_video_type_UYVA) {
+		// For UYVY format, test existence of rgba2yuv shader folder
+		// for conversion of textures by shader.
+		// Otherwise rgba pixels are converted to YUV by the CPU.
+		m_bYUVshader = false;
+		if (format == NDIlib_FourCC_video_type_UYVY) {
+			std::string shaderpath = ofFilePath::getCurrentExeDir();
+			shaderpath += "data\\rgba2yuv\\";
+			m_bYUVshader = ofDirectory::doesDirectoryExist(shaderpath, false);
+			if (!m_bYUVshader)
+				printf("rgba2yuv shader not found - using CPU conversion\n");
 		}
+		NDIsender.SetFormat(format);
+		// Buffer size will change between YUV and RGBA
+		// Retain sender dimensions, but update the sender
+		// to re-create pbos, buffers and NDI video frame
+		// Update sender if already created (UpdateSender checks)
+		UpdateSender(NDIsender.GetWidth(), NDIsender.GetHeight());
 	}
 	else if (format == NDIlib_FourCC_video_type_BGRA
 		  || format == NDIlib_FourCC_video_type_BGRX
@@ -406,6 +446,18 @@ NDIlib_FourCC_video_type_e ofxNDIsender::GetFormat()
 	return NDIsender.GetFormat();
 }
 
+// Set YUV colour matrix for CPU conversion to UYVY or UYVA
+void ofxNDIsender::SetYUVmatrix(ofxNDIutils::YUVmatrix matrix)
+{
+	NDIsender.SetYUVmatrix(matrix);
+}
+
+// Set YUV colorimetry for CPU and shader conversion to UYVY or UYVA
+void ofxNDIsender::SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry)
+{
+	NDIsender.SetColorimetry(colorimetry);
+}
+
 // Set frame rate whole number
 void ofxNDIsender::SetFrameRate(int framerate)
 {
@@ -504,6 +556,46 @@ bool ofxNDIsender::GetAsync()
 	return NDIsender.GetAsync();
 }
 
+#if defined(USE_CHRONO)
+// Set to hold the frame rate in async sending mode
+void ofxNDIsender::SetPacing(bool bPacing)
+{
+	NDIsender.SetPacing(bPacing);
+}
+
+// Get whether async frames are paced
+bool ofxNDIsender::GetPacing()
+{
+	return NDIsender.GetPacing();
+}
+#endif
+
+// Set the number of local buffers used in rotation for async sending
+void ofxNDIsender::SetFrameBuffers(unsigned int nBuffers)
+{
+	NDIsender.SetFrameBuffers(nBuffers);
+}
+
+// Get the number of local buffers for async sending
+unsigned int ofxNDIsender::GetFrameBuffers()
+{
+	return NDIsender.GetFrameBuffers();
+}
+
+#if defined(USE_THREADS)
+// Set to send from a worker thread
+void ofxNDIsender::SetWorkerThread(bool bWorker)
+{
+	NDIsender.SetWorkerThread(bWorker);
+}
+
+// Get whether frames are sent from a worker thread
+bool ofxNDIsender::GetWorkerThread()
+{
+	return NDIsender.GetWorkerThread();
+}
+#endif
+
 // Set asynchronous readback of pixels from FBO or texture
 void ofxNDIsender::SetReadback(bool bReadback)
 {
@@ -552,6 +644,18 @@ void ofxNDIsender::SetAudioData(float *data)
 	NDIsender.SetAudioData(data);
 }
 
+// Set to send audio from a FIFO
+void ofxNDIsender::SetAudioFifo(bool bFifo, int capacity)
+{
+	NDIsender.SetAudioFifo(bFifo, capacity);
+}
+
+// Push audio samples to the FIFO
+int ofxNDIsender::PushAudio(const float *data, int nSamples, bool bInterleaved)
+{
+	return NDIsender.PushAudio(data, nSamples, bInterleaved);
+}
+
 // Set to send metadata
 void ofxNDIsender::SetMetadata(bool bMetadata)
 {
@@ -570,6 +674,61 @@ std::string ofxNDIsender::GetNDIversion()
 	return NDIsender.GetNDIversion();
 }
 
+// Set to skip frames while no receivers are connected
+void ofxNDIsender::SetConnectionSkip(bool bSkip, unsigned int interval)
+{
+	NDIsender.SetConnectionSkip(bSkip, interval);
+}
+
+// Get whether unconnected frames are skipped
+bool ofxNDIsender::GetConnectionSkip()
+{
+	return NDIsender.GetConnectionSkip();
+}
+
+// Number of receivers connected
+int ofxNDIsender::GetConnections()
+{
+	return NDIsender.GetConnections();
+}
+
+// Number of frames skipped while not connected
+uint64_t ofxNDIsender::GetSkippedFrames()
+{
+	return NDIsender.GetSkippedFrames();
+}
+
+// Set to reduce the frame rate of a sender not on program
+void ofxNDIsender::SetTallyPolicy(bool bPolicy, unsigned int previewDivisor,
+	unsigned int idleDivisor, bool bScale)
+{
+	NDIsender.SetTallyPolicy(bPolicy, previewDivisor, idleDivisor, bScale);
+}
+
+// Get whether the tally policy is enabled
+bool ofxNDIsender::GetTallyPolicy()
+{
+	return NDIsender.GetTallyPolicy();
+}
+
+// Tally of the sender
+void ofxNDIsender::GetTally(bool &bOnProgram, bool &bOnPreview)
+{
+	NDIsender.GetTally(bOnProgram, bOnPreview);
+}
+
+// Frame rate divisor currently applied by the tally policy
+unsigned int ofxNDIsender::GetTallyDivisor()
+{
+	return NDIsender.GetTallyDivisor();
+}
+
+// Number of frames not sent because of the tally policy
+uint64_t ofxNDIsender::GetTallySkipped()
+{
+	return NDIsender.GetTallySkipped();
+}
+
 //
 // =========== Private functions ===========
 //
@@ -632,6 +791,8 @@ bool ofxNDIsender::ReadTexturePixels(ofTexture tex, unsigned int width, unsigned
 	if (!data || m_pbo[0] == 0 || !ndiFbo.isAllocated())
 		return false;
 
+	OFXNDI_TIMER(readback, "sender.readback");
+
 	void *pboMemory = nullptr;
 
 	PboIndex = (PboIndex + 1) % 3;
@@ -728,12 +889,24 @@ bool ofxNDIsender::ReadYUVpixels(ofTexture &tex, unsigned int halfwidth, unsigne
 			return false;
 	}
 
+	// Coefficients for the sender matrix and range
+	// as used for CPU conversion
+	float coeffs[12];
+	ofxNDIutils::GetRGBtoYUVshaderCoefficients(NDIsender.GetColorimetry(), halfwidth * 2, coeffs);
+
 	// Convert the rgba texture to YUV via fbo
 	ndiFbo.begin();
 	ofDisableAlphaBlending();
 	ofDisableDepthTest();
 	rgba2yuv.begin();
 	rgba2yuv.setUniformTexture("rgbatex", tex, 1);
+	rgba2yuv.setUniform4f("ycoeffs", coeffs[0], coeffs[1], coeffs[2], coeffs[3]);
+	rgba2yuv.setUniform4f("ucoeffs", coeffs[4], coeffs[5], coeffs[6], coeffs[7]);
+	rgba2yuv.setUniform4f("vcoeffs", coeffs[8], coeffs[9], coeffs[10], coeffs[11]);
+#ifdef TARGET_OPENGLES
+	// Normalized texel size to sample pixel centres
+	rgba2yuv.setUniform2f("texelSize", 1.0f / tex.getWidth(), 1.0f / tex.getHeight());
+#endif
 	tex.draw(0, 0);
 	rgba2yuv.end();
 	ndiFbo.end();
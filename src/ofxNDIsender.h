@@ -27,6 +27,16 @@
 	08.07.18 - Use ofxNDIsend class
 	07.12.19 - remove iostream
 	26.12.21 - Correct m_pbo dimension from 2 to 3. PR #27 by Dimitre
+	15.10.26 - Add SetYUVmatrix. UYVY and UYVA from CPU conversion.
+			   Add SetColorimetry for CPU and shader conversion.
+			   Add SetPacing for async mode.
+			   Add SetFrameBuffers for async mode.
+	16.10.26 - Add SetWorkerThread.
+			   Add SetAudioFifo and PushAudio.
+			   Add SetConnectionSkip.
+			   Add SetTallyPolicy and GetTally.
+			   Add SetFrameInfo.
+			   SetPacing and GetPacing only if USE_CHRONO.
 
 */
 #pragma once
@@ -118,12 +128,31 @@ public:
 	bool SendImage(const unsigned char *image, unsigned int width, unsigned int height,
 		bool bSwapRB = false, bool bInvert = false);
 
+	// Set the timecode and metadata of the next frame sent
+	// (see ofxNDIsend::SetFrameInfo)
+	// With asynchronous readback (SetReadback) the next frame
+	// sent has the pixels read back for the previous one.
+	// - info | timecode in 100ns intervals and XML metadata
+	void SetFrameInfo(const ofxNDIsend::FrameInfo& info);
+
 	// Set output format
+	// RGBA, RGBX, BGRA, BGRX, UYVY or UYVA
+	// UYVY textures are converted by the rgba2yuv shader if found,
+	// otherwise pixels are converted to YUV by the CPU
 	void SetFormat(NDIlib_FourCC_video_type_e format);
 
 	// Get output format
 	NDIlib_FourCC_video_type_e GetFormat();
 
+	// Set YUV colour matrix for CPU conversion to UYVY or UYVA
+	// Initialized YUV_MATRIX_AUTO (BT.601 for SD and BT.709 for HD)
+	void SetYUVmatrix(ofxNDIutils::YUVmatrix matrix);
+
+	// Set YUV colorimetry (matrix and range) for conversion to UYVY or UYVA
+	// Used by both CPU and shader conversion
+	// Initialized YUV_MATRIX_AUTO, YUV_RANGE_LIMITED
+	void SetColorimetry(ofxNDIutils::YUVcolorimetry colorimetry);
+
 	// Set frame rate whole number
 	// - framerate - frames per second
 	// Initialized 60fps
@@ -186,6 +215,34 @@ public:
 	// Get whether async sending mode
 	bool GetAsync();
 
+#if defined(USE_CHRONO)
+	// Set to hold the frame rate in async sending mode
+	// Frames are sent at exact frame rate deadlines
+	// Initialized false
+	void SetPacing(bool bPacing = true);
+
+	// Get whether async frames are paced
+	bool GetPacing();
+#endif
+
+	// Set the number of local buffers used in rotation for async sending
+	// 2 to 4 buffers. Initialized 2.
+	void SetFrameBuffers(unsigned int nBuffers = 2);
+
+	// Get the number of local buffers for async sending
+	unsigned int GetFrameBuffers();
+
+#if defined(USE_THREADS)
+	// Set to send from a worker thread
+	// Frames are queued and sent without waiting for clocked video
+	// (see ofxNDIsend::SetWorkerThread and SetSendQueue)
+	// Initialized false
+	void SetWorkerThread(bool bWorker = true);
+
+	// Get whether frames are sent from a worker thread
+	bool GetWorkerThread();
+#endif
+
 	// Set asynchronous readback of pixels from FBO or texture
 	void SetReadback(bool bReadback = true);
 
@@ -220,6 +277,20 @@ public:
 	// - data | data to send (float)
 	void SetAudioData(float *data = NULL); // Audio data
 
+	// Set to send audio from a FIFO instead of SetAudioData
+	// Audio is sent in chunks of the frame duration independent
+	// of how often frames are sent (see ofxNDIsend::SetAudioFifo)
+	// - capacity | samples per channel the FIFO holds (0 for one second)
+	void SetAudioFifo(bool bFifo = true, int capacity = 0);
+
+	// Push audio samples to the FIFO
+	// Can be called from an audio thread
+	// - data | float samples, planar or interleaved
+	// - nSamples | samples per channel
+	// - bInterleaved | samples of all channels in turn - default false
+	// Returns the number of samples pushed
+	int PushAudio(const float *data, int nSamples, bool bInterleaved = false);
+
 	// Set to send metadata
 	// Initialized false
 	void SetMetadata(bool bMetadata = true);
@@ -231,6 +302,43 @@ public:
 	// Get the current NDI SDK version
 	std::string GetNDIversion();
 
+	// Set to skip frames while no receivers are connected
+	// Texture readback, conversion and sending are skipped
+	// (see ofxNDIsend::SetConnectionSkip)
+	// - interval | milliseconds between polls of the connections
+	// Initialized false
+	void SetConnectionSkip(bool bSkip = true, unsigned int interval = 1000);
+
+	// Get whether unconnected frames are skipped
+	bool GetConnectionSkip();
+
+	// Number of receivers connected
+	int GetConnections();
+
+	// Number of frames skipped while not connected
+	uint64_t GetSkippedFrames();
+
+	// Set to reduce the frame rate of a sender not on program
+	// (see ofxNDIsend::SetTallyPolicy)
+	// - previewDivisor | frame rate divisor on preview only
+	// - idleDivisor | frame rate divisor on neither
+	// - bScale | half size on preview, quarter size on neither
+	// Initialized false
+	void SetTallyPolicy(bool bPolicy = true, unsigned int previewDivisor = 2,
+		unsigned int idleDivisor = 4, bool bScale = false);
+
+	// Get whether the tally policy is enabled
+	bool GetTallyPolicy();
+
+	// Tally of the sender
+	void GetTally(bool &bOnProgram, bool &bOnPreview);
+
+	// Frame rate divisor currently applied by the tally policy
+	unsigned int GetTallyDivisor();
+
+	// Number of frames not sent because of the tally policy
+	uint64_t GetTallySkipped();
+
 private:
 
 	ofxNDIsend NDIsender; // Basic sender functions
@@ -262,6 +370,7 @@ private:
 	//
 
 	ofShader rgba2yuv;  // RGBA to YUV shader
+	bool m_bYUVshader;  // rgba2yuv shader folder found
 
 	// Read YUV pixels from RGBA fbo to pixel buffer
 	bool ReadYUVpixels(ofFbo &fbo, unsigned int halfwidth, unsigned int height, ofPixels &buffer);
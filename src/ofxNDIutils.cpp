@@ -59,10 +59,80 @@
 	19.05.24 - Add GetVersion() - return addon version number string
 	30.05.24 - Revise YUV422_to_RGBA conversion equations
 	16.09.24 - change UINT to uint32_t PeriodMin
+	15.10.26 - Enable SSE2 functions for Linux x86-64
+			 - Add runtime CPU dispatch of SSE2, AVX2 and AVX-512 kernels
+			   for copy, rgba<>bgra swap and flip
+			 - __movsd for gcc x86 moves 4 byte words (rep movsl)
+			 - YUV422_to_RGBA - SSE2 and AVX2 versions with runtime dispatch
+			   Matrix selected per frame instead of per pixel
+			   Use stride as the source line pitch
+			 - Add worker thread pool to convert large images in stripes
+			   SetThreadCount, SetThreadMinimum
+			 - Add RGBA_to_YUV422 with SSE2 and AVX2 versions
+			   Optional BT.601/BT.709 matrix for YUV conversions
+			 - Add NV12_to_RGBA and I420_to_RGBA (I420 and YV12)
+			   with SSE2 and AVX2 versions and RGBA or BGRA output
+			 - Add P216 and PA16 conversions to and from 16 bit and float RGBA
+			 - CopyImage - single pass copy with source and dest pitch,
+			   rgba<>bgra and invert. Stride overload uses the source stride.
+			 - FlipVertical - in place with no allocation, declared in the header
+			 - Add YUVcolorimetry (BT.601, BT.709, BT.2020, limited or full range)
+			   8 bit coefficient tables generated at compile time
+			   YUV to RGB luma scale 298/256 instead of 297/256 (white 255)
+			 - Add GetRGBtoYUVshaderCoefficients for the rgba2yuv shaders
+			 - Add ScaleImage and ScaleYUV422_to_RGBA to receive at reduced size
+			   Box filter SSE2 and AVX2 kernels for half and quarter size
+			 - Add CopyBuffer. Non-temporal stores only for copies larger than
+			   the last level cache detected at runtime. SetStreamingThreshold,
+			   SetPrefetchDistance.
+			 - memcpy_sse2 - use CopyBuffer for any size and alignment
+			 - memcpy_movsd - copy remaining bytes
+			 - Add VerifyKernels to compare SIMD kernels with the C++ kernels
+			 - Add NEON kernels for ARM (USE_NEON) for rgba<>bgra swap, flip,
+			   UYVY and YUV 4:2:0 to RGBA, RGBA to UYVY and box downscale
+			 - Add FramePacer with absolute deadlines for N/D frame rates,
+			   sleep then yield to the deadline and a missed deadline count
+			 - HoldFps - use a FramePacer. Not truncated to milliseconds.
+			 - Add stage timers with per thread histograms and GetStageTimings
+			 - Add AlignedAlloc and AlignedFree for SIMD and cache line aligned buffers
+	16.10.26 - Add AudioFifo. Lock-free single producer, single consumer
+			   planar float sample queue for sender audio.
+			 - Add FramesToTime for timecodes of N/D frame rates
+			 - Add ConvertAudio for float, 16 and 32 bit audio, planar and
+			   interleaved, with gain and optional dither in one pass.
+			   SSE2 kernels. InterleaveAudio, DeinterleaveAudio, AudioGain.
+			 - AudioFifo::Pop - discard the samples if dest is null
+			 - SetSimdLevel - publish a fixed table for each level with an
+			   atomic pointer instead of copying into the table in use
+			 - YUV422_to_RGBA - add bInvert
+			 - Remove the NEON kernels, which were not built or verified on ARM
 
 */
 #include "ofxNDIutils.h"
 
+#include <algorithm> // std::min, std::max
+#include <functional>
+#include <utility> // std::swap
+#include <vector>
+#include <atomic>
+#include <cmath> // std::fabs
+#if defined(USE_THREADS)
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#if defined(USE_STAGE_TIMING)
+#include <mutex> // stage name registry
+#endif
+#if defined(TARGET_OSX) || defined(TARGET_OF_IOS)
+#include <sys/sysctl.h> // sysctlbyname for cache size
+#elif !defined(TARGET_WIN32)
+#include <unistd.h> // sysconf for cache size
+#endif
+#if defined(TARGET_WIN32)
+#include <malloc.h> // _aligned_malloc
+#endif
+
 // _rotl replacement
 // Other solutions possible
 // https://stackoverflow.com/questions/776508/best-practices-for-circular-shift-rotate-operations-in-c
@@ -81,19 +151,18 @@ namespace ofxNDIutils {
 	// Timing counters
 	std::chrono::steady_clock::time_point start;
 	std::chrono::steady_clock::time_point end;
-	// For HoldFps
-	std::chrono::steady_clock::time_point FrameStartPtr;
-	std::chrono::steady_clock::time_point FrameEndPtr;
+	// For StartTimePeriod and EndTimePeriod
 	uint32_t PeriodMin = 0;
 #endif
 
-#if defined (__APPLE__)
+#if !defined(TARGET_WIN32) && defined(USE_SSE2)
 
+	// n is the number of 4 byte words
 	static inline void *__movsd(void *d, const void *s, size_t n) {
 #if defined(__aarch64__)
-        return memcpy(d, s, n);
+        return memcpy(d, s, n*4);
 #else
-		asm volatile ("rep movsb"
+		asm volatile ("rep movsl"
 			: "=D" (d),
 			"=S" (s),
 			"=c" (n)
@@ -107,15 +176,18 @@ namespace ofxNDIutils {
 #endif
 
 
-#if defined(TARGET_WIN32) || defined (TARGET_OSX)
+#if defined(USE_SSE2)
 
 	// movsd requires 4 byte aligned data
+	// Remaining bytes of a size that is not a multiple of 4 are also copied
 	void memcpy_movsd(void* dst, const void* src, size_t Size)
 	{
 		// one DWORD per rep move
 		const unsigned long *pSrc = static_cast<const unsigned long *>(src); // Source buffer
 		unsigned long *pDst = static_cast<unsigned long *>(dst); // Dest buffer
 		__movsd(pDst, pSrc, Size >> 2); //Size divided by 4 (4 bytes per rep move)
+		if (Size & 3)
+			memcpy(static_cast<char*>(dst) + (Size & ~(size_t)3), static_cast<const char*>(src) + (Size & ~(size_t)3), Size & 3);
 	}
 
 	//
@@ -128,47 +200,12 @@ namespace ofxNDIutils {
 	//	http://www.gamedev.net/topic/502313-special-case---faster-than-memcpy/
 	//	and others.
 	//
-	// Approx 1.7 times speed of memcpy (0.84 msec per frame 1920x1080)
+	// The original copied only whole 128 byte blocks with aligned loads.
+	// Now uses CopyBuffer for any size and alignment.
 	//
 	void memcpy_sse2(void* dst, const void* src, size_t Size)
 	{
-		char * pSrc = (char *)src;				  // Source buffer
-		char * pDst = (char *)dst;				  // Destination buffer
-		unsigned int n = (unsigned int)Size >> 7; // Counter = size divided by 128 (8 * 128bit registers)
-
-		__m128i Reg0, Reg1, Reg2, Reg3, Reg4, Reg5, Reg6, Reg7;
-		for (unsigned int Index = n; Index > 0; --Index) {
-
-			// SSE2 prefetch
-			_mm_prefetch(pSrc + 256, _MM_HINT_NTA);
-			_mm_prefetch(pSrc + 256 + 64, _MM_HINT_NTA);
-
-			// move data from src to registers
-			// 8 x 128 bit (16 bytes each)
-			// Increment source pointer by 16 bytes each
-			// for a total of 128 bytes per cycle
-			Reg0 = _mm_load_si128((__m128i *)(pSrc));
-			Reg1 = _mm_load_si128((__m128i *)(pSrc + 16));
-			Reg2 = _mm_load_si128((__m128i *)(pSrc + 32));
-			Reg3 = _mm_load_si128((__m128i *)(pSrc + 48));
-			Reg4 = _mm_load_si128((__m128i *)(pSrc + 64));
-			Reg5 = _mm_load_si128((__m128i *)(pSrc + 80));
-			Reg6 = _mm_load_si128((__m128i *)(pSrc + 96));
-			Reg7 = _mm_load_si128((__m128i *)(pSrc + 112));
-
-			// move data from registers to dest
-			_mm_stream_si128((__m128i *)(pDst), Reg0);
-			_mm_stream_si128((__m128i *)(pDst + 16), Reg1);
-			_mm_stream_si128((__m128i *)(pDst + 32), Reg2);
-			_mm_stream_si128((__m128i *)(pDst + 48), Reg3);
-			_mm_stream_si128((__m128i *)(pDst + 64), Reg4);
-			_mm_stream_si128((__m128i *)(pDst + 80), Reg5);
-			_mm_stream_si128((__m128i *)(pDst + 96), Reg6);
-			_mm_stream_si128((__m128i *)(pDst + 112), Reg7);
-
-			pSrc += 128;
-			pDst += 128;
-		}
+		CopyBuffer(dst, src, Size);
 	} // end memcpy_sse2
 
 
@@ -250,396 +287,4212 @@ namespace ofxNDIutils {
 		}
 	} // end rgba_bgra_sse2
 
-#endif // endif TARGET_WIN32 || TARGET_OSX
-
-	// Without SSE
-	void rgba_bgra(const void *rgba_source, void *bgra_dest,
-		unsigned int width, unsigned int height, bool bInvert)
-	{
-
-		for (unsigned int y = 0; y < height; y++) {
+#endif // endif USE_SSE2
 
-			// Start of buffer
-			auto source = static_cast<const uint32_t*>(rgba_source);; // unsigned int = 4 bytes
-			auto dest = static_cast<uint32_t*>(bgra_dest);
+	//
+	// Image function kernels
+	//
+	// Each kernel processes one line or one block of memory.
+	// The fastest version supported by the CPU is selected when first used.
+	// AVX2 and AVX-512 functions are compiled for their own instruction set
+	// so that the remaining code does not require any compiler option.
+	//
 
-			// Cast first to avoid warning C26451: Arithmetic overflow
-			unsigned long H1YxW = (unsigned long)((height - 1 - y) * width);
-			unsigned long YxW = (unsigned long)(y * width);
+#if defined(USE_AVX) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_FUNC __attribute__((target("avx2")))
+#define AVX512_FUNC __attribute__((target("avx512f,avx512bw")))
+#else
+#define AVX2_FUNC
+#define AVX512_FUNC
+#endif
 
-			// Increment to current line
-			if (bInvert) {
-				source += H1YxW;
-				dest += YxW; // dest is not inverted
-			}
-			else {
-				source += YxW;
-				dest += YxW;
-			}
+	//
+	// Copy strategy
+	//
+	// Copies that are larger than the last level cache use non-temporal
+	// stores so that the destination does not evict the source or other
+	// data from the cache. Smaller copies use regular stores and the
+	// result stays in cache for whatever reads it next.
+	// Source data is prefetched ahead of non-temporal copies.
+	//
+	static std::atomic<size_t> StreamingThreshold(0); // 0 for the cache size
+	static std::atomic<unsigned int> PrefetchDistance(512); // 0 for none
 
-			for (unsigned int x = 0; x < width; x++) {
-				auto rgbapix = source[x];
+	// Swap red and blue of one rgba pixel
+	static inline uint32_t swap_rb(uint32_t rgbapix)
+	{
+		// rgbapix << 16		: a r g b > g b a r
+		//        & 0x00ff00ff  : r g b . > . b . r
+		// rgbapix & 0xff00ff00 : a r g b > a . g .
+		// result of or			:           a b g r
 #if defined(TARGET_WIN32)
-				// _rotl is available
-				dest[x] = (_rotl(rgbapix, 16) & 0x00ff00ff) | (rgbapix & 0xff00ff00);
+		// _rotl is available
+		return (_rotl(rgbapix, 16) & 0x00ff00ff) | (rgbapix & 0xff00ff00);
 #else
-				// _rotl replacement
-				dest[x] = (ROL(rgbapix, 16) & 0x00ff00ff) | (rgbapix & 0xff00ff00);
+		// _rotl replacement
+		return (ROL(rgbapix, 16) & 0x00ff00ff) | (rgbapix & 0xff00ff00);
 #endif
-			}
+	}
 
-		}
+	// C++ copy
+	static void copy_cpp(void* dst, const void* src, size_t size, bool bStream)
+	{
+		(void)bStream;
+		memcpy(dst, src, size);
+	}
 
-	} // end rgba_bgra
+	// C++ rgba <> bgra line
+	static void swap_cpp(const uint32_t* src, uint32_t* dst, unsigned int npixels)
+	{
+		for (unsigned int x = 0; x < npixels; x++)
+			dst[x] = swap_rb(src[x]);
+	}
 
+	// C++ exchange of two lines
+	static void swaplines_cpp(unsigned char* a, unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t t0, t1;
+			memcpy(&t0, a + i, 8);
+			memcpy(&t1, b + i, 8);
+			memcpy(a + i, &t1, 8);
+			memcpy(b + i, &t0, 8);
+		}
+		for (; i < size; i++)
+			std::swap(a[i], b[i]);
+	}
 
-	// Flip a buffer in place
-	void FlipBuffer(const unsigned char *src,
-		unsigned char *dst,
-		unsigned int width,
-		unsigned int height)
+#if defined(USE_SSE2)
+
+	// SSE2 copy
+	// Non-temporal stores if bStream is set
+	// Any source alignment and size
+	static void copy_sse2(void* dst, const void* src, size_t size, bool bStream)
 	{
-		const unsigned char * From = src;
-		unsigned char * To = dst;
-		unsigned int pitch = width * 4; // RGBA default
-		unsigned int line_s = 0;
-		unsigned int line_t = (height - 1)*pitch;
-
-		for (unsigned int y = 0; y < height; y++) {
-			// @zilog no SSE stuff for aarch64 build
-#if defined(TARGET_WIN32) || defined (TARGET_OSX)
-			if (width <= 512 || height <= 512) // too small for assembler
-				memcpy((void *)(To + line_t), (void *)(From + line_s), pitch);
-			else if ((pitch % 16) == 0) // use sse assembler function
-				memcpy_sse2((void *)(To + line_t), (void *)(From + line_s), pitch);
-			else if ((pitch % 4) == 0) // use 4 byte move assembler function
-				memcpy_movsd((unsigned long *)(To + line_t), (unsigned long *)(From + line_s), pitch);
-			else
-#endif
-				memcpy((void *)(To + line_t), (void *)(From + line_s), pitch);
+		unsigned char* pDst = static_cast<unsigned char*>(dst);
+		const unsigned char* pSrc = static_cast<const unsigned char*>(src);
 
-			line_s += pitch;
-			line_t -= pitch;
+		if (!bStream || size < 256) {
+			memcpy(pDst, pSrc, size);
+			return;
 		}
-	} // end FlipBuffer
+		const size_t ahead = PrefetchDistance.load(std::memory_order_relaxed);
 
-	//
-	// Flip an image vertically
-	//
-	// http://www.codeproject.com/Questions/369873/How-can-i-flip-the-image-Vertically-using-cplusplu
-	//
-	bool FlipVertical(unsigned char *inbuf, long widthBytes, long height)
-	{
-		unsigned char *tb1;
-		unsigned char *tb2;
-		long bufsize;
-		long row_cnt;
-		long off1 = 0;
-		long off2 = 0;
+		// Align the destination for streaming stores
+		size_t head = (16 - (reinterpret_cast<uintptr_t>(pDst) & 15)) & 15;
+		memcpy(pDst, pSrc, head);
+		pDst += head;
+		pSrc += head;
+		size -= head;
 
-		if (inbuf == NULL)
-			return false;
+		for (; size >= 64; size -= 64) {
+			if (ahead)
+				_mm_prefetch((const char*)(pSrc + ahead), _MM_HINT_NTA);
+			__m128i Reg0 = _mm_loadu_si128((const __m128i*)(pSrc));
+			__m128i Reg1 = _mm_loadu_si128((const __m128i*)(pSrc + 16));
+			__m128i Reg2 = _mm_loadu_si128((const __m128i*)(pSrc + 32));
+			__m128i Reg3 = _mm_loadu_si128((const __m128i*)(pSrc + 48));
+			_mm_stream_si128((__m128i*)(pDst), Reg0);
+			_mm_stream_si128((__m128i*)(pDst + 16), Reg1);
+			_mm_stream_si128((__m128i*)(pDst + 32), Reg2);
+			_mm_stream_si128((__m128i*)(pDst + 48), Reg3);
+			pSrc += 64;
+			pDst += 64;
+		}
+		_mm_sfence();
 
-		bufsize = widthBytes * 4;
+		// Remainder
+		memcpy(pDst, pSrc, size);
+	}
 
-		tb1 = (unsigned char *)malloc(bufsize);
-		if (tb1 == NULL) {
-			return false;
+	// SSE2 rgba <> bgra line
+	static void swap_sse2(const uint32_t* src, uint32_t* dst, unsigned int npixels)
+	{
+		const __m128i brMask = _mm_set1_epi32(0x00ff00ff);
+		unsigned int x = 0;
+		for (; x + 4 <= npixels; x += 4) {
+			__m128i sourceData = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+			// Mask out g and a, which don't change
+			__m128i gaComponents = _mm_andnot_si128(brMask, sourceData);
+			// Mask out b and r
+			__m128i brComponents = _mm_and_si128(sourceData, brMask);
+			// Swap b and r
+			__m128i brSwapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(brComponents, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_or_si128(gaComponents, brSwapped));
 		}
+		for (; x < npixels; x++)
+			dst[x] = swap_rb(src[x]);
+	}
 
-		tb2 = (unsigned char *)malloc(bufsize);
-		if (tb2 == NULL) {
-			free((void *)tb1);
-			return false;
+
+	// SSE2 exchange of two lines
+	// One cache line of each per loop
+	static void swaplines_sse2(unsigned char* a, unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+		for (; i + 64 <= size; i += 64) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(a + i));
+			__m128i a1 = _mm_loadu_si128((const __m128i*)(a + i + 16));
+			__m128i a2 = _mm_loadu_si128((const __m128i*)(a + i + 32));
+			__m128i a3 = _mm_loadu_si128((const __m128i*)(a + i + 48));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(b + i));
+			__m128i b1 = _mm_loadu_si128((const __m128i*)(b + i + 16));
+			__m128i b2 = _mm_loadu_si128((const __m128i*)(b + i + 32));
+			__m128i b3 = _mm_loadu_si128((const __m128i*)(b + i + 48));
+			_mm_storeu_si128((__m128i*)(a + i), b0);
+			_mm_storeu_si128((__m128i*)(a + i + 16), b1);
+			_mm_storeu_si128((__m128i*)(a + i + 32), b2);
+			_mm_storeu_si128((__m128i*)(a + i + 48), b3);
+			_mm_storeu_si128((__m128i*)(b + i), a0);
+			_mm_storeu_si128((__m128i*)(b + i + 16), a1);
+			_mm_storeu_si128((__m128i*)(b + i + 32), a2);
+			_mm_storeu_si128((__m128i*)(b + i + 48), a3);
 		}
+		swaplines_cpp(a + i, b + i, size - i);
+	}
 
-		for (row_cnt = 0; row_cnt < (height + 1) / 2; row_cnt++)
-		{
-			off1 = row_cnt * bufsize;
-			off2 = ((height - 1) - row_cnt)*bufsize;
-			memcpy((void *)tb1, (void *)(inbuf + off1), bufsize * sizeof(unsigned char));
-			memcpy((void *)tb2, (void *)(inbuf + off2), bufsize * sizeof(unsigned char));
-			memcpy((void *)(inbuf + off1), (void *)tb2, bufsize * sizeof(unsigned char));
-			memcpy((void *)(inbuf + off2), (void *)tb1, bufsize * sizeof(unsigned char));
+#endif // endif USE_SSE2
+
+#if defined(USE_AVX)
+
+	// AVX2 copy
+	// Non-temporal stores if bStream is set
+	static AVX2_FUNC void copy_avx2(void* dst, const void* src, size_t size, bool bStream)
+	{
+		unsigned char* pDst = static_cast<unsigned char*>(dst);
+		const unsigned char* pSrc = static_cast<const unsigned char*>(src);
+
+		if (!bStream || size < 512) {
+			memcpy(pDst, pSrc, size);
+			return;
 		}
+		const size_t ahead = PrefetchDistance.load(std::memory_order_relaxed);
 
-		free((void*)tb1);
-		free((void*)tb2);
+		size_t head = (32 - (reinterpret_cast<uintptr_t>(pDst) & 31)) & 31;
+		memcpy(pDst, pSrc, head);
+		pDst += head;
+		pSrc += head;
+		size -= head;
 
-		return true;
+		for (; size >= 128; size -= 128) {
+			if (ahead)
+				_mm_prefetch((const char*)(pSrc + ahead), _MM_HINT_NTA);
+			__m256i Reg0 = _mm256_loadu_si256((const __m256i*)(pSrc));
+			__m256i Reg1 = _mm256_loadu_si256((const __m256i*)(pSrc + 32));
+			__m256i Reg2 = _mm256_loadu_si256((const __m256i*)(pSrc + 64));
+			__m256i Reg3 = _mm256_loadu_si256((const __m256i*)(pSrc + 96));
+			_mm256_stream_si256((__m256i*)(pDst), Reg0);
+			_mm256_stream_si256((__m256i*)(pDst + 32), Reg1);
+			_mm256_stream_si256((__m256i*)(pDst + 64), Reg2);
+			_mm256_stream_si256((__m256i*)(pDst + 96), Reg3);
+			pSrc += 128;
+			pDst += 128;
+		}
+		_mm_sfence();
+
+		memcpy(pDst, pSrc, size);
 	}
 
-	// ofxNDI version number string
-	// Major, minor, release
-	std::string GetVersion()
+	// AVX2 rgba <> bgra line
+	static AVX2_FUNC void swap_avx2(const uint32_t* src, uint32_t* dst, unsigned int npixels)
 	{
-		return ofxNDIversion;
+		// Byte order for each pixel : b g r a
+		const __m256i shuffle = _mm256_setr_epi8(
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		unsigned int x = 0;
+		for (; x + 16 <= npixels; x += 16) {
+			__m256i p0 = _mm256_loadu_si256((const __m256i*)(src + x));
+			__m256i p1 = _mm256_loadu_si256((const __m256i*)(src + x + 8));
+			_mm256_storeu_si256((__m256i*)(dst + x), _mm256_shuffle_epi8(p0, shuffle));
+			_mm256_storeu_si256((__m256i*)(dst + x + 8), _mm256_shuffle_epi8(p1, shuffle));
+		}
+		for (; x + 8 <= npixels; x += 8) {
+			__m256i p0 = _mm256_loadu_si256((const __m256i*)(src + x));
+			_mm256_storeu_si256((__m256i*)(dst + x), _mm256_shuffle_epi8(p0, shuffle));
+		}
+		for (; x < npixels; x++)
+			dst[x] = swap_rb(src[x]);
 	}
 
-
-	// Copy rgba source image to dest.
-	// Images must be the same size with no line padding.
-	// Option flip image vertically (invert).
-	void CopyImage(const unsigned char *source, unsigned char *dest,
-		unsigned int width, unsigned int height, bool bInvert)
+	// AVX2 exchange of two lines
+	// Two cache lines of each per loop
+	static AVX2_FUNC void swaplines_avx2(unsigned char* a, unsigned char* b, size_t size)
 	{
-		CopyImage(source, dest,	width, height, width*4, false, bInvert);
-
-	} // end CopyImage
+		size_t i = 0;
+		for (; i + 128 <= size; i += 128) {
+			__m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+			__m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 32));
+			__m256i a2 = _mm256_loadu_si256((const __m256i*)(a + i + 64));
+			__m256i a3 = _mm256_loadu_si256((const __m256i*)(a + i + 96));
+			__m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+			__m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 32));
+			__m256i b2 = _mm256_loadu_si256((const __m256i*)(b + i + 64));
+			__m256i b3 = _mm256_loadu_si256((const __m256i*)(b + i + 96));
+			_mm256_storeu_si256((__m256i*)(a + i), b0);
+			_mm256_storeu_si256((__m256i*)(a + i + 32), b1);
+			_mm256_storeu_si256((__m256i*)(a + i + 64), b2);
+			_mm256_storeu_si256((__m256i*)(a + i + 96), b3);
+			_mm256_storeu_si256((__m256i*)(b + i), a0);
+			_mm256_storeu_si256((__m256i*)(b + i + 32), a1);
+			_mm256_storeu_si256((__m256i*)(b + i + 64), a2);
+			_mm256_storeu_si256((__m256i*)(b + i + 96), a3);
+		}
+		swaplines_sse2(a + i, b + i, size - i);
+	}
 
-	// Copy rgba source image to dest.
-	// Source line pitch (unused).
-	// Option convert bgra<>rgba.
-	// Option flip image vertically (invert).
-	void CopyImage(const unsigned char *source, unsigned char *dest,
-		unsigned int width, unsigned int height, unsigned int stride,
-		bool bSwapRB, bool bInvert)
+	// AVX-512 copy
+	// Non-temporal stores if bStream is set
+	static AVX512_FUNC void copy_avx512(void* dst, const void* src, size_t size, bool bStream)
 	{
-		if (source == nullptr || dest == nullptr)
-			return;
+		unsigned char* pDst = static_cast<unsigned char*>(dst);
+		const unsigned char* pSrc = static_cast<const unsigned char*>(src);
 
-		// user requires bgra->rgba or rgba->bgra conversion from source to dest
-		if (bSwapRB) {
-#if defined(TARGET_WIN32) || defined (TARGET_OSX)
-			rgba_bgra_sse2((const void *)source, (void *)dest, width, height, bInvert);
-#else
-			rgba_bgra((const void *)source, (void *)dest, width, height, bInvert);
-#endif
+		if (!bStream || size < 1024) {
+			memcpy(pDst, pSrc, size);
 			return;
 		}
+		const size_t ahead = PrefetchDistance.load(std::memory_order_relaxed);
 
-		if (bInvert) { // Flip the image in place
-			FlipBuffer(source, dest, width, height);
-		}
-		else {
-#if defined(TARGET_WIN32) || defined (TARGET_OSX)
-			// Small image just use memcpy
-			if (width < 512 || height < 256) {
-				memcpy((void *)dest, (const void *)source, (size_t)height* (size_t)stride);
-			}
-			else if ((stride % 16) == 0) { // 16 byte aligned
-				memcpy_sse2((void *)dest, (const void *)source, (size_t)height* (size_t)stride);
-			}
-			else if ((stride % 4) == 0) { // 4 byte aligned
-				memcpy_movsd((void*)dest, (const void *)source, (size_t)height* (size_t)stride);
-			}
-#else
-			// @zilog no SSE stuff for aarch64 build
-			memcpy((void *)dest, (const void *)source, (size_t)height* (size_t)stride);
-#endif
+		size_t head = (64 - (reinterpret_cast<uintptr_t>(pDst) & 63)) & 63;
+		memcpy(pDst, pSrc, head);
+		pDst += head;
+		pSrc += head;
+		size -= head;
+
+		for (; size >= 256; size -= 256) {
+			if (ahead)
+				_mm_prefetch((const char*)(pSrc + ahead), _MM_HINT_NTA);
+			__m512i Reg0 = _mm512_loadu_si512((const void*)(pSrc));
+			__m512i Reg1 = _mm512_loadu_si512((const void*)(pSrc + 64));
+			__m512i Reg2 = _mm512_loadu_si512((const void*)(pSrc + 128));
+			__m512i Reg3 = _mm512_loadu_si512((const void*)(pSrc + 192));
+			_mm512_stream_si512((__m512i*)(pDst), Reg0);
+			_mm512_stream_si512((__m512i*)(pDst + 64), Reg1);
+			_mm512_stream_si512((__m512i*)(pDst + 128), Reg2);
+			_mm512_stream_si512((__m512i*)(pDst + 192), Reg3);
+			pSrc += 256;
+			pDst += 256;
 		}
-	} // end CopyImage
+		_mm_sfence();
 
+		memcpy(pDst, pSrc, size);
+	}
 
-	// Copy rgba image buffers line by line.
-	// Allow for both source and destination line pitch.
-	// Option flip image vertically (invert).
-	void CopyImage(const void* rgba_source, void* rgba_dest,
-		unsigned int width, unsigned int height,
-		unsigned int sourcePitch, unsigned int destPitch,
-		bool bInvert)
+	// AVX-512 rgba <> bgra line
+	static AVX512_FUNC void swap_avx512(const uint32_t* src, uint32_t* dst, unsigned int npixels)
 	{
-		// For all rows
-		for (unsigned int y = 0; y < height; y++) {
-			// Start of buffers
-			auto source = static_cast<const uint32_t *>(rgba_source); // unsigned int = 4 bytes
-			auto dest = static_cast<uint32_t *>(rgba_dest);
-			// Increment to current line
-			// Pitch is line length in bytes. Divide by 4 to get the width in rgba pixels.
-			if (bInvert) {
-				source += (unsigned long)((height - 1 - y)*sourcePitch / 4);
-				dest   += (unsigned long)(y * destPitch / 4); // dest is not inverted
-			}
-			else {
-				source += (unsigned long)(y * sourcePitch / 4);
-				dest   += (unsigned long)(y * destPitch / 4);
-			}
+		// Byte order for each pixel : b g r a
+		const __m512i shuffle = _mm512_set4_epi32(0x0f0c0d0e, 0x0b08090a, 0x07040506, 0x03000102);
+		unsigned int x = 0;
+		for (; x + 16 <= npixels; x += 16) {
+			__m512i p0 = _mm512_loadu_si512((const void*)(src + x));
+			_mm512_storeu_si512((void*)(dst + x), _mm512_shuffle_epi8(p0, shuffle));
+		}
+		// Masked remainder
+		if (x < npixels) {
+			__mmask16 mask = (__mmask16)((1u << (npixels - x)) - 1);
+			__m512i p0 = _mm512_maskz_loadu_epi32(mask, (const void*)(src + x));
+			_mm512_mask_storeu_epi32((void*)(dst + x), mask, _mm512_shuffle_epi8(p0, shuffle));
+		}
+	}
 
-			// Copy the line
-			memcpy((void *)dest, (const void *)source, (size_t)width * 4);
+	// AVX-512 exchange of two lines
+	// Two cache lines of each per loop
+	static AVX512_FUNC void swaplines_avx512(unsigned char* a, unsigned char* b, size_t size)
+	{
+		size_t i = 0;
+		for (; i + 128 <= size; i += 128) {
+			__m512i a0 = _mm512_loadu_si512((const void*)(a + i));
+			__m512i a1 = _mm512_loadu_si512((const void*)(a + i + 64));
+			__m512i b0 = _mm512_loadu_si512((const void*)(b + i));
+			__m512i b1 = _mm512_loadu_si512((const void*)(b + i + 64));
+			_mm512_storeu_si512((void*)(a + i), b0);
+			_mm512_storeu_si512((void*)(a + i + 64), b1);
+			_mm512_storeu_si512((void*)(b + i), a0);
+			_mm512_storeu_si512((void*)(b + i + 64), a1);
 		}
+		swaplines_avx2(a + i, b + i, size - i);
 	}
 
+#endif // endif USE_AVX
+
 	//
-	//        YUV422_to_RGBA
+	// YUV to RGBA kernels
 	//
-	// Y sampled at every pixel
-	// U and V sampled at every second pixel 
-	// 2 pixels in 1 DWORD
+	// Integer coefficients with 8 bit fraction, selected once per frame.
+	//   R = (yc*(Y-yoffset) + rv*(V-128) + 127) >> 8
+	//   G = (yc*(Y-yoffset) + gu*(U-128) + gv*(V-128) + 127) >> 8
+	//   B = (yc*(Y-yoffset) + bu*(U-128) + 127) >> 8
+	// Results are clamped to 0-255.
+	// SIMD versions use 32 bit products and saturating packs
+	// and are identical to the C++ version.
+	// Output is RGBA, or BGRA if the bgra flag is set.
 	//
-	// https://github.com/rzwm/YUVRGBFormulaGenerator
+	struct YUVcoefficients {
+		int yoffset;
+		int yc;
+		int rv;
+		int gu;
+		int gv;
+		int bu;
+		bool bgra;
+	};
+
 	//
-	// BT.601 : 16-235 > 0-255
-	// R = 1.164384(Y - 16) + 1.596027(V - 128)
-	// G = 1.164384(Y - 16) - 0.391762(U - 128) - 0.812968(V - 128)
-	// B = 1.164384(Y - 16) + 2.017232(U - 128)
-	// R = (297(Y - 16) + 407(V - 128) + 127) / 255
-	// G = (297(Y - 16) - 100(U - 128) - 207(V - 128) + 127) / 255
-	// B = (297(Y - 16) + 514(U - 128) + 127) / 255
+	// Colorimetry tables
 	//
-	// BT.709 : 16-235 > 0-255
-	// R = 1.164384(Y - 16) + 1.792741(V - 128)
-	// G = 1.164384(Y - 16) - 0.213249(U - 128) - 0.532909(V - 128)
-	// B = 1.164384(Y - 16) + 2.112402(U - 128)
-	// R = (297(Y - 16) + 457(V - 128) + 127) / 255
-	// G = (297(Y - 16) - 54(U - 128) - 136(V - 128) + 127) / 255
-	// B = (297(Y - 16) + 539(U - 128) + 127) / 255
-	//
-	void YUV422_to_RGBA(const unsigned char * source, unsigned char * dest, unsigned int width, unsigned int height, unsigned int stride)
-	{
-		// Clamp out of range values 0-255
-		#define CLAMPRGB(t) (((t)>255)?255:(((t)<0)?0:(t)))
-
-		const unsigned char *yuv = source;
-		unsigned char *rgba = dest;
-		int r1 = 0 , g1 = 0 , b1 = 0; // , a1 = 0;
-		int r2 = 0 , g2 = 0 , b2 = 0; // a2 = 0;
-		int u0 = 0 , y0 = 0 , v0 = 0, y1 = 0;
-		unsigned int padding = stride - width*4;
-		bool b709 = true; // HD BT.709 default
-		if (width < 1920) b709 = false; // SD BT.601
-
-	    // Loop through 4 bytes at a time
-		// half width source data for yuv
-		for (unsigned int y = 0; y <height; y ++ ) {
-			for (unsigned int x = 0; x <width*2; x +=4 ) {
-
-				u0  = (int)*yuv++;
-				y0  = (int)*yuv++;
-				v0  = (int)*yuv++;
-				y1  = (int)*yuv++;
-				// u and v are +/- 128 
-
-				// Color space conversion for RGB
-				if (b709) {
-					// BT.709
-					r1 = CLAMPRGB((297*(y0 - 16) + 457*(v0 - 128) + 127)>>8);
-					g1 = CLAMPRGB((297*(y0 - 16) - 54*(u0 - 128) - 136*(v0 - 128) + 127)>>8);
-					b1 = CLAMPRGB((297*(y0 - 16) + 539*(u0 - 128) + 127)>>8);
-					r2 = CLAMPRGB((297*(y1 - 16) + 457*(v0 - 128) + 127)>>8);
-					g2 = CLAMPRGB((297*(y1 - 16) - 54*(u0 - 128) - 136*(v0 - 128) + 127)>>8);
-					b2 = CLAMPRGB((297*(y1 - 16) + 539*(u0 - 128) + 127)>>8);
-				}
-				else {
-					// BT.601
-					r1 = CLAMPRGB((297*(y0 - 16) + 407*(v0 - 128) + 127)>>8);
-					g1 = CLAMPRGB((297*(y0 - 16) - 100*(u0 - 128) - 207*(v0 - 128) + 127)>>8);
-					b1 = CLAMPRGB((297*(y0 - 16) + 514*(u0 - 128) + 127)>>8);
-					r2 = CLAMPRGB((297*(y1 - 16) + 407*(v0 - 128) + 127)>>8);
-					g2 = CLAMPRGB((297*(y1 - 16) - 100*(u0 - 128) - 207*(v0 - 128) + 127)>>8);
-					b2 = CLAMPRGB((297*(y1 - 16) + 514*(u0 - 128) + 127)>>8);
-				}
+	// Fixed point coefficients for each matrix and range are generated
+	// at compile time from the luma weights Kr and Kb of the matrix.
+	//   Y  = Kr*R + Kg*G + Kb*B (Kg = 1 - Kr - Kb)
+	//   Cb = (B - Y)/(2*(1 - Kb))
+	//   Cr = (R - Y)/(2*(1 - Kr))
+	// Limited range : Y 16-235, U and V 16-240
+	// Full range : Y 0-255, U and V 0-255
+	//
+	static const double LumaWeights[3][2] = {
+		{ 0.299,  0.114  }, // BT.601
+		{ 0.2126, 0.0722 }, // BT.709
+		{ 0.2627, 0.0593 }  // BT.2020
+	};
 
-				*rgba++ = (unsigned char)r1;
-				*rgba++ = (unsigned char)g1;
-				*rgba++ = (unsigned char)b1;
-				*rgba++ = 255;
-				*rgba++ = (unsigned char)r2;
-				*rgba++ = (unsigned char)g2;
-				*rgba++ = (unsigned char)b2;
-				*rgba++ = 255;
-			}
-			yuv += padding; // if any
+	// Rounded 8 bit fraction
+	static constexpr int FixedPoint(double x)
+	{
+		return (int)(x < 0.0 ? x*256.0 - 0.5 : x*256.0 + 0.5);
+	}
+
+	// Scale of Y and of U and V for the range
+	static constexpr double LumaRange(bool bFull)   { return bFull ? 255.0 : 219.0; }
+	static constexpr double ChromaRange(bool bFull) { return bFull ? 255.0 : 224.0; }
+
+	// YUV to RGB for the matrix luma weights
+	static constexpr YUVcoefficients MakeYUVcoefficients(double kr, double kb, bool bFull)
+	{
+		return YUVcoefficients {
+			bFull ? 0 : 16,
+			FixedPoint(255.0/LumaRange(bFull)),
+			FixedPoint(2.0*(1.0 - kr)*255.0/ChromaRange(bFull)),
+			FixedPoint(-2.0*(1.0 - kb)*kb/(1.0 - kr - kb)*255.0/ChromaRange(bFull)),
+			FixedPoint(-2.0*(1.0 - kr)*kr/(1.0 - kr - kb)*255.0/ChromaRange(bFull)),
+			FixedPoint(2.0*(1.0 - kb)*255.0/ChromaRange(bFull)),
+			false };
+	}
+
+	// [matrix][range]
+	static const YUVcoefficients YUVcoeffTable[3][2] = {
+		{ MakeYUVcoefficients(0.299,  0.114,  false), MakeYUVcoefficients(0.299,  0.114,  true) },
+		{ MakeYUVcoefficients(0.2126, 0.0722, false), MakeYUVcoefficients(0.2126, 0.0722, true) },
+		{ MakeYUVcoefficients(0.2627, 0.0593, false), MakeYUVcoefficients(0.2627, 0.0593, true) }
+	};
+
+	// Table index of the matrix
+	// YUV_MATRIX_AUTO : SD (width < 1920) BT.601, HD BT.709
+	static unsigned int MatrixIndex(YUVmatrix matrix, unsigned int width)
+	{
+		switch (matrix) {
+			case YUV_MATRIX_BT601:  return 0;
+			case YUV_MATRIX_BT709:  return 1;
+			case YUV_MATRIX_BT2020: return 2;
+			case YUV_MATRIX_AUTO:
+			default:                return (width < 1920) ? 0 : 1;
 		}
-	}  // end YUV422_to_RGBA
+	}
 
-#ifdef USE_CHRONO
-	// Timing functions
-	void StartTiming() {
-		start = std::chrono::steady_clock::now();
+	static inline unsigned char clamp_rgb(int t)
+	{
+		return (unsigned char)((t > 255) ? 255 : ((t < 0) ? 0 : t));
 	}
 
-	double EndTiming() {
-		end = std::chrono::steady_clock::now();
-		double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
-		// printf("    elapsed [%6.2f] msec\n", elapsed / 1000.0);
-		// printf("elapsed [%.3f] u/sec\n", elapsed);
-		return elapsed / 1000.0; // msec
+	// C++ YUV to RGBA of one pixel
+	static inline void yuv_rgba_cpp(int y, int u, int v, const YUVcoefficients& c, unsigned char* rgba)
+	{
+		const int yy = c.yc*(y - c.yoffset) + 127;
+		u -= 128;
+		v -= 128;
+		rgba[c.bgra ? 2 : 0] = clamp_rgb((yy + c.rv*v) >> 8);
+		rgba[1] = clamp_rgb((yy + c.gu*u + c.gv*v) >> 8);
+		rgba[c.bgra ? 0 : 2] = clamp_rgb((yy + c.bu*u) >> 8);
+		rgba[3] = 255;
 	}
 
-	// -----------------------------------------------
-	// Function: HoldFps
-	// Frame rate control
-	//
-	// Hold a desired frame rate if the application does not already
-	// have frame rate control. Must be called every frame.
-	//
-	// Note that this function is affected by changes to Windows timer 
-	// resolution since Windows 10 Version 2004 (April 2020)
-	// https://randomascii.wordpress.com/2020/10/04/windows-timer-resolution-the-great-rule-change/
-	//
-	// timeBeginPeriod / timeEndPeriod avoid loss of precision
-	// https://learn.microsoft.com/en-us/windows/win32/api/timeapi/nf-timeapi-timebeginperiod
-	// Microsoft remark :
-	//   Call this function immediately before using timer services, and call the timeEndPeriod
-	//   function immediately after you are finished using the timer services. An application 
-	//   can make multiple timeBeginPeriod calls as long as each call is matched with a call
-	//   to timeEndPeriod.
-	// 
-	void HoldFps(int fps)
+	// C++ UYVY line to RGBA
+	static void uyvy_cpp(const unsigned char* yuv, unsigned char* rgba, unsigned int width, const YUVcoefficients& c)
 	{
-		// Unlikely but return anyway
-		if (fps <= 0)
-			return;
+		unsigned int x = 0;
+		for (; x + 1 < width; x += 2) {
+			// u y0 v y1
+			yuv_rgba_cpp(yuv[1], yuv[0], yuv[2], c, rgba);
+			yuv_rgba_cpp(yuv[3], yuv[0], yuv[2], c, rgba + 4);
+			yuv += 4;
+			rgba += 8;
+		}
+		// Odd width
+		if (x < width)
+			yuv_rgba_cpp(yuv[1], yuv[0], yuv[2], c, rgba);
+	}
 
-		// Reduce Windows timer period to minimum
-#if defined(TARGET_WIN32)
-		StartTimePeriod();
-#endif
+	// C++ YUV 4:2:0 line to RGBA
+	// U and V for every second pixel
+	// uvstep 1 : separate U and V planes (I420, YV12)
+	// uvstep 2 : interleaved UV plane (NV12)
+	static void yuv420_cpp(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+		unsigned int uvstep, unsigned char* rgba, unsigned int width, const YUVcoefficients& c)
+	{
+		for (unsigned int x = 0; x < width; x++) {
+			const unsigned int i = (x / 2) * uvstep;
+			yuv_rgba_cpp(y[x], u[i], v[i], c, rgba);
+			rgba += 4;
+		}
+	}
 
-		// Target frame time
-		const double target = (1000000.0/static_cast<double>(fps))/1000.0; // msec
+#if defined(USE_SSE2)
 
-		// Time now end point
-		FrameEndPtr = std::chrono::steady_clock::now();
+	// Coefficient pairs for _mm_madd_epi16
+	static inline __m128i coeff_pair_sse2(int lo, int hi)
+	{
+		return _mm_set1_epi32((int)(((uint32_t)hi << 16) | ((uint32_t)lo & 0xffff)));
+	}
 
-		// Milliseconds elapsed
-		const double elapsedTime = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(FrameEndPtr - FrameStartPtr).count()/1000000.0);
+	// Eight pixels of Y, U and V (16 bit, offsets removed) to 16 bit R, G and B
+	static inline void yuv_rgb16_sse2(__m128i y, __m128i u, __m128i v,
+		const __m128i* k, __m128i& r, __m128i& g, __m128i& b)
+	{
+		// k : (yc, rv), (yc, gu), (gv, 0), (yc, bu), rounding
+		const __m128i zero = _mm_setzero_si128();
+		__m128i yv0 = _mm_unpacklo_epi16(y, v);
+		__m128i yv1 = _mm_unpackhi_epi16(y, v);
+		__m128i yu0 = _mm_unpacklo_epi16(y, u);
+		__m128i yu1 = _mm_unpackhi_epi16(y, u);
+		__m128i v0  = _mm_unpacklo_epi16(v, zero);
+		__m128i v1  = _mm_unpackhi_epi16(v, zero);
 
-		// Sleep to reach the target frame time
-		if (elapsedTime < target) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<long long>(target - elapsedTime)));
-		}
+		__m128i r0 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv0, k[0]), k[4]), 8);
+		__m128i r1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv1, k[0]), k[4]), 8);
+		__m128i g0 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yu0, k[1]), _mm_madd_epi16(v0, k[2])), k[4]), 8);
+		__m128i g1 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yu1, k[1]), _mm_madd_epi16(v1, k[2])), k[4]), 8);
+		__m128i b0 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu0, k[3]), k[4]), 8);
+		__m128i b1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu1, k[3]), k[4]), 8);
 
-		// Set start time for the next frame
-		FrameStartPtr = std::chrono::steady_clock::now();
+		r = _mm_packs_epi32(r0, r1);
+		g = _mm_packs_epi32(g0, g1);
+		b = _mm_packs_epi32(b0, b1);
+	}
 
-		// Reset Windows timer period
-#if defined(TARGET_WIN32)
-		EndTimePeriod();
-#endif
+	// Sixteen 8 bit R, G, B and A to RGBA or BGRA
+	static inline void store_rgba_sse2(__m128i r, __m128i g, __m128i b, __m128i a, bool bgra, unsigned char* rgba)
+	{
+		if (bgra) std::swap(r, b);
+		__m128i rg0 = _mm_unpacklo_epi8(r, g);
+		__m128i rg1 = _mm_unpackhi_epi8(r, g);
+		__m128i ba0 = _mm_unpacklo_epi8(b, a);
+		__m128i ba1 = _mm_unpackhi_epi8(b, a);
+		_mm_storeu_si128((__m128i*)(rgba),      _mm_unpacklo_epi16(rg0, ba0));
+		_mm_storeu_si128((__m128i*)(rgba + 16), _mm_unpackhi_epi16(rg0, ba0));
+		_mm_storeu_si128((__m128i*)(rgba + 32), _mm_unpacklo_epi16(rg1, ba1));
+		_mm_storeu_si128((__m128i*)(rgba + 48), _mm_unpackhi_epi16(rg1, ba1));
+	}
 
+	// Eight UYVY pixels to 16 bit R, G and B
+	static inline void uyvy_rgb16_sse2(const unsigned char* yuv, const __m128i* k,
+		__m128i yoffset, __m128i& r, __m128i& g, __m128i& b)
+	{
+		const __m128i lomask = _mm_set1_epi16(0x00ff);
+		const __m128i uvoffset = _mm_set1_epi16(128);
+		__m128i data = _mm_loadu_si128((const __m128i*)yuv);
+		// u0 v0 u2 v2 u4 v4 u6 v6
+		__m128i uv = _mm_sub_epi16(_mm_and_si128(data, lomask), uvoffset);
+		// y0 y1 y2 y3 y4 y5 y6 y7
+		__m128i y = _mm_sub_epi16(_mm_srli_epi16(data, 8), yoffset);
+		// Chroma for each pixel
+		__m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+		__m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+		yuv_rgb16_sse2(y, u, v, k, r, g, b);
 	}
 
-#if defined(TARGET_WIN32)
-	// -----------------------------------------------
-	// Reduce Windows timing period to the minimum
-	// supported by the system (usually 1 msec)
-	void StartTimePeriod()
+	// SSE2 UYVY line to RGBA
+	// 16 pixels per loop
+	static void uyvy_sse2(const unsigned char* yuv, unsigned char* rgba, unsigned int width, const YUVcoefficients& c)
 	{
-		TIMECAPS tc={};
-		PeriodMin = 0; // To allow for errors
-		MMRESULT mres = timeGetDevCaps(&tc, sizeof(TIMECAPS));
-		if (mres == MMSYSERR_NOERROR) {
-			mres = timeBeginPeriod(tc.wPeriodMin);
-			if (mres == TIMERR_NOERROR)
-				PeriodMin = tc.wPeriodMin;
+		const __m128i k[5] = {
+			coeff_pair_sse2(c.yc, c.rv),
+			coeff_pair_sse2(c.yc, c.gu),
+			coeff_pair_sse2(c.gv, 0),
+			coeff_pair_sse2(c.yc, c.bu),
+			_mm_set1_epi32(127) };
+		const __m128i yoffset = _mm_set1_epi16((short)c.yoffset);
+		const __m128i alpha = _mm_set1_epi8((char)0xff);
+		__m128i r0, g0, b0, r1, g1, b1;
+
+		unsigned int x = 0;
+		for (; x + 16 <= width; x += 16) {
+			uyvy_rgb16_sse2(yuv, k, yoffset, r0, g0, b0);
+			uyvy_rgb16_sse2(yuv + 16, k, yoffset, r1, g1, b1);
+			store_rgba_sse2(_mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1), alpha, c.bgra, rgba);
+			yuv += 32;
+			rgba += 64;
 		}
+		uyvy_cpp(yuv, rgba, width - x, c);
 	}
 
+	// SSE2 YUV 4:2:0 line to RGBA
+	// 16 pixels per loop
+	static void yuv420_sse2(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+		unsigned int uvstep, unsigned char* rgba, unsigned int width, const YUVcoefficients& c)
+	{
+		const __m128i k[5] = {
+			coeff_pair_sse2(c.yc, c.rv),
+			coeff_pair_sse2(c.yc, c.gu),
+			coeff_pair_sse2(c.gv, 0),
+			coeff_pair_sse2(c.yc, c.bu),
+			_mm_set1_epi32(127) };
+		const __m128i yoffset = _mm_set1_epi16((short)c.yoffset);
+		const __m128i uvoffset = _mm_set1_epi16(128);
+		const __m128i lomask = _mm_set1_epi16(0x00ff);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alpha = _mm_set1_epi8((char)0xff);
+		__m128i r0, g0, b0, r1, g1, b1, uc, vc;
 
-	// -----------------------------------------------
-	// Reset Windows timing period
-	void EndTimePeriod()
+		unsigned int x = 0;
+		for (; x + 16 <= width; x += 16) {
+			// Eight U and V 16 bit
+			if (uvstep == 2) {
+				__m128i uv = _mm_loadu_si128((const __m128i*)u);
+				uc = _mm_and_si128(uv, lomask);
+				vc = _mm_srli_epi16(uv, 8);
+			}
+			else {
+				uc = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)u), zero);
+				vc = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)v), zero);
+			}
+			uc = _mm_sub_epi16(uc, uvoffset);
+			vc = _mm_sub_epi16(vc, uvoffset);
+			__m128i yb = _mm_loadu_si128((const __m128i*)y);
+			// Pixels 0-7 and 8-15 with U and V for each pixel
+			yuv_rgb16_sse2(_mm_sub_epi16(_mm_unpacklo_epi8(yb, zero), yoffset),
+				_mm_unpacklo_epi16(uc, uc), _mm_unpacklo_epi16(vc, vc), k, r0, g0, b0);
+			yuv_rgb16_sse2(_mm_sub_epi16(_mm_unpackhi_epi8(yb, zero), yoffset),
+				_mm_unpackhi_epi16(uc, uc), _mm_unpackhi_epi16(vc, vc), k, r1, g1, b1);
+			store_rgba_sse2(_mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1), alpha, c.bgra, rgba);
+			y += 16;
+			u += 8 * uvstep;
+			v += 8 * uvstep;
+			rgba += 64;
+		}
+		yuv420_cpp(y, u, v, uvstep, rgba, width - x, c);
+	}
+
+#endif // endif USE_SSE2
+
+#if defined(USE_AVX)
+
+	// AVX2 versions of the SSE2 functions above
+	// All operations are within each 128 bit lane.
+
+	static AVX2_FUNC inline __m256i coeff_pair_avx2(int lo, int hi)
 	{
-		if (PeriodMin > 0) {
-			timeEndPeriod(PeriodMin);
-			PeriodMin = 0;
+		return _mm256_set1_epi32((int)(((uint32_t)hi << 16) | ((uint32_t)lo & 0xffff)));
+	}
+
+	static AVX2_FUNC inline void yuv_rgb16_avx2(__m256i y, __m256i u, __m256i v,
+		const __m256i* k, __m256i& r, __m256i& g, __m256i& b)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i yv0 = _mm256_unpacklo_epi16(y, v);
+		__m256i yv1 = _mm256_unpackhi_epi16(y, v);
+		__m256i yu0 = _mm256_unpacklo_epi16(y, u);
+		__m256i yu1 = _mm256_unpackhi_epi16(y, u);
+		__m256i v0  = _mm256_unpacklo_epi16(v, zero);
+		__m256i v1  = _mm256_unpackhi_epi16(v, zero);
+
+		__m256i r0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yv0, k[0]), k[4]), 8);
+		__m256i r1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yv1, k[0]), k[4]), 8);
+		__m256i g0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu0, k[1]), _mm256_madd_epi16(v0, k[2])), k[4]), 8);
+		__m256i g1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu1, k[1]), _mm256_madd_epi16(v1, k[2])), k[4]), 8);
+		__m256i b0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu0, k[3]), k[4]), 8);
+		__m256i b1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu1, k[3]), k[4]), 8);
+
+		r = _mm256_packs_epi32(r0, r1);
+		g = _mm256_packs_epi32(g0, g1);
+		b = _mm256_packs_epi32(b0, b1);
+	}
+
+	// Thirty two 8 bit R, G, B and A to RGBA or BGRA
+	// Lane order of the inputs : 0-7, 16-23 | 8-15, 24-31
+	static AVX2_FUNC inline void store_rgba_avx2(__m256i r, __m256i g, __m256i b, __m256i a, bool bgra, unsigned char* rgba)
+	{
+		if (bgra) std::swap(r, b);
+		__m256i rg0 = _mm256_unpacklo_epi8(r, g); // 0-7   | 8-15
+		__m256i rg1 = _mm256_unpackhi_epi8(r, g); // 16-23 | 24-31
+		__m256i ba0 = _mm256_unpacklo_epi8(b, a);
+		__m256i ba1 = _mm256_unpackhi_epi8(b, a);
+		__m256i p0 = _mm256_unpacklo_epi16(rg0, ba0); // 0-3   | 8-11
+		__m256i p1 = _mm256_unpackhi_epi16(rg0, ba0); // 4-7   | 12-15
+		__m256i p2 = _mm256_unpacklo_epi16(rg1, ba1); // 16-19 | 24-27
+		__m256i p3 = _mm256_unpackhi_epi16(rg1, ba1); // 20-23 | 28-31
+		_mm256_storeu_si256((__m256i*)(rgba),      _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i*)(rgba + 32), _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256((__m256i*)(rgba + 64), _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256((__m256i*)(rgba + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+
+	// Sixteen UYVY pixels to 16 bit R, G and B
+	static AVX2_FUNC inline void uyvy_rgb16_avx2(const unsigned char* yuv, const __m256i* k,
+		__m256i yoffset, __m256i& r, __m256i& g, __m256i& b)
+	{
+		const __m256i lomask = _mm256_set1_epi16(0x00ff);
+		const __m256i uvoffset = _mm256_set1_epi16(128);
+		__m256i data = _mm256_loadu_si256((const __m256i*)yuv);
+		__m256i uv = _mm256_sub_epi16(_mm256_and_si256(data, lomask), uvoffset);
+		__m256i y = _mm256_sub_epi16(_mm256_srli_epi16(data, 8), yoffset);
+		__m256i u = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+		__m256i v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+		yuv_rgb16_avx2(y, u, v, k, r, g, b);
+	}
+
+	// AVX2 UYVY line to RGBA
+	// 32 pixels per loop
+	static AVX2_FUNC void uyvy_avx2(const unsigned char* yuv, unsigned char* rgba, unsigned int width, const YUVcoefficients& c)
+	{
+		const __m256i k[5] = {
+			coeff_pair_avx2(c.yc, c.rv),
+			coeff_pair_avx2(c.yc, c.gu),
+			coeff_pair_avx2(c.gv, 0),
+			coeff_pair_avx2(c.yc, c.bu),
+			_mm256_set1_epi32(127) };
+		const __m256i yoffset = _mm256_set1_epi16((short)c.yoffset);
+		const __m256i alpha = _mm256_set1_epi8((char)0xff);
+		__m256i r0, g0, b0, r1, g1, b1;
+
+		unsigned int x = 0;
+		for (; x + 32 <= width; x += 32) {
+			uyvy_rgb16_avx2(yuv, k, yoffset, r0, g0, b0);
+			uyvy_rgb16_avx2(yuv + 32, k, yoffset, r1, g1, b1);
+			store_rgba_avx2(_mm256_packus_epi16(r0, r1), _mm256_packus_epi16(g0, g1), _mm256_packus_epi16(b0, b1), alpha, c.bgra, rgba);
+			yuv += 64;
+			rgba += 128;
 		}
+		uyvy_sse2(yuv, rgba, width - x, c);
 	}
-#endif
 
-#endif
+	// AVX2 YUV 4:2:0 line to RGBA
+	// 32 pixels per loop
+	static AVX2_FUNC void yuv420_avx2(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+		unsigned int uvstep, unsigned char* rgba, unsigned int width, const YUVcoefficients& c)
+	{
+		const __m256i k[5] = {
+			coeff_pair_avx2(c.yc, c.rv),
+			coeff_pair_avx2(c.yc, c.gu),
+			coeff_pair_avx2(c.gv, 0),
+			coeff_pair_avx2(c.yc, c.bu),
+			_mm256_set1_epi32(127) };
+		const __m256i yoffset = _mm256_set1_epi16((short)c.yoffset);
+		const __m256i uvoffset = _mm256_set1_epi16(128);
+		const __m256i lomask = _mm256_set1_epi16(0x00ff);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i alpha = _mm256_set1_epi8((char)0xff);
+		__m256i r0, g0, b0, r1, g1, b1, uc, vc;
+
+		unsigned int x = 0;
+		for (; x + 32 <= width; x += 32) {
+			// Sixteen U and V 16 bit
+			if (uvstep == 2) {
+				__m256i uv = _mm256_loadu_si256((const __m256i*)u);
+				uc = _mm256_and_si256(uv, lomask);
+				vc = _mm256_srli_epi16(uv, 8);
+			}
+			else {
+				uc = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)u));
+				vc = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)v));
+			}
+			uc = _mm256_sub_epi16(uc, uvoffset);
+			vc = _mm256_sub_epi16(vc, uvoffset);
+			__m256i yb = _mm256_loadu_si256((const __m256i*)y);
+			// Pixels 0-7, 16-23 and 8-15, 24-31
+			yuv_rgb16_avx2(_mm256_sub_epi16(_mm256_unpacklo_epi8(yb, zero), yoffset),
+				_mm256_unpacklo_epi16(uc, uc), _mm256_unpacklo_epi16(vc, vc), k, r0, g0, b0);
+			yuv_rgb16_avx2(_mm256_sub_epi16(_mm256_unpackhi_epi8(yb, zero), yoffset),
+				_mm256_unpackhi_epi16(uc, uc), _mm256_unpackhi_epi16(vc, vc), k, r1, g1, b1);
+			// Packed in order 0-15 | 16-31
+			// Re-order to 0-7, 16-23 | 8-15, 24-31 for store_rgba_avx2
+			store_rgba_avx2(
+				_mm256_permute4x64_epi64(_mm256_packus_epi16(r0, r1), _MM_SHUFFLE(3, 1, 2, 0)),
+				_mm256_permute4x64_epi64(_mm256_packus_epi16(g0, g1), _MM_SHUFFLE(3, 1, 2, 0)),
+				_mm256_permute4x64_epi64(_mm256_packus_epi16(b0, b1), _MM_SHUFFLE(3, 1, 2, 0)),
+				alpha, c.bgra, rgba);
+			y += 32;
+			u += 16 * uvstep;
+			v += 16 * uvstep;
+			rgba += 128;
+		}
+		yuv420_sse2(y, u, v, uvstep, rgba, width - x, c);
+	}
+
+#endif // endif USE_AVX
+
+	//
+	// RGBA to YUV kernels
+	//
+	// Integer coefficients with 8 bit fraction from the colorimetry tables.
+	//   Y = ((yr*R + yg*G + yb*B + 128) >> 8) + yoffset
+	// U and V are the average of each pair of pixels.
+	//   U = ((ur*(R0+R1) + ug*(G0+G1) + ub*(B0+B1) + 256) >> 9) + 128
+	//   V = ((vr*(R0+R1) + vg*(G0+G1) + vb*(B0+B1) + 256) >> 9) + 128
+	// Results are within range without clamping.
+	// For bgra source, the red and blue coefficients are exchanged.
+	//
+	struct RGBtoYUVcoefficients {
+		int yr, yg, yb;
+		int ur, ug, ub;
+		int vr, vg, vb;
+		int yoffset;
+	};
+
+	// Green is the remainder so that white gives maximum Y
+	// and grey gives U and V of 128 exactly.
+	// U and V coefficients of 0.5 are limited to 127/256
+	// for full range so that 255 is not exceeded.
+	static constexpr int ChromaLimit(int c) { return c > 127 ? 127 : c; }
+
+	static constexpr RGBtoYUVcoefficients MakeRGBtoYUV(int yr, int yb, int ytotal, int ur, int ub, int vr, int vb, bool bFull)
+	{
+		return RGBtoYUVcoefficients {
+			yr, ytotal - yr - yb, yb,
+			ur, -(ur + ub), ub,
+			vr, -(vr + vb), vb,
+			bFull ? 0 : 16 };
+	}
+
+	// RGB to YUV for the matrix luma weights
+	static constexpr RGBtoYUVcoefficients MakeRGBtoYUVcoefficients(double kr, double kb, bool bFull)
+	{
+		return MakeRGBtoYUV(
+			FixedPoint(kr*LumaRange(bFull)/255.0),
+			FixedPoint(kb*LumaRange(bFull)/255.0),
+			FixedPoint(LumaRange(bFull)/255.0),
+			FixedPoint(-0.5*kr/(1.0 - kb)*ChromaRange(bFull)/255.0),
+			ChromaLimit(FixedPoint(0.5*ChromaRange(bFull)/255.0)),
+			ChromaLimit(FixedPoint(0.5*ChromaRange(bFull)/255.0)),
+			FixedPoint(-0.5*kb/(1.0 - kr)*ChromaRange(bFull)/255.0),
+			bFull);
+	}
+
+	// [matrix][range]
+	static const RGBtoYUVcoefficients RGBcoeffTable[3][2] = {
+		{ MakeRGBtoYUVcoefficients(0.299,  0.114,  false), MakeRGBtoYUVcoefficients(0.299,  0.114,  true) },
+		{ MakeRGBtoYUVcoefficients(0.2126, 0.0722, false), MakeRGBtoYUVcoefficients(0.2126, 0.0722, true) },
+		{ MakeRGBtoYUVcoefficients(0.2627, 0.0593, false), MakeRGBtoYUVcoefficients(0.2627, 0.0593, true) }
+	};
+
+	static RGBtoYUVcoefficients SwapCoefficientsRB(const RGBtoYUVcoefficients& c)
+	{
+		RGBtoYUVcoefficients s = { c.yb, c.yg, c.yr, c.ub, c.ug, c.ur, c.vb, c.vg, c.vr, c.yoffset };
+		return s;
+	}
+
+	// C++ RGBA line to UYVY
+	// Optional alpha plane for UYVA
+	static void rgba_uyvy_cpp(const unsigned char* rgba, unsigned char* yuv, unsigned char* alpha,
+		unsigned int width, const RGBtoYUVcoefficients& c)
+	{
+		for (unsigned int x = 0; x < width; x += 2) {
+			// Odd width : the last pixel is used for both of the pair
+			const unsigned char* p0 = rgba;
+			const unsigned char* p1 = (x + 1 < width) ? rgba + 4 : rgba;
+			const int r = p0[0] + p1[0];
+			const int g = p0[1] + p1[1];
+			const int b = p0[2] + p1[2];
+			yuv[0] = (unsigned char)(((c.ur*r + c.ug*g + c.ub*b + 256) >> 9) + 128);
+			yuv[1] = (unsigned char)(((c.yr*p0[0] + c.yg*p0[1] + c.yb*p0[2] + 128) >> 8) + c.yoffset);
+			if (alpha) alpha[0] = p0[3];
+			if (x + 1 < width) {
+				yuv[2] = (unsigned char)(((c.vr*r + c.vg*g + c.vb*b + 256) >> 9) + 128);
+				yuv[3] = (unsigned char)(((c.yr*p1[0] + c.yg*p1[1] + c.yb*p1[2] + 128) >> 8) + c.yoffset);
+				if (alpha) alpha[1] = p1[3];
+			}
+			rgba += 8;
+			yuv += 4;
+			if (alpha) alpha += 2;
+		}
+	}
+
+#if defined(USE_SSE2)
+
+	// Eight rgba pixels to UYVY and alpha
+	// Coefficient pairs in k : (yr, yb), (yg, 0), (ur, ub), (ug, 0), (vr, vb), (vg, 0), then Y offset
+	static inline __m128i rgba_uyvy8_sse2(const unsigned char* rgba, const __m128i* k, __m128i& a)
+	{
+		const __m128i rbmask = _mm_set1_epi32(0x00ff00ff);
+		const __m128i yround = _mm_set1_epi32(128);
+		const __m128i cround = _mm_set1_epi32(256);
+		const __m128i coffset = _mm_set1_epi32(128);
+
+		__m128i p0 = _mm_loadu_si128((const __m128i*)rgba);
+		__m128i p1 = _mm_loadu_si128((const __m128i*)(rgba + 16));
+
+		// (R, B) and (G, A) 16 bit pairs for each pixel
+		__m128i rb0 = _mm_and_si128(p0, rbmask);
+		__m128i rb1 = _mm_and_si128(p1, rbmask);
+		__m128i ga0 = _mm_srli_epi16(p0, 8);
+		__m128i ga1 = _mm_srli_epi16(p1, 8);
+
+		// Y for each pixel
+		__m128i y0 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rb0, k[0]), _mm_madd_epi16(ga0, k[1])), yround), 8);
+		__m128i y1 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rb1, k[0]), _mm_madd_epi16(ga1, k[1])), yround), 8);
+		__m128i y = _mm_add_epi16(_mm_packs_epi32(y0, y1), k[6]);
+
+		// Sums of each pair of pixels in the even lanes
+		// Alpha is multiplied by zero
+		__m128i rbs0 = _mm_add_epi16(rb0, _mm_srli_epi64(rb0, 32));
+		__m128i rbs1 = _mm_add_epi16(rb1, _mm_srli_epi64(rb1, 32));
+		__m128i gas0 = _mm_add_epi16(ga0, _mm_srli_epi64(ga0, 32));
+		__m128i gas1 = _mm_add_epi16(ga1, _mm_srli_epi64(ga1, 32));
+
+		__m128i u0 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rbs0, k[2]), _mm_madd_epi16(gas0, k[3])), cround), 9), coffset);
+		__m128i u1 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rbs1, k[2]), _mm_madd_epi16(gas1, k[3])), cround), 9), coffset);
+		__m128i v0 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rbs0, k[4]), _mm_madd_epi16(gas0, k[5])), cround), 9), coffset);
+		__m128i v1 = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rbs1, k[4]), _mm_madd_epi16(gas1, k[5])), cround), 9), coffset);
+
+		// (U, V) 16 bit pairs in the even lanes
+		__m128i uv0 = _mm_or_si128(u0, _mm_slli_epi32(v0, 16));
+		__m128i uv1 = _mm_or_si128(u1, _mm_slli_epi32(v1, 16));
+		// U0 V0 U2 V2 U4 V4 U6 V6
+		__m128i uv = _mm_unpacklo_epi64(_mm_shuffle_epi32(uv0, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(uv1, _MM_SHUFFLE(3, 1, 2, 0)));
+
+		// Alpha 16 bit for each pixel
+		a = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+
+		// u y0 v y1
+		return _mm_or_si128(uv, _mm_slli_epi16(y, 8));
+	}
+
+	static inline void rgba_uyvy_coefficients_sse2(const RGBtoYUVcoefficients& c, __m128i* k)
+	{
+		k[0] = coeff_pair_sse2(c.yr, c.yb);
+		k[1] = coeff_pair_sse2(c.yg, 0);
+		k[2] = coeff_pair_sse2(c.ur, c.ub);
+		k[3] = coeff_pair_sse2(c.ug, 0);
+		k[4] = coeff_pair_sse2(c.vr, c.vb);
+		k[5] = coeff_pair_sse2(c.vg, 0);
+		k[6] = _mm_set1_epi16((short)c.yoffset);
+	}
+
+	// SSE2 RGBA line to UYVY
+	// 8 pixels per loop
+	static void rgba_uyvy_sse2(const unsigned char* rgba, unsigned char* yuv, unsigned char* alpha,
+		unsigned int width, const RGBtoYUVcoefficients& c)
+	{
+		__m128i k[7];
+		rgba_uyvy_coefficients_sse2(c, k);
+		__m128i a;
+
+		unsigned int x = 0;
+		for (; x + 8 <= width; x += 8) {
+			_mm_storeu_si128((__m128i*)yuv, rgba_uyvy8_sse2(rgba, k, a));
+			if (alpha) {
+				_mm_storel_epi64((__m128i*)alpha, _mm_packus_epi16(a, a));
+				alpha += 8;
+			}
+			rgba += 32;
+			yuv += 16;
+		}
+		rgba_uyvy_cpp(rgba, yuv, alpha, width - x, c);
+	}
+
+#endif // endif USE_SSE2
+
+#if defined(USE_AVX)
+
+	// Sixteen rgba pixels to UYVY and alpha
+	// As for the SSE2 version with all operations within each 128 bit lane.
+	// Output lanes are pixels 0-3, 8-11 | 4-7, 12-15 and are re-ordered.
+	static AVX2_FUNC inline __m256i rgba_uyvy16_avx2(const unsigned char* rgba, const __m256i* k, __m256i& a)
+	{
+		const __m256i rbmask = _mm256_set1_epi32(0x00ff00ff);
+		const __m256i yround = _mm256_set1_epi32(128);
+		const __m256i cround = _mm256_set1_epi32(256);
+		const __m256i coffset = _mm256_set1_epi32(128);
+
+		__m256i p0 = _mm256_loadu_si256((const __m256i*)rgba);
+		__m256i p1 = _mm256_loadu_si256((const __m256i*)(rgba + 32));
+
+		__m256i rb0 = _mm256_and_si256(p0, rbmask);
+		__m256i rb1 = _mm256_and_si256(p1, rbmask);
+		__m256i ga0 = _mm256_srli_epi16(p0, 8);
+		__m256i ga1 = _mm256_srli_epi16(p1, 8);
+
+		__m256i y0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(rb0, k[0]), _mm256_madd_epi16(ga0, k[1])), yround), 8);
+		__m256i y1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(rb1, k[0]), _mm256_madd_epi16(ga1, k[1])), yround), 8);
+		__m256i y = _mm256_add_epi16(_mm256_packs_epi32(y0, y1), k[6]);
+
+		__m256i rbs0 = _mm256_add_epi16(rb0, _mm256_srli_epi64(rb0, 32));
+		__m256i rbs1 = _mm256_add_epi16(rb1, _mm256_srli_epi64(rb1, 32));
+		__m256i gas0 = _mm256_add_epi16(ga0, _mm256_srli_epi64(ga0, 32));
+		__m256i gas1 = _mm256_add_epi16(ga1, _mm256_srli_epi64(ga1, 32));
+
+		__m256i u0 = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(rbs0, k[2]), _mm256_madd_epi16(gas0, k[3])), cround), 9), coffset);
+		__m256i u1 = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(rbs1, k[2]), _mm256_madd_epi16(gas1, k[3])), cround), 9), coffset);
+		__m256i v0 = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(rbs0, k[4]), _mm256_madd_epi16(gas0, k[5])), cround), 9), coffset);
+		__m256i v1 = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(rbs1, k[4]), _mm256_madd_epi16(gas1, k[5])), cround), 9), coffset);
+
+		__m256i uv0 = _mm256_or_si256(u0, _mm256_slli_epi32(v0, 16));
+		__m256i uv1 = _mm256_or_si256(u1, _mm256_slli_epi32(v1, 16));
+		__m256i uv = _mm256_unpacklo_epi64(_mm256_shuffle_epi32(uv0, _MM_SHUFFLE(3, 1, 2, 0)), _mm256_shuffle_epi32(uv1, _MM_SHUFFLE(3, 1, 2, 0)));
+
+		// Pixel order 0-3, 4-7, 8-11, 12-15
+		a = _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_srli_epi32(p0, 24), _mm256_srli_epi32(p1, 24)), _MM_SHUFFLE(3, 1, 2, 0));
+		return _mm256_permute4x64_epi64(_mm256_or_si256(uv, _mm256_slli_epi16(y, 8)), _MM_SHUFFLE(3, 1, 2, 0));
+	}
+
+	// AVX2 RGBA line to UYVY
+	// 16 pixels per loop
+	static AVX2_FUNC void rgba_uyvy_avx2(const unsigned char* rgba, unsigned char* yuv, unsigned char* alpha,
+		unsigned int width, const RGBtoYUVcoefficients& c)
+	{
+		const __m256i k[7] = {
+			coeff_pair_avx2(c.yr, c.yb),
+			coeff_pair_avx2(c.yg, 0),
+			coeff_pair_avx2(c.ur, c.ub),
+			coeff_pair_avx2(c.ug, 0),
+			coeff_pair_avx2(c.vr, c.vb),
+			coeff_pair_avx2(c.vg, 0),
+			_mm256_set1_epi16((short)c.yoffset) };
+		__m256i a;
+
+		unsigned int x = 0;
+		for (; x + 16 <= width; x += 16) {
+			_mm256_storeu_si256((__m256i*)yuv, rgba_uyvy16_avx2(rgba, k, a));
+			if (alpha) {
+				a = _mm256_packus_epi16(a, a);
+				_mm_storel_epi64((__m128i*)alpha, _mm256_castsi256_si128(a));
+				_mm_storel_epi64((__m128i*)(alpha + 8), _mm256_extracti128_si256(a, 1));
+				alpha += 16;
+			}
+			rgba += 64;
+			yuv += 32;
+		}
+		rgba_uyvy_sse2(rgba, yuv, alpha, width - x, c);
+	}
+
+#endif // endif USE_AVX
+
+	//
+	// 16 bit YUV kernels
+	//
+	// P216 is 16 bit YUV 4:2:2 with a Y plane followed by an
+	// interleaved UV plane of half width. PA16 has an alpha plane
+	// following the UV plane. Conversion is done with float arithmetic
+	// to keep full precision for 16 bit RGBA and float RGBA images.
+	//
+	// Limited range : Y 4096-60160, U and V 4096-61440 centred on 32768
+	//   Yn = (Y - 4096)/56064, Un = (U - 32768)/57344, Vn = (V - 32768)/57344
+	// Full range : Y 0-65535, U and V 0-65535 centred on 32768
+	//   Yn = Y/65535, Un = (U - 32768)/65535, Vn = (V - 32768)/65535
+	//   R = Yn + rv*Vn, G = Yn + gu*Un + gv*Vn, B = Yn + bu*Un
+	// Float RGBA is 0-1 and 16 bit RGBA is 0-65535
+	// U and V are the average of each pair of pixels.
+	//
+	struct P216coefficients {
+		float rv, gu, gv, bu; // YUV to RGB
+		float yr, yg, yb; // RGB to YUV
+		float ur, ug, ub;
+		float vr, vg, vb;
+		float yoffset, yscale, cscale; // Range
+	};
+
+	static const float P216coffset = 32768.0f;
+
+	// Coefficients from the red and blue luma weights
+	static P216coefficients MakeP216coefficients(float kr, float kb, bool bFull)
+	{
+		const float kg = 1.0f - kr - kb;
+		P216coefficients c;
+		c.yoffset = bFull ? 0.0f : 4096.0f;
+		c.yscale = bFull ? 65535.0f : 56064.0f; // (235-16)*256
+		c.cscale = bFull ? 65535.0f : 57344.0f; // (240-16)*256
+		c.rv = 2.0f*(1.0f - kr);
+		c.gu = -2.0f*(1.0f - kb)*kb/kg;
+		c.gv = -2.0f*(1.0f - kr)*kr/kg;
+		c.bu = 2.0f*(1.0f - kb);
+		c.yr = kr;
+		c.yg = kg;
+		c.yb = kb;
+		c.ur = -0.5f*kr/(1.0f - kb);
+		c.ug = -0.5f*kg/(1.0f - kb);
+		c.ub = 0.5f;
+		c.vr = 0.5f;
+		c.vg = -0.5f*kg/(1.0f - kr);
+		c.vb = -0.5f*kb/(1.0f - kr);
+		return c;
+	}
+
+	static inline float clamp_float(float x, float hi)
+	{
+		return (x < 0.0f) ? 0.0f : ((x > hi) ? hi : x);
+	}
+
+	// C++ P216 line to float or 16 bit RGBA
+	// Optional alpha plane for PA16
+	static void p216_rgba_cpp(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha,
+		void* rgba, bool bFloat, unsigned int width, const P216coefficients& c)
+	{
+		const float ys = 1.0f/c.yscale;
+		const float cs = 1.0f/c.cscale;
+		const float as = 1.0f/65535.0f;
+		float* fdst = (float*)rgba;
+		uint16_t* sdst = (uint16_t*)rgba;
+
+		for (unsigned int x = 0; x < width; x++) {
+			const float yn = ((float)y[x] - c.yoffset)*ys;
+			const float un = ((float)uv[(x/2)*2] - P216coffset)*cs;
+			const float vn = ((float)uv[(x/2)*2 + 1] - P216coffset)*cs;
+			const float r = clamp_float(yn + c.rv*vn, 1.0f);
+			const float g = clamp_float(yn + c.gu*un + c.gv*vn, 1.0f);
+			const float b = clamp_float(yn + c.bu*un, 1.0f);
+			const float a = alpha ? (float)alpha[x]*as : 1.0f;
+			if (bFloat) {
+				fdst[0] = r;
+				fdst[1] = g;
+				fdst[2] = b;
+				fdst[3] = a;
+				fdst += 4;
+			}
+			else {
+				sdst[0] = (uint16_t)(r*65535.0f + 0.5f);
+				sdst[1] = (uint16_t)(g*65535.0f + 0.5f);
+				sdst[2] = (uint16_t)(b*65535.0f + 0.5f);
+				sdst[3] = (uint16_t)(a*65535.0f + 0.5f);
+				sdst += 4;
+			}
+		}
+	}
+
+	// C++ float or 16 bit RGBA line to P216
+	// Optional alpha plane for PA16
+	static void rgba_p216_cpp(const void* rgba, bool bFloat, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, const P216coefficients& c)
+	{
+		const float as = 1.0f/65535.0f;
+		const float yoffset = c.yoffset + 0.5f;
+		const float coffset = P216coffset + 0.5f;
+		const float* fsrc = (const float*)rgba;
+		const uint16_t* ssrc = (const uint16_t*)rgba;
+		float p[2][4];
+
+		for (unsigned int x = 0; x < width; x += 2) {
+			// Odd width : the last pixel is used for both of the pair
+			const unsigned int n = (x + 1 < width) ? 2 : 1;
+			for (unsigned int i = 0; i < 2; i++) {
+				const unsigned int s = (i < n) ? i*4 : 0;
+				for (unsigned int j = 0; j < 4; j++)
+					p[i][j] = bFloat ? fsrc[s + j] : (float)ssrc[s + j]*as;
+			}
+			const float r = (p[0][0] + p[1][0])*0.5f;
+			const float g = (p[0][1] + p[1][1])*0.5f;
+			const float b = (p[0][2] + p[1][2])*0.5f;
+			uv[0] = (uint16_t)clamp_float((c.ur*r + c.ug*g + c.ub*b)*c.cscale + coffset, 65535.0f);
+			uv[1] = (uint16_t)clamp_float((c.vr*r + c.vg*g + c.vb*b)*c.cscale + coffset, 65535.0f);
+			for (unsigned int i = 0; i < n; i++) {
+				y[i] = (uint16_t)clamp_float((c.yr*p[i][0] + c.yg*p[i][1] + c.yb*p[i][2])*c.yscale + yoffset, 65535.0f);
+				if (alpha) alpha[i] = (uint16_t)clamp_float(p[i][3]*65535.0f + 0.5f, 65535.0f);
+			}
+			fsrc += 8;
+			ssrc += 8;
+			y += 2;
+			uv += 2;
+			if (alpha) alpha += 2;
+		}
+	}
+
+#if defined(USE_SSE2)
+
+	// Four 16 bit values to float
+	static inline __m128 u16_ps_sse2(__m128i v)
+	{
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+	}
+
+	// Eight floats 0-65535 to 16 bit unsigned
+	// without the SSE4.1 unsigned pack
+	static inline __m128i ps_u16_sse2(__m128 a, __m128 b)
+	{
+		const __m128i bias = _mm_set1_epi32(32768);
+		__m128i ia = _mm_sub_epi32(_mm_cvttps_epi32(a), bias);
+		__m128i ib = _mm_sub_epi32(_mm_cvttps_epi32(b), bias);
+		return _mm_xor_si128(_mm_packs_epi32(ia, ib), _mm_set1_epi16((short)0x8000));
+	}
+
+	// Four pixels of float or 16 bit RGBA
+	// to R, G, B, A vectors 0-1
+	static inline void load_rgba4_sse2(const void* rgba, bool bFloat,
+		__m128& r, __m128& g, __m128& b, __m128& a)
+	{
+		if (bFloat) {
+			const float* p = (const float*)rgba;
+			r = _mm_loadu_ps(p);
+			g = _mm_loadu_ps(p + 4);
+			b = _mm_loadu_ps(p + 8);
+			a = _mm_loadu_ps(p + 12);
+		}
+		else {
+			const __m128 as = _mm_set1_ps(1.0f/65535.0f);
+			__m128i p0 = _mm_loadu_si128((const __m128i*)rgba);
+			__m128i p1 = _mm_loadu_si128((const __m128i*)rgba + 1);
+			r = _mm_mul_ps(u16_ps_sse2(p0), as);
+			g = _mm_mul_ps(u16_ps_sse2(_mm_srli_si128(p0, 8)), as);
+			b = _mm_mul_ps(u16_ps_sse2(p1), as);
+			a = _mm_mul_ps(u16_ps_sse2(_mm_srli_si128(p1, 8)), as);
+		}
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+	}
+
+	// R, G, B, A vectors 0-1 to four pixels of float or 16 bit RGBA
+	static inline void store_rgba4_sse2(__m128 r, __m128 g, __m128 b, __m128 a,
+		bool bFloat, void* rgba)
+	{
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+		if (bFloat) {
+			float* p = (float*)rgba;
+			_mm_storeu_ps(p, r);
+			_mm_storeu_ps(p + 4, g);
+			_mm_storeu_ps(p + 8, b);
+			_mm_storeu_ps(p + 12, a);
+		}
+		else {
+			const __m128 scale = _mm_set1_ps(65535.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+			r = _mm_add_ps(_mm_mul_ps(r, scale), half);
+			g = _mm_add_ps(_mm_mul_ps(g, scale), half);
+			b = _mm_add_ps(_mm_mul_ps(b, scale), half);
+			a = _mm_add_ps(_mm_mul_ps(a, scale), half);
+			_mm_storeu_si128((__m128i*)rgba, ps_u16_sse2(r, g));
+			_mm_storeu_si128((__m128i*)rgba + 1, ps_u16_sse2(b, a));
+		}
+	}
+
+	// SSE2 P216 line to float or 16 bit RGBA
+	// 4 pixels per loop
+	static void p216_rgba_sse2(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha,
+		void* rgba, bool bFloat, unsigned int width, const P216coefficients& c)
+	{
+		const __m128 yoffset = _mm_set1_ps(c.yoffset);
+		const __m128 coffset = _mm_set1_ps(P216coffset);
+		const __m128 ys = _mm_set1_ps(1.0f/c.yscale);
+		const __m128 cs = _mm_set1_ps(1.0f/c.cscale);
+		const __m128 as = _mm_set1_ps(1.0f/65535.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 rv = _mm_set1_ps(c.rv);
+		const __m128 gu = _mm_set1_ps(c.gu);
+		const __m128 gv = _mm_set1_ps(c.gv);
+		const __m128 bu = _mm_set1_ps(c.bu);
+		const size_t step = bFloat ? 16 * sizeof(float) : 16 * sizeof(uint16_t);
+		unsigned char* dst = (unsigned char*)rgba;
+
+		unsigned int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			__m128 yn = _mm_mul_ps(_mm_sub_ps(u16_ps_sse2(_mm_loadl_epi64((const __m128i*)(y + x))), yoffset), ys);
+			// U0 V0 U2 V2
+			__m128 c4 = _mm_mul_ps(_mm_sub_ps(u16_ps_sse2(_mm_loadl_epi64((const __m128i*)(uv + x))), coffset), cs);
+			__m128 un = _mm_shuffle_ps(c4, c4, _MM_SHUFFLE(2, 2, 0, 0));
+			__m128 vn = _mm_shuffle_ps(c4, c4, _MM_SHUFFLE(3, 3, 1, 1));
+			__m128 r = _mm_min_ps(_mm_max_ps(_mm_add_ps(yn, _mm_mul_ps(rv, vn)), zero), one);
+			__m128 g = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_add_ps(yn, _mm_mul_ps(gu, un)), _mm_mul_ps(gv, vn)), zero), one);
+			__m128 b = _mm_min_ps(_mm_max_ps(_mm_add_ps(yn, _mm_mul_ps(bu, un)), zero), one);
+			__m128 a = alpha ? _mm_mul_ps(u16_ps_sse2(_mm_loadl_epi64((const __m128i*)(alpha + x))), as) : one;
+			store_rgba4_sse2(r, g, b, a, bFloat, dst);
+			dst += step;
+		}
+		p216_rgba_cpp(y + x, uv + x, alpha ? alpha + x : nullptr, dst, bFloat, width - x, c);
+	}
+
+	// SSE2 float or 16 bit RGBA line to P216
+	// 4 pixels per loop
+	static void rgba_p216_sse2(const void* rgba, bool bFloat, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, const P216coefficients& c)
+	{
+		const __m128 yscale = _mm_set1_ps(c.yscale);
+		const __m128 cscale = _mm_set1_ps(c.cscale);
+		const __m128 yoffset = _mm_set1_ps(c.yoffset + 0.5f);
+		const __m128 coffset = _mm_set1_ps(P216coffset + 0.5f);
+		const __m128 ascale = _mm_set1_ps(65535.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 limit = _mm_set1_ps(65535.0f);
+		const __m128 yr = _mm_set1_ps(c.yr), yg = _mm_set1_ps(c.yg), yb = _mm_set1_ps(c.yb);
+		const __m128 ur = _mm_set1_ps(c.ur), ug = _mm_set1_ps(c.ug), ub = _mm_set1_ps(c.ub);
+		const __m128 vr = _mm_set1_ps(c.vr), vg = _mm_set1_ps(c.vg), vb = _mm_set1_ps(c.vb);
+		const size_t step = bFloat ? 16 * sizeof(float) : 16 * sizeof(uint16_t);
+		const unsigned char* src = (const unsigned char*)rgba;
+		__m128 r, g, b, a;
+
+		unsigned int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			load_rgba4_sse2(src, bFloat, r, g, b, a);
+			__m128 yv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(yr, r), _mm_mul_ps(yg, g)), _mm_mul_ps(yb, b));
+			yv = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(yv, yscale), yoffset), zero), limit);
+			// Averages of each pair of pixels in the first two lanes
+			__m128 rs = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 2, 0)), _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 1))), half);
+			__m128 gs = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(g, g, _MM_SHUFFLE(3, 3, 2, 0)), _mm_shuffle_ps(g, g, _MM_SHUFFLE(3, 3, 3, 1))), half);
+			__m128 bs = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 2, 0)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 1))), half);
+			__m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ur, rs), _mm_mul_ps(ug, gs)), _mm_mul_ps(ub, bs));
+			__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr, rs), _mm_mul_ps(vg, gs)), _mm_mul_ps(vb, bs));
+			// U0 V0 U2 V2
+			__m128 uvs = _mm_unpacklo_ps(u, v);
+			uvs = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(uvs, cscale), coffset), zero), limit);
+			__m128i yuv = ps_u16_sse2(yv, uvs);
+			_mm_storel_epi64((__m128i*)(y + x), yuv);
+			_mm_storel_epi64((__m128i*)(uv + x), _mm_unpackhi_epi64(yuv, yuv));
+			if (alpha) {
+				a = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(a, ascale), half), zero), limit);
+				_mm_storel_epi64((__m128i*)(alpha + x), ps_u16_sse2(a, a));
+			}
+			src += step;
+		}
+		rgba_p216_cpp(src, bFloat, y + x, uv + x, alpha ? alpha + x : nullptr, width - x, c);
+	}
+
+#endif // endif USE_SSE2
+
+#if defined(USE_AVX)
+
+	// Transpose 4x4 floats within each 128 bit lane
+	static AVX2_FUNC inline void transpose4_avx2(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t2 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+		r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+		r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+		r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	// Eight 16 bit values to float
+	static AVX2_FUNC inline __m256 u16_ps_avx2(__m128i v)
+	{
+		return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v));
+	}
+
+	// Eight pixels of float or 16 bit RGBA
+	// to R, G, B, A vectors 0-1
+	static AVX2_FUNC inline void load_rgba8_avx2(const void* rgba, bool bFloat,
+		__m256& r, __m256& g, __m256& b, __m256& a)
+	{
+		// Pixels 0|1, 2|3, 4|5, 6|7
+		__m256 p0, p1, p2, p3;
+		if (bFloat) {
+			const float* p = (const float*)rgba;
+			p0 = _mm256_loadu_ps(p);
+			p1 = _mm256_loadu_ps(p + 8);
+			p2 = _mm256_loadu_ps(p + 16);
+			p3 = _mm256_loadu_ps(p + 24);
+		}
+		else {
+			const __m256 as = _mm256_set1_ps(1.0f/65535.0f);
+			__m256i s0 = _mm256_loadu_si256((const __m256i*)rgba);
+			__m256i s1 = _mm256_loadu_si256((const __m256i*)rgba + 1);
+			p0 = _mm256_mul_ps(u16_ps_avx2(_mm256_castsi256_si128(s0)), as);
+			p1 = _mm256_mul_ps(u16_ps_avx2(_mm256_extracti128_si256(s0, 1)), as);
+			p2 = _mm256_mul_ps(u16_ps_avx2(_mm256_castsi256_si128(s1)), as);
+			p3 = _mm256_mul_ps(u16_ps_avx2(_mm256_extracti128_si256(s1, 1)), as);
+		}
+		// Pixels 0|4, 1|5, 2|6, 3|7
+		r = _mm256_permute2f128_ps(p0, p2, 0x20);
+		g = _mm256_permute2f128_ps(p0, p2, 0x31);
+		b = _mm256_permute2f128_ps(p1, p3, 0x20);
+		a = _mm256_permute2f128_ps(p1, p3, 0x31);
+		transpose4_avx2(r, g, b, a);
+	}
+
+	// R, G, B, A vectors 0-1 to eight pixels of float or 16 bit RGBA
+	static AVX2_FUNC inline void store_rgba8_avx2(__m256 r, __m256 g, __m256 b, __m256 a,
+		bool bFloat, void* rgba)
+	{
+		// Pixels 0|4, 1|5, 2|6, 3|7
+		transpose4_avx2(r, g, b, a);
+		if (bFloat) {
+			float* p = (float*)rgba;
+			_mm256_storeu_ps(p,      _mm256_permute2f128_ps(r, g, 0x20));
+			_mm256_storeu_ps(p + 8,  _mm256_permute2f128_ps(b, a, 0x20));
+			_mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(r, g, 0x31));
+			_mm256_storeu_ps(p + 24, _mm256_permute2f128_ps(b, a, 0x31));
+		}
+		else {
+			const __m256 scale = _mm256_set1_ps(65535.0f);
+			const __m256 half = _mm256_set1_ps(0.5f);
+			const __m256i bias = _mm256_set1_epi32(32768);
+			__m256i ir = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(r, scale), half)), bias);
+			__m256i ig = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(g, scale), half)), bias);
+			__m256i ib = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(b, scale), half)), bias);
+			__m256i ia = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(a, scale), half)), bias);
+			// Pixels 0,1|4,5 and 2,3|6,7
+			__m256i p01 = _mm256_packs_epi32(ir, ig);
+			__m256i p23 = _mm256_packs_epi32(ib, ia);
+			const __m256i sign = _mm256_set1_epi16((short)0x8000);
+			_mm256_storeu_si256((__m256i*)rgba, _mm256_xor_si256(_mm256_permute2x128_si256(p01, p23, 0x20), sign));
+			_mm256_storeu_si256((__m256i*)rgba + 1, _mm256_xor_si256(_mm256_permute2x128_si256(p01, p23, 0x31), sign));
+		}
+	}
+
+	// AVX2 P216 line to float or 16 bit RGBA
+	// 8 pixels per loop
+	static AVX2_FUNC void p216_rgba_avx2(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha,
+		void* rgba, bool bFloat, unsigned int width, const P216coefficients& c)
+	{
+		const __m256 yoffset = _mm256_set1_ps(c.yoffset);
+		const __m256 coffset = _mm256_set1_ps(P216coffset);
+		const __m256 ys = _mm256_set1_ps(1.0f/c.yscale);
+		const __m256 cs = _mm256_set1_ps(1.0f/c.cscale);
+		const __m256 as = _mm256_set1_ps(1.0f/65535.0f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 rv = _mm256_set1_ps(c.rv);
+		const __m256 gu = _mm256_set1_ps(c.gu);
+		const __m256 gv = _mm256_set1_ps(c.gv);
+		const __m256 bu = _mm256_set1_ps(c.bu);
+		const size_t step = bFloat ? 32 * sizeof(float) : 32 * sizeof(uint16_t);
+		unsigned char* dst = (unsigned char*)rgba;
+
+		unsigned int x = 0;
+		for (; x + 8 <= width; x += 8) {
+			__m256 yn = _mm256_mul_ps(_mm256_sub_ps(u16_ps_avx2(_mm_loadu_si128((const __m128i*)(y + x))), yoffset), ys);
+			// U0 V0 U2 V2 | U4 V4 U6 V6
+			__m256 c8 = _mm256_mul_ps(_mm256_sub_ps(u16_ps_avx2(_mm_loadu_si128((const __m128i*)(uv + x))), coffset), cs);
+			__m256 un = _mm256_shuffle_ps(c8, c8, _MM_SHUFFLE(2, 2, 0, 0));
+			__m256 vn = _mm256_shuffle_ps(c8, c8, _MM_SHUFFLE(3, 3, 1, 1));
+			__m256 r = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(yn, _mm256_mul_ps(rv, vn)), zero), one);
+			__m256 g = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_add_ps(yn, _mm256_mul_ps(gu, un)), _mm256_mul_ps(gv, vn)), zero), one);
+			__m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(yn, _mm256_mul_ps(bu, un)), zero), one);
+			__m256 a = alpha ? _mm256_mul_ps(u16_ps_avx2(_mm_loadu_si128((const __m128i*)(alpha + x))), as) : one;
+			store_rgba8_avx2(r, g, b, a, bFloat, dst);
+			dst += step;
+		}
+		p216_rgba_sse2(y + x, uv + x, alpha ? alpha + x : nullptr, dst, bFloat, width - x, c);
+	}
+
+	// AVX2 float or 16 bit RGBA line to P216
+	// 8 pixels per loop
+	static AVX2_FUNC void rgba_p216_avx2(const void* rgba, bool bFloat, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, const P216coefficients& c)
+	{
+		const __m256 yscale = _mm256_set1_ps(c.yscale);
+		const __m256 cscale = _mm256_set1_ps(c.cscale);
+		const __m256 yoffset = _mm256_set1_ps(c.yoffset + 0.5f);
+		const __m256 coffset = _mm256_set1_ps(P216coffset + 0.5f);
+		const __m256 ascale = _mm256_set1_ps(65535.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 limit = _mm256_set1_ps(65535.0f);
+		const __m256 yr = _mm256_set1_ps(c.yr), yg = _mm256_set1_ps(c.yg), yb = _mm256_set1_ps(c.yb);
+		const __m256 ur = _mm256_set1_ps(c.ur), ug = _mm256_set1_ps(c.ug), ub = _mm256_set1_ps(c.ub);
+		const __m256 vr = _mm256_set1_ps(c.vr), vg = _mm256_set1_ps(c.vg), vb = _mm256_set1_ps(c.vb);
+		const __m256i bias = _mm256_set1_epi32(32768);
+		const __m256i sign = _mm256_set1_epi16((short)0x8000);
+		const size_t step = bFloat ? 32 * sizeof(float) : 32 * sizeof(uint16_t);
+		const unsigned char* src = (const unsigned char*)rgba;
+		__m256 r, g, b, a;
+
+		unsigned int x = 0;
+		for (; x + 8 <= width; x += 8) {
+			load_rgba8_avx2(src, bFloat, r, g, b, a);
+			__m256 yv = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(yr, r), _mm256_mul_ps(yg, g)), _mm256_mul_ps(yb, b));
+			yv = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(yv, yscale), yoffset), zero), limit);
+			// Averages of each pair of pixels in the first two lanes of each half
+			__m256 rs = _mm256_mul_ps(_mm256_add_ps(_mm256_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 2, 0)), _mm256_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 1))), half);
+			__m256 gs = _mm256_mul_ps(_mm256_add_ps(_mm256_shuffle_ps(g, g, _MM_SHUFFLE(3, 3, 2, 0)), _mm256_shuffle_ps(g, g, _MM_SHUFFLE(3, 3, 3, 1))), half);
+			__m256 bs = _mm256_mul_ps(_mm256_add_ps(_mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 2, 0)), _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 1))), half);
+			__m256 u = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ur, rs), _mm256_mul_ps(ug, gs)), _mm256_mul_ps(ub, bs));
+			__m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr, rs), _mm256_mul_ps(vg, gs)), _mm256_mul_ps(vb, bs));
+			// U0 V0 U2 V2 | U4 V4 U6 V6
+			__m256 uvs = _mm256_unpacklo_ps(u, v);
+			uvs = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(uvs, cscale), coffset), zero), limit);
+			// Y0-3 UV0-3 | Y4-7 UV4-7 > Y0-7 UV0-7
+			__m256i yuv = _mm256_packs_epi32(_mm256_sub_epi32(_mm256_cvttps_epi32(yv), bias), _mm256_sub_epi32(_mm256_cvttps_epi32(uvs), bias));
+			yuv = _mm256_xor_si256(_mm256_permute4x64_epi64(yuv, _MM_SHUFFLE(3, 1, 2, 0)), sign);
+			_mm_storeu_si128((__m128i*)(y + x), _mm256_castsi256_si128(yuv));
+			_mm_storeu_si128((__m128i*)(uv + x), _mm256_extracti128_si256(yuv, 1));
+			if (alpha) {
+				a = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(a, ascale), half), zero), limit);
+				__m256i ia = _mm256_sub_epi32(_mm256_cvttps_epi32(a), bias);
+				ia = _mm256_xor_si256(_mm256_permute4x64_epi64(_mm256_packs_epi32(ia, ia), _MM_SHUFFLE(3, 1, 2, 0)), sign);
+				_mm_storeu_si128((__m128i*)(alpha + x), _mm256_castsi256_si128(ia));
+			}
+			src += step;
+		}
+		rgba_p216_sse2(src, bFloat, y + x, uv + x, alpha ? alpha + x : nullptr, width - x, c);
+	}
+
+#endif // endif USE_AVX
+
+	//
+	// Downscale kernels
+	//
+	// Box filter of 2x2 or 4x4 rgba source pixels for each
+	// destination pixel, averaged with rounding.
+	//   D = (sum + factor*factor/2) / (factor*factor)
+	// rows - pointers to each of the factor source lines
+	//
+
+	// C++ box filter line
+	static void box_cpp(const unsigned char* const* rows, unsigned int factor, unsigned char* dst, unsigned int dstWidth)
+	{
+		const unsigned int shift = (factor == 4) ? 4 : 2;
+		const unsigned int round = 1u << (shift - 1);
+		for (unsigned int x = 0; x < dstWidth; x++) {
+			const size_t offset = (size_t)x * factor * 4;
+			for (unsigned int c = 0; c < 4; c++) {
+				unsigned int sum = round;
+				for (unsigned int r = 0; r < factor; r++) {
+					for (unsigned int i = 0; i < factor; i++)
+						sum += rows[r][offset + i * 4 + c];
+				}
+				dst[x * 4 + c] = (unsigned char)(sum >> shift);
+			}
+		}
+	}
+
+#if defined(USE_SSE2)
+
+	// Sum of 4 pixels of each line as 16 bit
+	// lo - pixels 0, 1  hi - pixels 2, 3
+	static inline void box_rows_sse2(const unsigned char* const* rows, unsigned int factor, size_t offset, __m128i& lo, __m128i& hi)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		lo = _mm_setzero_si128();
+		hi = _mm_setzero_si128();
+		for (unsigned int r = 0; r < factor; r++) {
+			__m128i p = _mm_loadu_si128((const __m128i*)(rows[r] + offset));
+			lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(p, zero));
+			hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(p, zero));
+		}
+	}
+
+	// Add the two pixels of a register to the low 64 bits
+	static inline __m128i box_pair_sse2(__m128i s)
+	{
+		return _mm_add_epi16(s, _mm_srli_si128(s, 8));
+	}
+
+	// SSE2 box filter line
+	// 4 destination pixels per loop
+	static void box_sse2(const unsigned char* const* rows, unsigned int factor, unsigned char* dst, unsigned int dstWidth)
+	{
+		__m128i lo, hi, d0, d1, d2, d3;
+		unsigned int x = 0;
+		if (factor == 2) {
+			const __m128i round = _mm_set1_epi16(2);
+			for (; x + 4 <= dstWidth; x += 4) {
+				const size_t offset = (size_t)x * 8;
+				box_rows_sse2(rows, 2, offset, lo, hi);
+				d0 = box_pair_sse2(lo);
+				d1 = box_pair_sse2(hi);
+				box_rows_sse2(rows, 2, offset + 16, lo, hi);
+				d2 = box_pair_sse2(lo);
+				d3 = box_pair_sse2(hi);
+				__m128i a = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(d0, d1), round), 2);
+				__m128i b = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(d2, d3), round), 2);
+				_mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(a, b));
+			}
+		}
+		else {
+			const __m128i round = _mm_set1_epi16(8);
+			for (; x + 4 <= dstWidth; x += 4) {
+				const size_t offset = (size_t)x * 16;
+				box_rows_sse2(rows, 4, offset, lo, hi);
+				d0 = box_pair_sse2(_mm_add_epi16(lo, hi));
+				box_rows_sse2(rows, 4, offset + 16, lo, hi);
+				d1 = box_pair_sse2(_mm_add_epi16(lo, hi));
+				box_rows_sse2(rows, 4, offset + 32, lo, hi);
+				d2 = box_pair_sse2(_mm_add_epi16(lo, hi));
+				box_rows_sse2(rows, 4, offset + 48, lo, hi);
+				d3 = box_pair_sse2(_mm_add_epi16(lo, hi));
+				__m128i a = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(d0, d1), round), 4);
+				__m128i b = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(d2, d3), round), 4);
+				_mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(a, b));
+			}
+		}
+		if (x < dstWidth) {
+			const unsigned char* rest[4];
+			for (unsigned int r = 0; r < factor; r++)
+				rest[r] = rows[r] + (size_t)x * factor * 4;
+			box_cpp(rest, factor, dst + x * 4, dstWidth - x);
+		}
+	}
+
+#endif // endif USE_SSE2
+
+#if defined(USE_AVX)
+
+	// As for box_rows_sse2 with 8 pixels
+	// lo - pixels 0, 1 | 4, 5  hi - pixels 2, 3 | 6, 7
+	static AVX2_FUNC inline void box_rows_avx2(const unsigned char* const* rows, unsigned int factor, size_t offset, __m256i& lo, __m256i& hi)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		lo = _mm256_setzero_si256();
+		hi = _mm256_setzero_si256();
+		for (unsigned int r = 0; r < factor; r++) {
+			__m256i p = _mm256_loadu_si256((const __m256i*)(rows[r] + offset));
+			lo = _mm256_add_epi16(lo, _mm256_unpacklo_epi8(p, zero));
+			hi = _mm256_add_epi16(hi, _mm256_unpackhi_epi8(p, zero));
+		}
+	}
+
+	static AVX2_FUNC inline __m256i box_pair_avx2(__m256i s)
+	{
+		return _mm256_add_epi16(s, _mm256_srli_si256(s, 8));
+	}
+
+	// AVX2 box filter line
+	// 8 destination pixels per loop
+	static AVX2_FUNC void box_avx2(const unsigned char* const* rows, unsigned int factor, unsigned char* dst, unsigned int dstWidth)
+	{
+		__m256i lo, hi;
+		unsigned int x = 0;
+		if (factor == 2) {
+			const __m256i round = _mm256_set1_epi16(2);
+			for (; x + 8 <= dstWidth; x += 8) {
+				const size_t offset = (size_t)x * 8;
+				// Destination pixels 0, 1 | 2, 3
+				box_rows_avx2(rows, 2, offset, lo, hi);
+				__m256i a = _mm256_unpacklo_epi64(box_pair_avx2(lo), box_pair_avx2(hi));
+				// Destination pixels 4, 5 | 6, 7
+				box_rows_avx2(rows, 2, offset + 32, lo, hi);
+				__m256i b = _mm256_unpacklo_epi64(box_pair_avx2(lo), box_pair_avx2(hi));
+				a = _mm256_srli_epi16(_mm256_add_epi16(a, round), 2);
+				b = _mm256_srli_epi16(_mm256_add_epi16(b, round), 2);
+				// Pixels 0, 1, 4, 5 | 2, 3, 6, 7
+				_mm256_storeu_si256((__m256i*)(dst + x * 4),
+					_mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+			}
+		}
+		else {
+			const __m256i round = _mm256_set1_epi16(8);
+			__m256i d[4];
+			for (; x + 8 <= dstWidth; x += 8) {
+				const size_t offset = (size_t)x * 16;
+				// Each has destination pixels 2j | 2j+1
+				for (unsigned int j = 0; j < 4; j++) {
+					box_rows_avx2(rows, 4, offset + j * 32, lo, hi);
+					d[j] = box_pair_avx2(_mm256_add_epi16(lo, hi));
+				}
+				__m256i a = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(d[0], d[1]), round), 4);
+				__m256i b = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(d[2], d[3]), round), 4);
+				// Pixels 0, 2, 4, 6 | 1, 3, 5, 7
+				_mm256_storeu_si256((__m256i*)(dst + x * 4),
+					_mm256_permutevar8x32_epi32(_mm256_packus_epi16(a, b), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+			}
+		}
+		if (x < dstWidth) {
+			const unsigned char* rest[4];
+			for (unsigned int r = 0; r < factor; r++)
+				rest[r] = rows[r] + (size_t)x * factor * 4;
+			box_sse2(rest, factor, dst + x * 4, dstWidth - x);
+		}
+	}
+
+#endif // endif USE_AVX
+
+	//
+	// Audio kernels
+	//
+	// Float to integer samples are scaled, dithered if required,
+	// clamped to the integer range and rounded to nearest even.
+	// Dither is triangular (TPDF) of +-1 LSB, the difference of the
+	// two 16 bit halves of a xorshift generator with 4 lanes.
+	// Each group of 4 samples advances every lane once, so that
+	// the C++ and SIMD kernels give identical results.
+	//
+
+	static const float AudioMaxInt16 = 32767.0f;
+	static const float AudioMinInt16 = -32768.0f;
+	static const float AudioMaxInt32 = 2147483520.0f; // Largest float below 2^31
+	static const float AudioMinInt32 = -2147483648.0f;
+
+	static inline void audio_dither_step(uint32_t* state)
+	{
+		for (int i = 0; i < 4; i++) {
+			uint32_t x = state[i];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			state[i] = x;
+		}
+	}
+
+	static inline float audio_dither(uint32_t x)
+	{
+		return ((float)(int32_t)(x >> 16) - (float)(int32_t)(x & 0xFFFF)) * (1.0f / 65536.0f);
+	}
+
+	// Scale, dither and clamp
+	// Comparisons as for SSE max and min so that NaN gives the minimum
+	static inline float audio_clamp(float v, float lo, float hi)
+	{
+		v = (v > lo) ? v : lo;
+		return (v < hi) ? v : hi;
+	}
+
+	// Float to 16 bit samples
+	// - dither | 4 lane generator state or nullptr for no dither
+	static void audio_to_int16_cpp(const float* src, int16_t* dst, size_t n, float scale, uint32_t* dither)
+	{
+		for (size_t i = 0; i < n; i += 4) {
+			if (dither)
+				audio_dither_step(dither);
+			for (size_t j = 0; j < 4 && i + j < n; j++) {
+				float v = src[i + j] * scale;
+				if (dither)
+					v = v + audio_dither(dither[j]);
+				dst[i + j] = (int16_t)lrintf(audio_clamp(v, AudioMinInt16, AudioMaxInt16));
+			}
+		}
+	}
+
+	// Float to 32 bit samples
+	static void audio_to_int32_cpp(const float* src, int32_t* dst, size_t n, float scale, uint32_t* dither)
+	{
+		for (size_t i = 0; i < n; i += 4) {
+			if (dither)
+				audio_dither_step(dither);
+			for (size_t j = 0; j < 4 && i + j < n; j++) {
+				float v = src[i + j] * scale;
+				if (dither)
+					v = v + audio_dither(dither[j]);
+				dst[i + j] = (int32_t)lrintf(audio_clamp(v, AudioMinInt32, AudioMaxInt32));
+			}
+		}
+	}
+
+	static void audio_from_int16_cpp(const int16_t* src, float* dst, size_t n, float scale)
+	{
+		for (size_t i = 0; i < n; i++)
+			dst[i] = (float)src[i] * scale;
+	}
+
+	static void audio_from_int32_cpp(const int32_t* src, float* dst, size_t n, float scale)
+	{
+		for (size_t i = 0; i < n; i++)
+			dst[i] = (float)src[i] * scale;
+	}
+
+	static void audio_gain_cpp(const float* src, float* dst, size_t n, float gain)
+	{
+		for (size_t i = 0; i < n; i++)
+			dst[i] = src[i] * gain;
+	}
+
+	// Two channels to and from interleaved
+	// 16 bit samples, and 32 bit for both integer and float
+	static void interleave2_16_cpp(const uint16_t* a, const uint16_t* b, uint16_t* dst, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			dst[i * 2] = a[i];
+			dst[i * 2 + 1] = b[i];
+		}
+	}
+
+	static void interleave2_32_cpp(const uint32_t* a, const uint32_t* b, uint32_t* dst, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			dst[i * 2] = a[i];
+			dst[i * 2 + 1] = b[i];
+		}
+	}
+
+	static void deinterleave2_16_cpp(const uint16_t* src, uint16_t* a, uint16_t* b, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			a[i] = src[i * 2];
+			b[i] = src[i * 2 + 1];
+		}
+	}
+
+	static void deinterleave2_32_cpp(const uint32_t* src, uint32_t* a, uint32_t* b, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			a[i] = src[i * 2];
+			b[i] = src[i * 2 + 1];
+		}
+	}
+
+#if defined(USE_SSE2)
+
+	// SSE2 dither of 4 samples from the 4 lane generator
+	static inline __m128 audio_dither_sse2(__m128i& state)
+	{
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+		state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+		const __m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(state, 16));
+		const __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(state, _mm_set1_epi32(0xFFFF)));
+		return _mm_mul_ps(_mm_sub_ps(hi, lo), _mm_set1_ps(1.0f / 65536.0f));
+	}
+
+	// 4 samples scaled, dithered, clamped and rounded
+	static inline __m128i audio_round_sse2(const float* src, __m128 scale, __m128 lo, __m128 hi,
+		bool bDither, __m128i& state)
+	{
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(src), scale);
+		if (bDither)
+			v = _mm_add_ps(v, audio_dither_sse2(state));
+		return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+	}
+
+	// SSE2 float to 16 bit samples
+	// 8 samples per loop
+	static void audio_to_int16_sse2(const float* src, int16_t* dst, size_t n, float scale, uint32_t* dither)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		const __m128 lo = _mm_set1_ps(AudioMinInt16);
+		const __m128 hi = _mm_set1_ps(AudioMaxInt16);
+		const bool bDither = (dither != nullptr);
+		__m128i state = bDither ? _mm_loadu_si128((const __m128i*)dither) : _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			const __m128i a = audio_round_sse2(src + i, vscale, lo, hi, bDither, state);
+			const __m128i b = audio_round_sse2(src + i + 4, vscale, lo, hi, bDither, state);
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+		}
+		if (bDither)
+			_mm_storeu_si128((__m128i*)dither, state);
+		if (i < n)
+			audio_to_int16_cpp(src + i, dst + i, n - i, scale, dither);
+	}
+
+	// SSE2 float to 32 bit samples
+	static void audio_to_int32_sse2(const float* src, int32_t* dst, size_t n, float scale, uint32_t* dither)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		const __m128 lo = _mm_set1_ps(AudioMinInt32);
+		const __m128 hi = _mm_set1_ps(AudioMaxInt32);
+		const bool bDither = (dither != nullptr);
+		__m128i state = bDither ? _mm_loadu_si128((const __m128i*)dither) : _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_si128((__m128i*)(dst + i), audio_round_sse2(src + i, vscale, lo, hi, bDither, state));
+		if (bDither)
+			_mm_storeu_si128((__m128i*)dither, state);
+		if (i < n)
+			audio_to_int32_cpp(src + i, dst + i, n - i, scale, dither);
+	}
+
+	// SSE2 16 bit samples to float
+	// Sign extended by unpacking into the high half and shifting down
+	static void audio_from_int16_sse2(const int16_t* src, float* dst, size_t n, float scale)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+			const __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			const __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), vscale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), vscale));
+		}
+		if (i < n)
+			audio_from_int16_cpp(src + i, dst + i, n - i, scale);
+	}
+
+	static void audio_from_int32_sse2(const int32_t* src, float* dst, size_t n, float scale)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(src + i)));
+			_mm_storeu_ps(dst + i, _mm_mul_ps(v, vscale));
+		}
+		if (i < n)
+			audio_from_int32_cpp(src + i, dst + i, n - i, scale);
+	}
+
+	static void audio_gain_sse2(const float* src, float* dst, size_t n, float gain)
+	{
+		const __m128 vgain = _mm_set1_ps(gain);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), vgain));
+		if (i < n)
+			audio_gain_cpp(src + i, dst + i, n - i, gain);
+	}
+
+	static void interleave2_16_sse2(const uint16_t* a, const uint16_t* b, uint16_t* dst, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+			const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+			_mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi16(va, vb));
+			_mm_storeu_si128((__m128i*)(dst + i * 2 + 8), _mm_unpackhi_epi16(va, vb));
+		}
+		if (i < n)
+			interleave2_16_cpp(a + i, b + i, dst + i * 2, n - i);
+	}
+
+	static void interleave2_32_sse2(const uint32_t* a, const uint32_t* b, uint32_t* dst, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+			const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+			_mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi32(va, vb));
+			_mm_storeu_si128((__m128i*)(dst + i * 2 + 4), _mm_unpackhi_epi32(va, vb));
+		}
+		if (i < n)
+			interleave2_32_cpp(a + i, b + i, dst + i * 2, n - i);
+	}
+
+	// Even samples are sign extended from the low half and odd
+	// samples shifted down from the high half, so that the
+	// saturating pack is exact.
+	static void deinterleave2_16_sse2(const uint16_t* src, uint16_t* a, uint16_t* b, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			const __m128i s0 = _mm_loadu_si128((const __m128i*)(src + i * 2));
+			const __m128i s1 = _mm_loadu_si128((const __m128i*)(src + i * 2 + 8));
+			const __m128i e = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(s0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(s1, 16), 16));
+			const __m128i o = _mm_packs_epi32(_mm_srai_epi32(s0, 16), _mm_srai_epi32(s1, 16));
+			_mm_storeu_si128((__m128i*)(a + i), e);
+			_mm_storeu_si128((__m128i*)(b + i), o);
+		}
+		if (i < n)
+			deinterleave2_16_cpp(src + i * 2, a + i, b + i, n - i);
+	}
+
+	static void deinterleave2_32_sse2(const uint32_t* src, uint32_t* a, uint32_t* b, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const __m128 s0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src + i * 2)));
+			const __m128 s1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(src + i * 2 + 4)));
+			_mm_storeu_si128((__m128i*)(a + i), _mm_castps_si128(_mm_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0))));
+			_mm_storeu_si128((__m128i*)(b + i), _mm_castps_si128(_mm_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1))));
+		}
+		if (i < n)
+			deinterleave2_32_cpp(src + i * 2, a + i, b + i, n - i);
+	}
+
+#endif // endif USE_SSE2
+
+	//
+	// Runtime selection of image function kernels
+	//
+
+	struct ImageKernels {
+		SimdLevel level;
+		void (*copy)(void* dst, const void* src, size_t size, bool bStream);
+		void (*swap)(const uint32_t* src, uint32_t* dst, unsigned int npixels);
+		void (*swaplines)(unsigned char* a, unsigned char* b, size_t size);
+		void (*uyvy)(const unsigned char* yuv, unsigned char* rgba, unsigned int width, const YUVcoefficients& c);
+		void (*rgba_uyvy)(const unsigned char* rgba, unsigned char* yuv, unsigned char* alpha, unsigned int width, const RGBtoYUVcoefficients& c);
+		void (*yuv420)(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned int uvstep, unsigned char* rgba, unsigned int width, const YUVcoefficients& c);
+		void (*p216_rgba)(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha, void* rgba, bool bFloat, unsigned int width, const P216coefficients& c);
+		void (*rgba_p216)(const void* rgba, bool bFloat, uint16_t* y, uint16_t* uv, uint16_t* alpha, unsigned int width, const P216coefficients& c);
+		void (*box)(const unsigned char* const* rows, unsigned int factor, unsigned char* dst, unsigned int dstWidth);
+		void (*audio_to_int16)(const float* src, int16_t* dst, size_t n, float scale, uint32_t* dither);
+		void (*audio_to_int32)(const float* src, int32_t* dst, size_t n, float scale, uint32_t* dither);
+		void (*audio_from_int16)(const int16_t* src, float* dst, size_t n, float scale);
+		void (*audio_from_int32)(const int32_t* src, float* dst, size_t n, float scale);
+		void (*audio_gain)(const float* src, float* dst, size_t n, float gain);
+		void (*interleave2_16)(const uint16_t* a, const uint16_t* b, uint16_t* dst, size_t n);
+		void (*interleave2_32)(const uint32_t* a, const uint32_t* b, uint32_t* dst, size_t n);
+		void (*deinterleave2_16)(const uint16_t* src, uint16_t* a, uint16_t* b, size_t n);
+		void (*deinterleave2_32)(const uint32_t* src, uint32_t* a, uint32_t* b, size_t n);
+	};
+
+	static SimdLevel DetectSimdLevel()
+	{
+#if defined(USE_AVX)
+#if defined(_MSC_VER)
+		int info[4] = {};
+		__cpuid(info, 0);
+		const int maxleaf = info[0];
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		// Operating system support for ymm (0x6) and zmm (0xe0) registers
+		const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+		if (maxleaf >= 7 && avx && (xcr0 & 0x6) == 0x6) {
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (xcr0 & 0xe6) == 0xe6)
+				return SIMD_AVX512;
+			if (info[1] & (1 << 5))
+				return SIMD_AVX2;
+		}
+		return SIMD_SSE2;
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+			return SIMD_AVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return SIMD_AVX2;
+		return SIMD_SSE2;
+#endif
+#elif defined(USE_SSE2)
+		return SIMD_SSE2;
+#else
+		return SIMD_NONE;
+#endif
+	}
+
+	// Is the instruction set supported by this CPU
+	static bool IsSimdSupported(SimdLevel level)
+	{
+		const SimdLevel cpulevel = GetCpuSimdLevel();
+		if (level == SIMD_NONE || level == cpulevel)
+			return true;
+#if defined(USE_AVX)
+		// Lower x86 levels
+		return (level < cpulevel && level != SIMD_NEON);
+#else
+		return false;
+#endif
+	}
+
+#if defined(USE_SSE2)
+	// Audio buffers are small, so AVX2 and AVX-512 use the SSE2 audio kernels
+	static void SelectAudioKernelsSSE2(ImageKernels& k)
+	{
+		k.audio_to_int16 = audio_to_int16_sse2;
+		k.audio_to_int32 = audio_to_int32_sse2;
+		k.audio_from_int16 = audio_from_int16_sse2;
+		k.audio_from_int32 = audio_from_int32_sse2;
+		k.audio_gain = audio_gain_sse2;
+		k.interleave2_16 = interleave2_16_sse2;
+		k.interleave2_32 = interleave2_32_sse2;
+		k.deinterleave2_16 = deinterleave2_16_sse2;
+		k.deinterleave2_32 = deinterleave2_32_sse2;
+	}
+#endif
+
+	static ImageKernels SelectKernels(SimdLevel level)
+	{
+		ImageKernels k = { SIMD_NONE, copy_cpp, swap_cpp, swaplines_cpp, uyvy_cpp, rgba_uyvy_cpp, yuv420_cpp, p216_rgba_cpp, rgba_p216_cpp, box_cpp,
+			audio_to_int16_cpp, audio_to_int32_cpp, audio_from_int16_cpp, audio_from_int32_cpp, audio_gain_cpp,
+			interleave2_16_cpp, interleave2_32_cpp, deinterleave2_16_cpp, deinterleave2_32_cpp };
+		if (!IsSimdSupported(level))
+			level = GetCpuSimdLevel();
+
+		switch (level) {
+#if defined(USE_AVX)
+			case SIMD_AVX512:
+				k.copy = copy_avx512;
+				k.swap = swap_avx512;
+				k.swaplines = swaplines_avx512;
+				k.uyvy = uyvy_avx2;
+				k.rgba_uyvy = rgba_uyvy_avx2;
+				k.yuv420 = yuv420_avx2;
+				k.p216_rgba = p216_rgba_avx2;
+				k.rgba_p216 = rgba_p216_avx2;
+				k.box = box_avx2;
+				SelectAudioKernelsSSE2(k);
+				break;
+			case SIMD_AVX2:
+				k.copy = copy_avx2;
+				k.swap = swap_avx2;
+				k.swaplines = swaplines_avx2;
+				k.uyvy = uyvy_avx2;
+				k.rgba_uyvy = rgba_uyvy_avx2;
+				k.yuv420 = yuv420_avx2;
+				k.p216_rgba = p216_rgba_avx2;
+				k.rgba_p216 = rgba_p216_avx2;
+				k.box = box_avx2;
+				SelectAudioKernelsSSE2(k);
+				break;
+#endif
+#if defined(USE_SSE2)
+			case SIMD_SSE2:
+				k.copy = copy_sse2;
+				k.swap = swap_sse2;
+				k.swaplines = swaplines_sse2;
+				k.uyvy = uyvy_sse2;
+				k.rgba_uyvy = rgba_uyvy_sse2;
+				k.yuv420 = yuv420_sse2;
+				k.p216_rgba = p216_rgba_sse2;
+				k.rgba_p216 = rgba_p216_sse2;
+				k.box = box_sse2;
+				SelectAudioKernelsSSE2(k);
+				break;
+#endif
+			default:
+				level = SIMD_NONE;
+				break;
+		}
+		k.level = level;
+		return k;
+	}
+
+	// One table for each level, built when first used and not changed.
+	// A level that is not supported has the table of the CPU level.
+	static const ImageKernels* LevelKernels(SimdLevel level)
+	{
+		static const ImageKernels kernels[] = {
+			SelectKernels(SIMD_NONE), SelectKernels(SIMD_SSE2), SelectKernels(SIMD_AVX2),
+			SelectKernels(SIMD_AVX512), SelectKernels(SIMD_NEON)
+		};
+		if (level < SIMD_NONE || level > SIMD_NEON)
+			level = SIMD_NONE;
+		return &kernels[level];
+	}
+
+	// Table in use, selected from the CPU when first used.
+	// SetSimdLevel publishes a different table while other threads
+	// may be converting, so each function loads it once per call.
+	static std::atomic<const ImageKernels*>& CurrentKernels()
+	{
+		static std::atomic<const ImageKernels*> current(LevelKernels(GetCpuSimdLevel()));
+		return current;
+	}
+
+	static const ImageKernels& Kernels()
+	{
+		return *CurrentKernels().load(std::memory_order_acquire);
+	}
+
+	// Instruction set supported by this CPU
+	SimdLevel GetCpuSimdLevel()
+	{
+		static const SimdLevel cpulevel = DetectSimdLevel();
+		return cpulevel;
+	}
+
+	// Instruction set currently used by the image functions
+	SimdLevel GetSimdLevel()
+	{
+		return Kernels().level;
+	}
+
+	// Set the instruction set used by the image functions
+	void SetSimdLevel(SimdLevel level)
+	{
+		CurrentKernels().store(LevelKernels(level), std::memory_order_release);
+	}
+
+	// Instruction set name
+	std::string GetSimdName(SimdLevel level)
+	{
+		switch (level) {
+			case SIMD_SSE2:   return "SSE2";
+			case SIMD_AVX2:   return "AVX2";
+			case SIMD_AVX512: return "AVX-512";
+			case SIMD_NEON:   return "NEON";
+			case SIMD_NONE:
+			default:          return "None";
+		}
+	}
+
+	//
+	// Multi-threaded image functions
+	//
+	// A persistent pool of worker threads divides the image lines
+	// into horizontal stripes. The calling thread converts the first
+	// stripe and waits for the workers to finish the others.
+	//
+	// Stripe function arguments are the first and last+1 image line.
+	//
+	typedef std::function<void(unsigned int, unsigned int)> StripeFunction;
+
+#if defined(USE_THREADS)
+
+	// Maximum threads for the default thread count.
+	// Conversions are limited by memory bandwidth
+	// and more threads are not usually faster.
+	static const unsigned int MaxDefaultThreads = 4;
+
+	static std::atomic<unsigned int> ThreadCount(0); // 0 - not set yet
+	static std::atomic<unsigned int> ThreadMinimum(1920*1080);
+
+	class StripePool {
+
+	public:
+
+		~StripePool()
+		{
+			Stop();
+		}
+
+		// Convert lines 0 to nLines in nThreads stripes
+		// Returns false if the pool is in use by another thread
+		bool Run(unsigned int nLines, unsigned int nThreads, const StripeFunction& func)
+		{
+			std::unique_lock<std::mutex> runlock(m_RunMutex, std::try_to_lock);
+			if (!runlock.owns_lock())
+				return false;
+
+			if (m_Workers.size() != nThreads - 1) {
+				Stop();
+				Start(nThreads - 1);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Func = &func;
+				m_Lines = nLines;
+				m_Stripes = nThreads;
+				m_Pending = nThreads - 1;
+				m_Generation++;
+			}
+			m_StartCondition.notify_all();
+
+			// The calling thread converts the first stripe
+			func(0, StripeLine(1));
+
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_DoneCondition.wait(lock, [this] { return m_Pending == 0; });
+			m_Func = nullptr;
+
+			return true;
+		}
+
+	private:
+
+		void Start(unsigned int nWorkers)
+		{
+			m_bQuit = false;
+			for (unsigned int i = 0; i < nWorkers; i++)
+				m_Workers.push_back(std::thread(&StripePool::Worker, this, i + 1, m_Generation));
+		}
+
+		void Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_bQuit = true;
+			}
+			m_StartCondition.notify_all();
+			for (size_t i = 0; i < m_Workers.size(); i++) {
+				if (m_Workers[i].joinable())
+					m_Workers[i].join();
+			}
+			m_Workers.clear();
+		}
+
+		// First line of a stripe
+		unsigned int StripeLine(unsigned int stripe) const
+		{
+			return (unsigned int)(((uint64_t)m_Lines * stripe) / m_Stripes);
+		}
+
+		// Worker thread for one stripe
+		void Worker(unsigned int stripe, unsigned int generation)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			for (;;) {
+				m_StartCondition.wait(lock, [&] { return m_bQuit || m_Generation != generation; });
+				if (m_bQuit)
+					return;
+				generation = m_Generation;
+				const StripeFunction* func = m_Func;
+				unsigned int first = StripeLine(stripe);
+				unsigned int last = StripeLine(stripe + 1);
+				lock.unlock();
+
+				if (first < last)
+					(*func)(first, last);
+
+				lock.lock();
+				if (--m_Pending == 0)
+					m_DoneCondition.notify_one();
+			}
+		}
+
+		std::vector<std::thread> m_Workers;
+		std::mutex m_RunMutex; // One conversion at a time
+		std::mutex m_Mutex;
+		std::condition_variable m_StartCondition;
+		std::condition_variable m_DoneCondition;
+		const StripeFunction* m_Func = nullptr;
+		unsigned int m_Lines = 0;
+		unsigned int m_Stripes = 1;
+		unsigned int m_Pending = 0;
+		unsigned int m_Generation = 0;
+		bool m_bQuit = false;
+
+	};
+
+	static StripePool& Pool()
+	{
+		static StripePool pool;
+		return pool;
+	}
+
+	static unsigned int DefaultThreadCount()
+	{
+		unsigned int n = std::thread::hardware_concurrency();
+		if (n < 1) n = 1;
+		if (n > MaxDefaultThreads) n = MaxDefaultThreads;
+		return n;
+	}
+
+#endif // endif USE_THREADS
+
+	// Set the number of threads used by the image functions
+	void SetThreadCount(unsigned int nThreads)
+	{
+#if defined(USE_THREADS)
+		if (nThreads == 0)
+			nThreads = DefaultThreadCount();
+		ThreadCount = nThreads;
+#else
+		(void)nThreads;
+#endif
+	}
+
+	// Number of threads used by the image functions
+	unsigned int GetThreadCount()
+	{
+#if defined(USE_THREADS)
+		if (ThreadCount == 0)
+			ThreadCount = DefaultThreadCount();
+		return ThreadCount;
+#else
+		return 1;
+#endif
+	}
+
+	// Set the minimum image size for multi-threaded conversion
+	void SetThreadMinimum(unsigned int nPixels)
+	{
+#if defined(USE_THREADS)
+		ThreadMinimum = nPixels;
+#else
+		(void)nPixels;
+#endif
+	}
+
+	// Minimum image size for multi-threaded conversion
+	unsigned int GetThreadMinimum()
+	{
+#if defined(USE_THREADS)
+		return ThreadMinimum;
+#else
+		return 0;
+#endif
+	}
+
+	// Convert image lines in stripes if the image is large enough.
+	// Otherwise, or if the workers are busy with another image,
+	// convert all lines with the calling thread.
+	static void ConvertStripes(unsigned int width, unsigned int height, const StripeFunction& func)
+	{
+#if defined(USE_THREADS)
+		unsigned int nThreads = GetThreadCount();
+		if (nThreads > height) nThreads = height;
+		if (nThreads > 1 && (uint64_t)width * height >= ThreadMinimum) {
+			if (Pool().Run(height, nThreads, func))
+				return;
+		}
+#else
+		(void)width;
+#endif
+		func(0, height);
+	}
+
+	// Last level cache size from the operating system
+	static size_t DetectCacheSize()
+	{
+		size_t size = 0;
+#if defined(TARGET_WIN32)
+		DWORD length = 0;
+		GetLogicalProcessorInformation(nullptr, &length);
+		if (length > 0) {
+			std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+			if (GetLogicalProcessorInformation(info.data(), &length)) {
+				BYTE level = 0;
+				for (const auto& i : info) {
+					if (i.Relationship == RelationCache && i.Cache.Level >= level) {
+						level = i.Cache.Level;
+						size = (size_t)i.Cache.Size;
+					}
+				}
+			}
+		}
+#elif defined(TARGET_OSX) || defined(TARGET_OF_IOS)
+		uint64_t value = 0;
+		size_t len = sizeof(value);
+		if (sysctlbyname("hw.l3cachesize", &value, &len, nullptr, 0) != 0 || value == 0) {
+			len = sizeof(value);
+			if (sysctlbyname("hw.l2cachesize", &value, &len, nullptr, 0) != 0)
+				value = 0;
+		}
+		size = (size_t)value;
+#else
+		long value = 0;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+		value = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+		if (value <= 0)
+			value = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+		if (value > 0)
+			size = (size_t)value;
+#endif
+		// Not reported
+		if (size == 0)
+			size = 8 * 1024 * 1024;
+		return size;
+	}
+
+	// Last level cache size in bytes
+	size_t GetCacheSize()
+	{
+		static const size_t size = DetectCacheSize();
+		return size;
+	}
+
+	// Copy size for non-temporal stores
+	void SetStreamingThreshold(size_t bytes)
+	{
+		StreamingThreshold = bytes;
+	}
+
+	size_t GetStreamingThreshold()
+	{
+		const size_t bytes = StreamingThreshold;
+		return bytes ? bytes : GetCacheSize();
+	}
+
+	// Prefetch distance for non-temporal copies
+	void SetPrefetchDistance(unsigned int bytes)
+	{
+		PrefetchDistance = bytes;
+	}
+
+	unsigned int GetPrefetchDistance()
+	{
+		return PrefetchDistance;
+	}
+
+	//
+	//        CopyBuffer
+	//
+	// Copy memory of any size and source or destination alignment.
+	// Regular stores for sizes within the cache and non-temporal
+	// stores for larger sizes (see "Copy strategy").
+	//
+	void CopyBuffer(void* dst, const void* src, size_t size)
+	{
+		if (!dst || !src || size == 0)
+			return;
+		Kernels().copy(dst, src, size, size >= GetStreamingThreshold());
+	}
+
+	void* AlignedAlloc(size_t size, size_t alignment)
+	{
+		if (size == 0)
+			return nullptr;
+		if (alignment < sizeof(void*))
+			alignment = sizeof(void*);
+#if defined(TARGET_WIN32)
+		return _aligned_malloc(size, alignment);
+#else
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, alignment, size) != 0)
+			return nullptr;
+		return ptr;
+#endif
+	}
+
+	void AlignedFree(void* ptr)
+	{
+		if (!ptr)
+			return;
+#if defined(TARGET_WIN32)
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	// Copy or rgba <> bgra conversion of an image using the current kernels
+	// Source and destination lines can be padded
+	// Each line is copied, swapped and flipped in one pass
+	static void CopyLines(const unsigned char* source, unsigned char* dest,
+		unsigned int width, unsigned int height,
+		size_t sourcePitch, size_t destPitch,
+		bool bSwapRB, bool bInvert)
+	{
+		const ImageKernels& k = Kernels();
+		const size_t lineBytes = (size_t)width * 4;
+		// Non-temporal stores for frames larger than the cache
+		const bool bStream = (size_t)height * lineBytes >= GetStreamingThreshold();
+
+		// Contiguous lines are copied as one block for each stripe
+		if (!bSwapRB && !bInvert && sourcePitch == lineBytes && destPitch == lineBytes) {
+			ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+				k.copy(dest + (size_t)first * lineBytes, source + (size_t)first * lineBytes,
+					(size_t)(last - first) * lineBytes, bStream);
+			});
+			return;
+		}
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int y = first; y < last; y++) {
+				const unsigned char* src = source + (bInvert ? (size_t)(height - 1 - y) : (size_t)y) * sourcePitch;
+				unsigned char* dst = dest + (size_t)y * destPitch;
+				if (bSwapRB)
+					k.swap(reinterpret_cast<const uint32_t*>(src), reinterpret_cast<uint32_t*>(dst), width);
+				else
+					k.copy(dst, src, lineBytes, bStream);
+			}
+		});
+	}
+
+	// Without SSE
+	void rgba_bgra(const void *rgba_source, void *bgra_dest,
+		unsigned int width, unsigned int height, bool bInvert)
+	{
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+
+			for (unsigned int y = first; y < last; y++) {
+
+				// Start of buffer
+				auto source = static_cast<const uint32_t*>(rgba_source); // unsigned int = 4 bytes
+				auto dest = static_cast<uint32_t*>(bgra_dest);
+
+				// Cast first to avoid warning C26451: Arithmetic overflow
+				unsigned long H1YxW = (unsigned long)((height - 1 - y) * width);
+				unsigned long YxW = (unsigned long)(y * width);
+
+				// Increment to current line
+				if (bInvert) {
+					source += H1YxW;
+					dest += YxW; // dest is not inverted
+				}
+				else {
+					source += YxW;
+					dest += YxW;
+				}
+
+				for (unsigned int x = 0; x < width; x++) {
+					auto rgbapix = source[x];
+#if defined(TARGET_WIN32)
+					// _rotl is available
+					dest[x] = (_rotl(rgbapix, 16) & 0x00ff00ff) | (rgbapix & 0xff00ff00);
+#else
+					// _rotl replacement
+					dest[x] = (ROL(rgbapix, 16) & 0x00ff00ff) | (rgbapix & 0xff00ff00);
+#endif
+				}
+
+			}
+
+		});
+
+	} // end rgba_bgra
+
+
+	// Flip a buffer in place
+	void FlipBuffer(const unsigned char *src,
+		unsigned char *dst,
+		unsigned int width,
+		unsigned int height)
+	{
+		// RGBA default
+		CopyLines(src, dst, width, height, (size_t)width * 4, (size_t)width * 4, false, true);
+	} // end FlipBuffer
+
+	//
+	//        FlipVertical
+	//
+	// Flip an image vertically in place.
+	// Pairs of lines are exchanged through registers
+	// with no temporary buffer.
+	//
+	bool FlipVertical(void* buffer, unsigned int lineBytes, unsigned int height, unsigned int pitch)
+	{
+		if (!buffer)
+			return false;
+
+		if (pitch < lineBytes)
+			pitch = lineBytes;
+
+		unsigned char* image = static_cast<unsigned char*>(buffer);
+		const ImageKernels& k = Kernels();
+
+		// Stripes of line pairs. The image size is used for the thread minimum.
+		ConvertStripes(lineBytes / 2, height / 2, [&](unsigned int first, unsigned int last) {
+			for (unsigned int y = first; y < last; y++)
+				k.swaplines(image + (size_t)y * pitch, image + (size_t)(height - 1 - y) * pitch, lineBytes);
+		});
+
+		return true;
+	} // end FlipVertical
+
+	// ofxNDI version number string
+	// Major, minor, release
+	std::string GetVersion()
+	{
+		return ofxNDIversion;
+	}
+
+
+	// Copy rgba source image to dest.
+	// Images must be the same size with no line padding.
+	// Option flip image vertically (invert).
+	void CopyImage(const unsigned char *source, unsigned char *dest,
+		unsigned int width, unsigned int height, bool bInvert)
+	{
+		CopyImage(source, dest, width, height, width*4, width*4, false, bInvert);
+
+	} // end CopyImage
+
+	// Copy rgba source image to dest.
+	// Source line pitch, dest has no line padding.
+	// Option convert bgra<>rgba.
+	// Option flip image vertically (invert).
+	void CopyImage(const unsigned char *source, unsigned char *dest,
+		unsigned int width, unsigned int height, unsigned int stride,
+		bool bSwapRB, bool bInvert)
+	{
+		CopyImage(source, dest, width, height, stride, width*4, bSwapRB, bInvert);
+
+	} // end CopyImage
+
+
+	// Copy rgba image buffers line by line.
+	// Allow for both source and destination line pitch.
+	// Option flip image vertically (invert).
+	void CopyImage(const void* rgba_source, void* rgba_dest,
+		unsigned int width, unsigned int height,
+		unsigned int sourcePitch, unsigned int destPitch,
+		bool bInvert)
+	{
+		CopyImage(rgba_source, rgba_dest, width, height, sourcePitch, destPitch, false, bInvert);
+	}
+
+	//
+	//        CopyImage
+	//
+	// Copy rgba or bgra image buffers in a single pass.
+	// Allow for both source and destination line pitch.
+	// Option convert bgra<>rgba.
+	// Option flip image vertically (invert).
+	// A pitch less than width*4 is taken as width*4.
+	//
+	void CopyImage(const void* source, void* dest,
+		unsigned int width, unsigned int height,
+		unsigned int sourcePitch, unsigned int destPitch,
+		bool bSwapRB, bool bInvert)
+	{
+		if (!source || !dest)
+			return;
+
+		// Pitch is line length in bytes
+		if (sourcePitch < width * 4)
+			sourcePitch = width * 4;
+		if (destPitch < width * 4)
+			destPitch = width * 4;
+
+		CopyLines(static_cast<const unsigned char *>(source), static_cast<unsigned char *>(dest),
+			width, height, sourcePitch, destPitch, bSwapRB, bInvert);
+	} // end CopyImage
+
+	// Coefficients for YUV to RGBA or BGRA
+	static YUVcoefficients GetYUVcoefficients(unsigned int width, YUVcolorimetry colorimetry, bool bSwapRB)
+	{
+		YUVcoefficients c = YUVcoeffTable[MatrixIndex(colorimetry.matrix, width)][colorimetry.range == YUV_RANGE_FULL ? 1 : 0];
+		c.bgra = bSwapRB;
+		return c;
+	}
+
+	//
+	//        YUV422_to_RGBA
+	//
+	// Y sampled at every pixel
+	// U and V sampled at every second pixel 
+	// 2 pixels in 1 DWORD
+	//
+	// https://github.com/rzwm/YUVRGBFormulaGenerator
+	//
+	// BT.601 : 16-235 > 0-255
+	// R = 1.164384(Y - 16) + 1.596027(V - 128)
+	// G = 1.164384(Y - 16) - 0.391762(U - 128) - 0.812968(V - 128)
+	// B = 1.164384(Y - 16) + 2.017232(U - 128)
+	// R = (298(Y - 16) + 409(V - 128) + 127) / 256
+	// G = (298(Y - 16) - 100(U - 128) - 208(V - 128) + 127) / 256
+	// B = (298(Y - 16) + 516(U - 128) + 127) / 256
+	//
+	// BT.709 : 16-235 > 0-255
+	// R = 1.164384(Y - 16) + 1.792741(V - 128)
+	// G = 1.164384(Y - 16) - 0.213249(U - 128) - 0.532909(V - 128)
+	// B = 1.164384(Y - 16) + 2.112402(U - 128)
+	// R = (298(Y - 16) + 459(V - 128) + 127) / 256
+	// G = (298(Y - 16) - 55(U - 128) - 136(V - 128) + 127) / 256
+	// B = (298(Y - 16) + 541(U - 128) + 127) / 256
+	//
+	// BT.2020 and full range (0-255) coefficients are generated
+	// in the same way (see "Colorimetry tables").
+	//
+	// The matrix is selected once for the frame
+	// YUV_MATRIX_AUTO : SD (width < 1920) BT.601, HD BT.709
+	//
+	void YUV422_to_RGBA(const unsigned char * source, unsigned char * dest, unsigned int width, unsigned int height, unsigned int stride,
+		YUVcolorimetry colorimetry, bool bInvert)
+	{
+		if (!source || !dest)
+			return;
+
+		// Source line stride is at least 2 bytes per pixel
+		if (stride < width * 2)
+			stride = width * 2;
+
+		const YUVcoefficients c = GetYUVcoefficients(width, colorimetry, false);
+		const ImageKernels& k = Kernels();
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int y = first; y < last; y++) {
+				// Destination lines in reverse order to flip
+				const size_t line = bInvert ? (size_t)(height - 1 - y) : (size_t)y;
+				k.uyvy(source + (size_t)y * stride, dest + line * width * 4, width, c);
+			}
+		});
+	}  // end YUV422_to_RGBA
+
+	//
+	//        RGBA_to_YUV422
+	//
+	// RGBA or BGRA to YUV422 (UYVY)
+	// Y for every pixel, U and V averaged for every second pixel
+	// Optional alpha plane for UYVA
+	//
+	// BT.601 : 0-255 > 16-235
+	// Y = ( 66R + 129G +  25B + 128) / 256 + 16
+	// U = (-38R -  74G + 112B + 128) / 256 + 128
+	// V = (112R -  94G -  18B + 128) / 256 + 128
+	//
+	// BT.709 : 0-255 > 16-235
+	// Y = ( 47R + 157G +  16B + 128) / 256 + 16
+	// U = (-26R -  86G + 112B + 128) / 256 + 128
+	// V = (112R - 102G -  10B + 128) / 256 + 128
+	//
+	// BT.2020 and full range (0-255) coefficients are generated
+	// in the same way (see "Colorimetry tables").
+	//
+	void RGBA_to_YUV422(const unsigned char* source, unsigned char* dest, unsigned char* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch,
+		bool bSwapRB, bool bInvert, YUVcolorimetry colorimetry)
+	{
+		if (!source || !dest)
+			return;
+
+		if (sourcePitch < width * 4)
+			sourcePitch = width * 4;
+
+		RGBtoYUVcoefficients c = RGBcoeffTable[MatrixIndex(colorimetry.matrix, width)][colorimetry.range == YUV_RANGE_FULL ? 1 : 0];
+		if (bSwapRB)
+			c = SwapCoefficientsRB(c);
+		const ImageKernels& k = Kernels();
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int y = first; y < last; y++) {
+				const unsigned char* src = source + (bInvert ? (size_t)(height - 1 - y) : (size_t)y) * sourcePitch;
+				k.rgba_uyvy(src, dest + (size_t)y * width * 2,
+					alpha ? alpha + (size_t)y * width : nullptr, width, c);
+			}
+		});
+	} // end RGBA_to_YUV422
+
+	//
+	//        GetRGBtoYUVshaderCoefficients
+	//
+	// RGB to YUV coefficients for a shader, identical to those
+	// used by RGBA_to_YUV422 so that both paths give the same result.
+	// Rows for Y, U and V of (r, g, b, offset) with rgb 0-1 and results 0-1.
+	//   Y = dot(coeffs[0].rgb, rgb) + coeffs[0].w
+	//
+	void GetRGBtoYUVshaderCoefficients(YUVcolorimetry colorimetry, unsigned int width, float coeffs[12])
+	{
+		if (!coeffs)
+			return;
+		const RGBtoYUVcoefficients& c = RGBcoeffTable[MatrixIndex(colorimetry.matrix, width)][colorimetry.range == YUV_RANGE_FULL ? 1 : 0];
+		const float rows[12] = {
+			(float)c.yr, (float)c.yg, (float)c.yb, (float)c.yoffset*256.0f/255.0f,
+			(float)c.ur, (float)c.ug, (float)c.ub, 128.0f*256.0f/255.0f,
+			(float)c.vr, (float)c.vg, (float)c.vb, 128.0f*256.0f/255.0f };
+		for (int i = 0; i < 12; i++)
+			coeffs[i] = rows[i]/256.0f;
+	}
+
+	//
+	//        NV12_to_RGBA
+	//
+	// YUV 4:2:0 with a Y plane followed by an interleaved UV plane
+	// U and V sampled at every second pixel of every second line
+	// Equations as for YUV422_to_RGBA
+	//
+	void NV12_to_RGBA(const unsigned char* y, const unsigned char* uv, unsigned char* dest,
+		unsigned int width, unsigned int height, unsigned int yStride, unsigned int uvStride,
+		bool bSwapRB, bool bInvert, YUVcolorimetry colorimetry)
+	{
+		if (!y || !uv || !dest)
+			return;
+
+		const YUVcoefficients c = GetYUVcoefficients(width, colorimetry, bSwapRB);
+		const ImageKernels& k = Kernels();
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int line = first; line < last; line++) {
+				const size_t src = bInvert ? (size_t)(height - 1 - line) : (size_t)line;
+				const unsigned char* puv = uv + (src / 2) * uvStride;
+				k.yuv420(y + src * yStride, puv, puv + 1, 2, dest + (size_t)line * width * 4, width, c);
+			}
+		});
+	} // end NV12_to_RGBA
+
+	//
+	//        I420_to_RGBA
+	//
+	// YUV 4:2:0 with separate Y, U and V planes
+	// For YV12, exchange the U and V plane pointers
+	// Equations as for YUV422_to_RGBA
+	//
+	void I420_to_RGBA(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* dest,
+		unsigned int width, unsigned int height, unsigned int yStride, unsigned int uvStride,
+		bool bSwapRB, bool bInvert, YUVcolorimetry colorimetry)
+	{
+		if (!y || !u || !v || !dest)
+			return;
+
+		const YUVcoefficients c = GetYUVcoefficients(width, colorimetry, bSwapRB);
+		const ImageKernels& k = Kernels();
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int line = first; line < last; line++) {
+				const size_t src = bInvert ? (size_t)(height - 1 - line) : (size_t)line;
+				k.yuv420(y + src * yStride, u + (src / 2) * uvStride, v + (src / 2) * uvStride, 1,
+					dest + (size_t)line * width * 4, width, c);
+			}
+		});
+	} // end I420_to_RGBA
+
+	// Coefficients for 16 bit YUV
+	static P216coefficients GetP216coefficients(unsigned int width, YUVcolorimetry colorimetry)
+	{
+		const double* k = LumaWeights[MatrixIndex(colorimetry.matrix, width)];
+		return MakeP216coefficients((float)k[0], (float)k[1], colorimetry.range == YUV_RANGE_FULL);
+	}
+
+	// P216 or PA16 to float or 16 bit RGBA
+	static void P216_to_RGBA(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha,
+		void* dest, bool bFloat, unsigned int width, unsigned int height,
+		unsigned int stride, unsigned int destPitch, bool bInvert, YUVcolorimetry colorimetry)
+	{
+		if (!y || !uv || !dest)
+			return;
+
+		if (stride < width * 2)
+			stride = width * 2;
+		const unsigned int pixelsize = bFloat ? 4 * sizeof(float) : 4 * sizeof(uint16_t);
+		if (destPitch < width * pixelsize)
+			destPitch = width * pixelsize;
+
+		const P216coefficients c = GetP216coefficients(width, colorimetry);
+		const ImageKernels& k = Kernels();
+		const unsigned char* py = (const unsigned char*)y;
+		const unsigned char* puv = (const unsigned char*)uv;
+		const unsigned char* pa = (const unsigned char*)alpha;
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int line = first; line < last; line++) {
+				const size_t src = (bInvert ? (size_t)(height - 1 - line) : (size_t)line) * stride;
+				k.p216_rgba((const uint16_t*)(py + src), (const uint16_t*)(puv + src),
+					pa ? (const uint16_t*)(pa + src) : nullptr,
+					(unsigned char*)dest + (size_t)line * destPitch, bFloat, width, c);
+			}
+		});
+	}
+
+	// Float or 16 bit RGBA to P216 or PA16
+	static void RGBA_to_P216(const void* source, bool bFloat, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int stride,
+		bool bInvert, YUVcolorimetry colorimetry)
+	{
+		if (!source || !y || !uv)
+			return;
+
+		if (stride < width * 2)
+			stride = width * 2;
+		const unsigned int pixelsize = bFloat ? 4 * sizeof(float) : 4 * sizeof(uint16_t);
+		if (sourcePitch < width * pixelsize)
+			sourcePitch = width * pixelsize;
+
+		const P216coefficients c = GetP216coefficients(width, colorimetry);
+		const ImageKernels& k = Kernels();
+		unsigned char* py = (unsigned char*)y;
+		unsigned char* puv = (unsigned char*)uv;
+		unsigned char* pa = (unsigned char*)alpha;
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int line = first; line < last; line++) {
+				const size_t src = (bInvert ? (size_t)(height - 1 - line) : (size_t)line) * sourcePitch;
+				const size_t dst = (size_t)line * stride;
+				k.rgba_p216((const unsigned char*)source + src, bFloat,
+					(uint16_t*)(py + dst), (uint16_t*)(puv + dst),
+					pa ? (uint16_t*)(pa + dst) : nullptr, width, c);
+			}
+		});
+	}
+
+	//
+	//        P216_to_RGBA16
+	//
+	// 16 bit YUV 4:2:2 with a Y plane followed by an interleaved UV plane
+	// Optional alpha plane for PA16
+	// Equations as for the 16 bit YUV kernels
+	//
+	void P216_to_RGBA16(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha, uint16_t* dest,
+		unsigned int width, unsigned int height, unsigned int stride, unsigned int destPitch,
+		bool bInvert, YUVcolorimetry colorimetry)
+	{
+		P216_to_RGBA(y, uv, alpha, dest, false, width, height, stride, destPitch, bInvert, colorimetry);
+	}
+
+	//
+	//        P216_to_RGBAF
+	//
+	// As for P216_to_RGBA16 with float 0-1 output
+	//
+	void P216_to_RGBAF(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha, float* dest,
+		unsigned int width, unsigned int height, unsigned int stride, unsigned int destPitch,
+		bool bInvert, YUVcolorimetry colorimetry)
+	{
+		P216_to_RGBA(y, uv, alpha, dest, true, width, height, stride, destPitch, bInvert, colorimetry);
+	}
+
+	//
+	//        RGBA16_to_P216
+	//
+	// 16 bit RGBA to 16 bit YUV 4:2:2
+	// Y for every pixel, U and V averaged for every second pixel
+	// Optional alpha plane for PA16
+	//
+	void RGBA16_to_P216(const uint16_t* source, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int stride,
+		bool bInvert, YUVcolorimetry colorimetry)
+	{
+		RGBA_to_P216(source, false, y, uv, alpha, width, height, sourcePitch, stride, bInvert, colorimetry);
+	}
+
+	//
+	//        RGBAF_to_P216
+	//
+	// As for RGBA16_to_P216 with float 0-1 input
+	//
+	void RGBAF_to_P216(const float* source, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int stride,
+		bool bInvert, YUVcolorimetry colorimetry)
+	{
+		RGBA_to_P216(source, true, y, uv, alpha, width, height, sourcePitch, stride, bInvert, colorimetry);
+	}
+
+	//
+	//        RGBA_to_RGBA16
+	//
+	// 8 bit RGBA to 16 bit RGBA (0-255 > 0-65535)
+	//
+	void RGBA_to_RGBA16(const unsigned char* source, uint16_t* dest,
+		unsigned int width, unsigned int height, unsigned int destPitch)
+	{
+		if (!source || !dest)
+			return;
+
+		if (destPitch < width * 8)
+			destPitch = width * 8;
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int line = first; line < last; line++) {
+				const unsigned char* src = source + (size_t)line * width * 4;
+				uint16_t* dst = (uint16_t*)((unsigned char*)dest + (size_t)line * destPitch);
+				for (unsigned int i = 0; i < width * 4; i++)
+					dst[i] = (uint16_t)(src[i] * 257);
+			}
+		});
+	}
+
+	//
+	//        RGBA_to_RGBAF
+	//
+	// 8 bit RGBA to float RGBA (0-255 > 0-1)
+	//
+	void RGBA_to_RGBAF(const unsigned char* source, float* dest,
+		unsigned int width, unsigned int height, unsigned int destPitch)
+	{
+		if (!source || !dest)
+			return;
+
+		if (destPitch < width * 16)
+			destPitch = width * 16;
+
+		ConvertStripes(width, height, [&](unsigned int first, unsigned int last) {
+			for (unsigned int line = first; line < last; line++) {
+				const unsigned char* src = source + (size_t)line * width * 4;
+				float* dst = (float*)((unsigned char*)dest + (size_t)line * destPitch);
+				for (unsigned int i = 0; i < width * 4; i++)
+					dst[i] = (float)src[i] * (1.0f/255.0f);
+			}
+		});
+	}
+
+	// Source line for scaling functions
+	// Returns the rgba source line, converted in the scratch line if necessary
+	typedef std::function<const unsigned char*(unsigned int line, unsigned char* scratch)> ScaleLineFunction;
+
+	// Scale rgba lines from a source line function
+	// Box filter for exactly half or quarter size, otherwise bilinear.
+	// Only the destination is written to memory. Converted source
+	// lines use a small scratch buffer for each stripe.
+	static void ScaleLines(unsigned int sourceWidth, unsigned int sourceHeight,
+		unsigned char* dest, unsigned int destWidth, unsigned int destHeight,
+		bool bSwapRB, const ScaleLineFunction& getline)
+	{
+		const ImageKernels& k = Kernels();
+		const size_t lineBytes = (size_t)sourceWidth * 4;
+
+		unsigned int factor = 0;
+		if (destWidth == sourceWidth / 2 && destHeight == sourceHeight / 2)
+			factor = 2;
+		else if (destWidth == sourceWidth / 4 && destHeight == sourceHeight / 4)
+			factor = 4;
+
+		// Threads for the source pixels read for each stripe
+		const unsigned int lineRatio = (destHeight < sourceHeight) ? sourceHeight / destHeight : 1;
+
+		if (factor) {
+			ConvertStripes(sourceWidth * lineRatio, destHeight, [&](unsigned int first, unsigned int last) {
+				std::vector<unsigned char> scratch(lineBytes * factor);
+				const unsigned char* rows[4];
+				for (unsigned int y = first; y < last; y++) {
+					for (unsigned int r = 0; r < factor; r++)
+						rows[r] = getline(y * factor + r, scratch.data() + r * lineBytes);
+					unsigned char* dst = dest + (size_t)y * destWidth * 4;
+					k.box(rows, factor, dst, destWidth);
+					if (bSwapRB)
+						k.swap(reinterpret_cast<const uint32_t*>(dst), reinterpret_cast<uint32_t*>(dst), destWidth);
+				}
+			});
+			return;
+		}
+
+		// Bilinear
+		// Source position of destination pixel centres
+		// in 16.16 fixed point with 8 bit weights.
+		const int64_t xstep = ((int64_t)sourceWidth << 16) / destWidth;
+		const int64_t ystep = ((int64_t)sourceHeight << 16) / destHeight;
+		std::vector<unsigned int> xoffset(destWidth * 2);
+		std::vector<unsigned int> xweight(destWidth);
+		for (unsigned int x = 0; x < destWidth; x++) {
+			int64_t pos = xstep / 2 - 32768 + (int64_t)x * xstep;
+			if (pos < 0) pos = 0;
+			const unsigned int x0 = (unsigned int)(pos >> 16);
+			xoffset[x * 2] = x0 * 4;
+			xoffset[x * 2 + 1] = ((x0 + 1 < sourceWidth) ? x0 + 1 : x0) * 4;
+			xweight[x] = (unsigned int)(pos >> 8) & 255;
+		}
+
+		ConvertStripes(sourceWidth * lineRatio, destHeight, [&](unsigned int first, unsigned int last) {
+			// Two scratch lines for odd and even source lines
+			std::vector<unsigned char> scratch(lineBytes * 2);
+			const unsigned char* slot[2] = { nullptr, nullptr };
+			int64_t slotLine[2] = { -1, -1 };
+			auto fetch = [&](unsigned int line) {
+				const unsigned int s = line & 1;
+				if (slotLine[s] != (int64_t)line) {
+					slot[s] = getline(line, scratch.data() + s * lineBytes);
+					slotLine[s] = line;
+				}
+				return slot[s];
+			};
+			for (unsigned int y = first; y < last; y++) {
+				int64_t pos = ystep / 2 - 32768 + (int64_t)y * ystep;
+				if (pos < 0) pos = 0;
+				const unsigned int y0 = (unsigned int)(pos >> 16);
+				const unsigned int y1 = (y0 + 1 < sourceHeight) ? y0 + 1 : y0;
+				const unsigned int fy = (unsigned int)(pos >> 8) & 255;
+				const unsigned char* row0 = fetch(y0);
+				const unsigned char* row1 = fetch(y1);
+				unsigned char* dst = dest + (size_t)y * destWidth * 4;
+				for (unsigned int x = 0; x < destWidth; x++) {
+					const unsigned char* a = row0 + xoffset[x * 2];
+					const unsigned char* b = row0 + xoffset[x * 2 + 1];
+					const unsigned char* c = row1 + xoffset[x * 2];
+					const unsigned char* d = row1 + xoffset[x * 2 + 1];
+					const unsigned int fx = xweight[x];
+					for (unsigned int i = 0; i < 4; i++) {
+						const unsigned int top = a[i] * (256 - fx) + b[i] * fx;
+						const unsigned int bottom = c[i] * (256 - fx) + d[i] * fx;
+						dst[x * 4 + i] = (unsigned char)((top * (256 - fy) + bottom * fy + 32768) >> 16);
+					}
+				}
+				if (bSwapRB)
+					k.swap(reinterpret_cast<const uint32_t*>(dst), reinterpret_cast<uint32_t*>(dst), destWidth);
+			}
+		});
+	}
+
+	//
+	//        ScaleImage
+	//
+	// Scale an rgba or bgra image to rgba of a different size.
+	// Exactly half or quarter size (width/2 by height/2 or width/4 by height/4)
+	// uses a box filter with SIMD kernels. Other sizes are bilinear.
+	// The full size image is not copied.
+	//
+	void ScaleImage(const unsigned char* source, unsigned char* dest,
+		unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+		unsigned int destWidth, unsigned int destHeight, bool bSwapRB, bool bInvert)
+	{
+		if (!source || !dest || sourceWidth == 0 || sourceHeight == 0 || destWidth == 0 || destHeight == 0)
+			return;
+
+		if (sourcePitch < sourceWidth * 4)
+			sourcePitch = sourceWidth * 4;
+
+		ScaleLines(sourceWidth, sourceHeight, dest, destWidth, destHeight, bSwapRB,
+			[&](unsigned int line, unsigned char*) {
+				return source + (bInvert ? (size_t)(sourceHeight - 1 - line) : (size_t)line) * sourcePitch;
+			});
+	}
+
+	//
+	//        ScaleYUV422_to_RGBA
+	//
+	// Scale YUV422 (UYVY) to rgba of a different size.
+	// Filters as for ScaleImage. Each source line is converted
+	// to rgba in a scratch line that remains in cache and
+	// only the scaled image is written.
+	//
+	void ScaleYUV422_to_RGBA(const unsigned char* source, unsigned char* dest,
+		unsigned int sourceWidth, unsigned int sourceHeight, unsigned int stride,
+		unsigned int destWidth, unsigned int destHeight, bool bSwapRB, bool bInvert,
+		YUVcolorimetry colorimetry)
+	{
+		if (!source || !dest || sourceWidth == 0 || sourceHeight == 0 || destWidth == 0 || destHeight == 0)
+			return;
+
+		if (stride < sourceWidth * 2)
+			stride = sourceWidth * 2;
+
+		const YUVcoefficients c = GetYUVcoefficients(sourceWidth, colorimetry, bSwapRB);
+		const ImageKernels& k = Kernels();
+
+		ScaleLines(sourceWidth, sourceHeight, dest, destWidth, destHeight, false,
+			[&](unsigned int line, unsigned char* scratch) {
+				const size_t src = bInvert ? (size_t)(sourceHeight - 1 - line) : (size_t)line;
+				k.uyvy(source + src * stride, scratch, sourceWidth, c);
+				return (const unsigned char*)scratch;
+			});
+	}
+
+	//
+	//        Kernel verification
+	//
+	// Each image function is run with the C++ kernels (SIMD_NONE) and then
+	// with every other instruction set supported by the CPU. Copy, swap and
+	// flip results are also compared with a simple per pixel copy.
+	//
+	// Random images from 1x1 to 67x4 and HD, odd widths and single lines.
+	// Source and dest at offsets from 64 byte alignment, with and without
+	// line padding. Guard bytes after each dest detect writes past the end.
+	// Images are divided into stripes if more than one thread is in use.
+	// Copies are made with and without non-temporal stores.
+	//
+	// 8 and 16 bit results must be identical at every level.
+	// Float results must be within VerifyFloatTolerance.
+	//
+
+	// Bytes after the dest that must not be written
+	static const size_t VerifyGuard = 64;
+	static const unsigned char VerifyFill = 0xA5;
+	static const float VerifyFloatTolerance = 1.0f / 65535.0f;
+
+	// Memory at an offset from 64 byte alignment
+	// followed by the guard bytes
+	struct VerifyBuffer {
+		VerifyBuffer(size_t bytes, size_t offset) : memory(bytes + offset + 64 + VerifyGuard, VerifyFill) {
+			const uintptr_t p = (reinterpret_cast<uintptr_t>(memory.data()) + 63) & ~(uintptr_t)63;
+			data = reinterpret_cast<unsigned char*>(p) + offset;
+		}
+		std::vector<unsigned char> memory;
+		unsigned char* data;
+	};
+
+	// Function writing to the dest
+	typedef std::function<void(unsigned char* dest)> VerifyCall;
+
+	struct VerifyState {
+		std::vector<SimdLevel> levels; // Instruction sets compared with SIMD_NONE
+		unsigned int tests;
+		unsigned int failures;
+		bool bVerbose;
+		uint32_t seed; // Random image generator
+	};
+
+	static uint32_t VerifyRandom(uint32_t& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	// Dest and guard bytes after a function
+	// - init | dest content for in place functions (optional)
+	static std::vector<unsigned char> VerifyRun(const VerifyCall& call, size_t bytes, size_t offset, const unsigned char* init)
+	{
+		VerifyBuffer dest(bytes, offset);
+		if (init)
+			memcpy(dest.data, init, bytes);
+		call(dest.data);
+		return std::vector<unsigned char>(dest.data, dest.data + bytes + VerifyGuard);
+	}
+
+	// Byte offset of the first difference or bytes + guard if none
+	static size_t VerifyCompare(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b,
+		size_t bytes, bool bFloat)
+	{
+		size_t i = 0;
+		if (bFloat) {
+			for (; i + 4 <= bytes; i += 4) {
+				float fa, fb;
+				memcpy(&fa, &a[i], 4);
+				memcpy(&fb, &b[i], 4);
+				if (memcmp(&a[i], &b[i], 4) != 0 && !(std::fabs(fa - fb) <= VerifyFloatTolerance))
+					return i;
+			}
+		}
+		for (; i < a.size(); i++) {
+			if (a[i] != b[i])
+				return i;
+		}
+		return i;
+	}
+
+	static void VerifyFailed(VerifyState& s, const char* name, unsigned int width, unsigned int height,
+		SimdLevel level, const char* reason, size_t byte)
+	{
+		s.failures++;
+		if (s.bVerbose)
+			printf("VerifyKernels : %s %ux%u %s - %s at byte %u\n",
+				name, width, height, GetSimdName(level).c_str(), reason, (unsigned int)byte);
+	}
+
+	// Compare a function at all instruction sets
+	// - bytes | dest size written by the function
+	// - direct | per pixel result for comparison (optional)
+	static void VerifyLevels(VerifyState& s, const char* name, unsigned int width, unsigned int height,
+		size_t offset, size_t bytes, bool bFloat, const VerifyCall& call,
+		const VerifyCall& direct = nullptr, const unsigned char* init = nullptr)
+	{
+		s.tests++;
+		const size_t end = bytes + VerifyGuard;
+
+		SetSimdLevel(SIMD_NONE);
+		const std::vector<unsigned char> reference = VerifyRun(call, bytes, offset, init);
+		for (size_t i = bytes; i < end; i++) {
+			if (reference[i] != VerifyFill) {
+				VerifyFailed(s, name, width, height, SIMD_NONE, "write past the end", i);
+				return;
+			}
+		}
+
+		if (direct) {
+			const size_t diff = VerifyCompare(reference, VerifyRun(direct, bytes, offset, init), bytes, false);
+			if (diff < end) {
+				VerifyFailed(s, name, width, height, SIMD_NONE, "differs from direct copy", diff);
+				return;
+			}
+		}
+
+		for (SimdLevel level : s.levels) {
+			SetSimdLevel(level);
+			const size_t diff = VerifyCompare(reference, VerifyRun(call, bytes, offset, init), bytes, bFloat);
+			if (diff < end)
+				VerifyFailed(s, name, width, height, level, diff < bytes ? "differs from C++" : "write past the end", diff);
+		}
+	}
+
+	// All image functions for one image size
+	// - srcOffset, dstOffset | offsets from 64 byte alignment (multiple of 4)
+	// - pad | line padding in bytes (multiple of 4)
+	// - variant | selects colorimetry, swap and invert
+	static void VerifyImage(VerifyState& s, unsigned int width, unsigned int height,
+		size_t srcOffset, size_t dstOffset, unsigned int pad, unsigned int variant)
+	{
+		const unsigned int w = width;
+		const unsigned int h = height;
+		const unsigned int pairs = (w + 1) / 2;
+		const YUVcolorimetry colorimetry((YUVmatrix)(variant % 4), (YUVrange)((variant / 4) % 2));
+		const bool bSwapRB = (variant & 1) != 0;
+		const bool bInvert = (variant & 2) != 0;
+
+		// Random source for all formats
+		const unsigned int pitch = w * 4 + pad;
+		const size_t srcBytes = (size_t)(pairs * 16 + pad) * (h + 1) * 2;
+		VerifyBuffer source(srcBytes, srcOffset);
+		for (size_t i = 0; i < srcBytes; i++)
+			source.data[i] = (unsigned char)VerifyRandom(s.seed);
+		const unsigned char* src = source.data;
+
+		// Float rgba including values outside 0-1
+		VerifyBuffer fsource((size_t)pitch * 4 * h, srcOffset);
+		float* fsrc = reinterpret_cast<float*>(fsource.data);
+		for (size_t i = 0; i < (size_t)pitch * h; i++)
+			fsrc[i] = (float)((int)(VerifyRandom(s.seed) % 1200) - 100) / 1000.0f;
+
+		//
+		// Copy, swap and flip
+		//
+		const unsigned int dpitch = w * 4 + pad;
+		const size_t copyBytes = (size_t)dpitch * h;
+		for (int bStream = 0; bStream < 2; bStream++) {
+			StreamingThreshold = bStream ? 1 : SIZE_MAX;
+
+			const size_t size = (size_t)w * h * 4 + (w & 3);
+			VerifyLevels(s, "CopyBuffer", w, h, dstOffset, size, false,
+				[&](unsigned char* dst) { CopyBuffer(dst, src, size); },
+				[&](unsigned char* dst) { memcpy(dst, src, size); });
+
+			for (int swap = 0; swap < 2; swap++) {
+				for (int invert = 0; invert < 2; invert++) {
+					VerifyLevels(s, "CopyImage", w, h, dstOffset, copyBytes, false,
+						[&](unsigned char* dst) { CopyImage(src, dst, w, h, pitch, dpitch, swap != 0, invert != 0); },
+						[&](unsigned char* dst) {
+							for (unsigned int y = 0; y < h; y++) {
+								const unsigned char* s0 = src + (size_t)(invert ? h - 1 - y : y) * pitch;
+								unsigned char* d0 = dst + (size_t)y * dpitch;
+								for (unsigned int x = 0; x < w * 4; x += 4) {
+									d0[x + 0] = s0[x + (swap ? 2 : 0)];
+									d0[x + 1] = s0[x + 1];
+									d0[x + 2] = s0[x + (swap ? 0 : 2)];
+									d0[x + 3] = s0[x + 3];
+								}
+							}
+						});
+				}
+			}
+		}
+		StreamingThreshold = 0;
+
+		VerifyLevels(s, "FlipVertical", w, h, dstOffset, (size_t)pitch * h, false,
+			[&](unsigned char* dst) { FlipVertical(dst, w * 4, h, pitch); },
+			[&](unsigned char* dst) {
+				for (unsigned int y = 0; y < h; y++)
+					memcpy(dst + (size_t)y * pitch, src + (size_t)(h - 1 - y) * pitch, (size_t)w * 4);
+			}, src);
+
+		VerifyLevels(s, "rgba_bgra", w, h, dstOffset, (size_t)w * h * 4, false,
+			[&](unsigned char* dst) { rgba_bgra(src, dst, w, h, bInvert); },
+			[&](unsigned char* dst) { CopyImage(src, dst, w, h, w * 4, w * 4, true, bInvert); });
+
+#if defined(USE_SSE2)
+		VerifyLevels(s, "rgba_bgra_sse2", w, h, dstOffset, (size_t)w * h * 4, false,
+			[&](unsigned char* dst) { rgba_bgra_sse2(src, dst, w, h, bInvert); },
+			[&](unsigned char* dst) { CopyImage(src, dst, w, h, w * 4, w * 4, true, bInvert); });
+
+		VerifyLevels(s, "memcpy_movsd", w, h, dstOffset, (size_t)w * h * 4 + (w & 3), false,
+			[&](unsigned char* dst) { memcpy_movsd(dst, src, (size_t)w * h * 4 + (w & 3)); },
+			[&](unsigned char* dst) { memcpy(dst, src, (size_t)w * h * 4 + (w & 3)); });
+#endif
+
+		VerifyLevels(s, "FlipBuffer", w, h, dstOffset, (size_t)w * h * 4, false,
+			[&](unsigned char* dst) { FlipBuffer(src, dst, w, h); },
+			[&](unsigned char* dst) {
+				for (unsigned int y = 0; y < h; y++)
+					memcpy(dst + (size_t)y * w * 4, src + (size_t)(h - 1 - y) * w * 4, (size_t)w * 4);
+			});
+
+		//
+		// YUV to RGBA
+		//
+		const size_t rgbaBytes = (size_t)w * h * 4;
+		const unsigned int stride = pairs * 4 + pad;
+		VerifyLevels(s, "YUV422_to_RGBA", w, h, dstOffset, rgbaBytes, false,
+			[&](unsigned char* dst) { YUV422_to_RGBA(src, dst, w, h, stride, colorimetry); });
+		VerifyLevels(s, "YUV422_to_RGBA invert", w, h, dstOffset, rgbaBytes, false,
+			[&](unsigned char* dst) { YUV422_to_RGBA(src, dst, w, h, stride, colorimetry, true); },
+			[&](unsigned char* dst) {
+				std::vector<unsigned char> rgba(rgbaBytes);
+				YUV422_to_RGBA(src, rgba.data(), w, h, stride, colorimetry);
+				for (unsigned int y = 0; y < h; y++)
+					memcpy(dst + (size_t)y * w * 4, rgba.data() + (size_t)(h - 1 - y) * w * 4, (size_t)w * 4);
+			});
+
+		const unsigned int ystride = pairs * 2 + pad;
+		const unsigned int uvstride = pairs + pad;
+		const unsigned char* uv = src + (size_t)ystride * h;
+		const unsigned char* v = uv + (size_t)uvstride * ((h + 1) / 2);
+		VerifyLevels(s, "NV12_to_RGBA", w, h, dstOffset, rgbaBytes, false,
+			[&](unsigned char* dst) { NV12_to_RGBA(src, uv, dst, w, h, ystride, ystride, bSwapRB, bInvert, colorimetry); });
+		VerifyLevels(s, "I420_to_RGBA", w, h, dstOffset, rgbaBytes, false,
+			[&](unsigned char* dst) { I420_to_RGBA(src, uv, v, dst, w, h, ystride, uvstride, bSwapRB, bInvert, colorimetry); });
+
+		//
+		// RGBA to UYVY and UYVA
+		//
+		const size_t yuvBytes = (size_t)w * 2 * h;
+		VerifyLevels(s, "RGBA_to_YUV422", w, h, dstOffset, yuvBytes, false,
+			[&](unsigned char* dst) { RGBA_to_YUV422(src, dst, nullptr, w, h, pitch, bSwapRB, bInvert, colorimetry); });
+		VerifyLevels(s, "RGBA_to_YUV422 alpha", w, h, dstOffset, yuvBytes + (size_t)w * h, false,
+			[&](unsigned char* dst) { RGBA_to_YUV422(src, dst, dst + yuvBytes, w, h, pitch, bSwapRB, bInvert, colorimetry); });
+
+		//
+		// P216 and PA16
+		//
+		const unsigned int pstride = pairs * 4 + pad; // Y, UV and alpha planes
+		const size_t planeBytes = (size_t)pstride * h;
+		const uint16_t* py = reinterpret_cast<const uint16_t*>(src);
+		const uint16_t* puv = reinterpret_cast<const uint16_t*>(src + planeBytes);
+		const uint16_t* pa = reinterpret_cast<const uint16_t*>(src + planeBytes * 2);
+		const unsigned int pitch16 = w * 8 + pad;
+		const unsigned int pitchf = w * 16 + pad;
+		for (int alpha = 0; alpha < 2; alpha++) {
+			VerifyLevels(s, "P216_to_RGBA16", w, h, dstOffset, (size_t)pitch16 * h, false,
+				[&](unsigned char* dst) {
+					P216_to_RGBA16(py, puv, alpha ? pa : nullptr, (uint16_t*)dst, w, h, pstride, pitch16, bInvert, colorimetry); });
+			VerifyLevels(s, "P216_to_RGBAF", w, h, dstOffset, (size_t)pitchf * h, true,
+				[&](unsigned char* dst) {
+					P216_to_RGBAF(py, puv, alpha ? pa : nullptr, (float*)dst, w, h, pstride, pitchf, bInvert, colorimetry); });
+			VerifyLevels(s, "RGBA16_to_P216", w, h, dstOffset, planeBytes * 3, false,
+				[&](unsigned char* dst) {
+					RGBA16_to_P216((const uint16_t*)src, (uint16_t*)dst, (uint16_t*)(dst + planeBytes),
+						alpha ? (uint16_t*)(dst + planeBytes * 2) : nullptr, w, h, pitch16, pstride, bInvert, colorimetry); });
+			VerifyLevels(s, "RGBAF_to_P216", w, h, dstOffset, planeBytes * 3, false,
+				[&](unsigned char* dst) {
+					RGBAF_to_P216(fsrc, (uint16_t*)dst, (uint16_t*)(dst + planeBytes),
+						alpha ? (uint16_t*)(dst + planeBytes * 2) : nullptr, w, h, pitchf, pstride, bInvert, colorimetry); });
+		}
+
+		//
+		// Scaling with box filter and bilinear
+		//
+		const unsigned int scales[3][2] = { { w / 2, h / 2 }, { w / 4, h / 4 }, { w * 2 / 3 + 1, h * 2 / 3 + 1 } };
+		for (const auto& scale : scales) {
+			const unsigned int dw = scale[0];
+			const unsigned int dh = scale[1];
+			if (dw == 0 || dh == 0)
+				continue;
+			VerifyLevels(s, "ScaleImage", w, h, dstOffset, (size_t)dw * dh * 4, false,
+				[&](unsigned char* dst) { ScaleImage(src, dst, w, h, pitch, dw, dh, bSwapRB, bInvert); });
+			VerifyLevels(s, "ScaleYUV422_to_RGBA", w, h, dstOffset, (size_t)dw * dh * 4, false,
+				[&](unsigned char* dst) { ScaleYUV422_to_RGBA(src, dst, w, h, stride, dw, dh, bSwapRB, bInvert, colorimetry); });
+		}
+	}
+
+	// Audio conversion of all formats and layouts
+	// Reported as samples x channels. Dither is not compared
+	// because compilers may fuse the C++ multiply and add.
+	static void VerifyAudio(VerifyState& s, unsigned int samples, unsigned int channels, size_t offset)
+	{
+		const int n = (int)samples;
+		const int nc = (int)channels;
+		const size_t count = (size_t)samples * channels;
+
+		// Float source including values outside -1 to 1 to clamp
+		VerifyBuffer source(count * 4, offset);
+		float* fsrc = reinterpret_cast<float*>(source.data);
+		for (size_t i = 0; i < count; i++)
+			fsrc[i] = (float)((int)(VerifyRandom(s.seed) % 2400) - 1200) / 1000.0f;
+		// Integer source of random bits
+		VerifyBuffer isource(count * 4, offset);
+		for (size_t i = 0; i < count * 4; i++)
+			isource.data[i] = (unsigned char)VerifyRandom(s.seed);
+
+		static const char* names[3] = { "ConvertAudio float", "ConvertAudio int16", "ConvertAudio int32" };
+		static const float gains[2] = { 1.0f, 0.7f };
+		for (int from = AUDIO_FLOAT; from <= AUDIO_INT32; from++) {
+			const void* src = (from == AUDIO_FLOAT) ? (const void*)source.data : (const void*)isource.data;
+			for (int to = AUDIO_FLOAT; to <= AUDIO_INT32; to++) {
+				const size_t bytes = count * ((to == AUDIO_INT16) ? 2 : 4);
+				for (int layout = 0; layout < 4; layout++) {
+					const bool bSrcInterleaved = (layout & 1) != 0;
+					const bool bDstInterleaved = (layout & 2) != 0;
+					const float gain = gains[(layout + to) % 2];
+					VerifyLevels(s, names[from], samples, channels, offset, bytes, to == AUDIO_FLOAT,
+						[&](unsigned char* dst) {
+							ConvertAudio(src, (AudioFormat)from, bSrcInterleaved, 0,
+								dst, (AudioFormat)to, bDstInterleaved, 0, n, nc, gain); });
+				}
+			}
+		}
+
+		VerifyLevels(s, "AudioGain", samples, channels, offset, count * 4, true,
+			[&](unsigned char* dst) { AudioGain((float*)dst, count, 0.5f); },
+			nullptr, source.data);
+	}
+
+	//
+	//        VerifyKernels
+	//
+	// Compare all instruction sets with the C++ kernels.
+	// The instruction set, streaming threshold and thread minimum
+	// are restored when finished.
+	//
+	bool VerifyKernels(bool bVerbose)
+	{
+		VerifyState s;
+		s.tests = 0;
+		s.failures = 0;
+		s.bVerbose = bVerbose;
+		s.seed = 1;
+		for (int i = SIMD_SSE2; i <= SIMD_NEON; i++) {
+			if (IsSimdSupported((SimdLevel)i))
+				s.levels.push_back((SimdLevel)i);
+		}
+
+		const SimdLevel level = GetSimdLevel();
+		const size_t threshold = StreamingThreshold;
+		const unsigned int minimum = GetThreadMinimum();
+		SetThreadMinimum(0);
+
+		static const unsigned int widths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 67 };
+		static const unsigned int heights[] = { 1, 2, 3, 4 };
+		// Source offset, dest offset and line padding
+		static const unsigned int layouts[3][3] = { { 0, 0, 0 }, { 4, 36, 12 }, { 36, 12, 44 } };
+		unsigned int variant = 0;
+		for (unsigned int w : widths) {
+			for (unsigned int h : heights) {
+				for (const auto& layout : layouts)
+					VerifyImage(s, w, h, layout[0], layout[1], layout[2], variant++);
+			}
+		}
+		// HD including odd width
+		VerifyImage(s, 1920, 1080, 0, 0, 0, variant++);
+		VerifyImage(s, 1279, 721, 4, 36, 12, variant++);
+
+		// Audio blocks and partial blocks
+		static const unsigned int samples[] = { 1, 3, 4, 7, 8, 9, 17, 127, 128, 129, 1602 };
+		static const unsigned int channels[] = { 1, 2, 3, 6, 16 };
+		for (unsigned int n : samples) {
+			for (unsigned int c : channels)
+				VerifyAudio(s, n, c, (n & 1) ? 4 : 0);
+		}
+
+		SetSimdLevel(level);
+		StreamingThreshold = threshold;
+		SetThreadMinimum(minimum);
+
+		if (bVerbose)
+			printf("VerifyKernels : %u tests at %u instruction sets, %u failed\n",
+				s.tests, (unsigned int)s.levels.size() + 1, s.failures);
+
+		return (s.failures == 0);
+	}
+
+	//
+	// Time of frames at N/D frames per second in 100ns units
+	//
+	// frames*D/N seconds is split into whole seconds and the
+	// remainder so that the products do not overflow.
+	// Rounded down to 100ns.
+	//
+	int64_t FramesToTime(uint64_t frames, int rate_N, int rate_D)
+	{
+		if (rate_N <= 0 || rate_D <= 0)
+			return 0;
+		const uint64_t n = (uint64_t)rate_N;
+		const uint64_t units = frames * (uint64_t)rate_D;
+		return (int64_t)((units / n) * 10000000 + (units % n) * 10000000 / n);
+	}
+
+#ifdef USE_CHRONO
+	// Timing functions
+	void StartTiming() {
+		start = std::chrono::steady_clock::now();
+	}
+
+	double EndTiming() {
+		end = std::chrono::steady_clock::now();
+		double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+		// printf("    elapsed [%6.2f] msec\n", elapsed / 1000.0);
+		// printf("elapsed [%.3f] u/sec\n", elapsed);
+		return elapsed / 1000.0; // msec
+	}
+
+	// -----------------------------------------------
+	// Function: HoldFps
+	// Frame rate control
+	//
+	// Hold a desired frame rate if the application does not already
+	// have frame rate control. Must be called every frame.
+	//
+	// A single FramePacer is shared by all callers.
+	// For more than one sender or loop, use a FramePacer for each.
+	//
+	void HoldFps(int fps)
+	{
+		// Unlikely but return anyway
+		if (fps <= 0)
+			return;
+
+		static FramePacer pacer;
+		pacer.SetRate(fps, 1);
+		pacer.Wait();
+	}
+
+	// -----------------------------------------------
+	// Class: FramePacer
+	//
+	// Frame n of the schedule is due at m_Start + n*D/N seconds.
+	//
+	// Sleep precision depends on the system. Windows sleeps are
+	// rounded up to the timer period (15.6 msec by default), so the
+	// period is reduced to 1 msec while sleeping. The last part of
+	// the wait (spin time) yields to other threads until the deadline.
+	//
+	// Note that Windows timer resolution is affected by changes
+	// since Windows 10 Version 2004 (April 2020)
+	// https://randomascii.wordpress.com/2020/10/04/windows-timer-resolution-the-great-rule-change/
+	//
+	FramePacer::FramePacer(int rate_N, int rate_D)
+	{
+		m_rate_N = 60000;
+		m_rate_D = 1000;
+		m_SpinTime = 2000;
+		m_bStarted = false;
+		m_Frame = 0;
+		m_Frames = 0;
+		m_Missed = 0;
+		SetRate(rate_N, rate_D);
+	}
+
+	void FramePacer::SetRate(int rate_N, int rate_D)
+	{
+		if (rate_N <= 0 || rate_D <= 0)
+			return;
+		if (rate_N != m_rate_N || rate_D != m_rate_D) {
+			m_rate_N = rate_N;
+			m_rate_D = rate_D;
+			m_bStarted = false;
+		}
+	}
+
+	void FramePacer::GetRate(int &rate_N, int &rate_D) const
+	{
+		rate_N = m_rate_N;
+		rate_D = m_rate_D;
+	}
+
+	void FramePacer::SetSpinTime(unsigned int usec)
+	{
+		m_SpinTime = usec;
+	}
+
+	unsigned int FramePacer::GetSpinTime() const
+	{
+		return m_SpinTime;
+	}
+
+	void FramePacer::Reset()
+	{
+		m_bStarted = false;
+	}
+
+	uint64_t FramePacer::GetFrameCount() const
+	{
+		return m_Frames;
+	}
+
+	uint64_t FramePacer::GetMissedCount() const
+	{
+		return m_Missed;
+	}
+
+	// Time from frame 0 to the frame, exact to the nanosecond
+	// Whole seconds and remainder avoid overflow for long schedules
+	std::chrono::steady_clock::duration FramePacer::FrameTime(uint64_t frame) const
+	{
+		const uint64_t ticks = frame * (uint64_t)m_rate_D; // seconds * N
+		const uint64_t N = (uint64_t)m_rate_N;
+		const uint64_t nsec = (ticks / N) * 1000000000ULL + ((ticks % N) * 1000000000ULL) / N;
+		return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(nsec));
+	}
+
+	bool FramePacer::Wait()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		m_Frames++;
+
+		if (!m_bStarted) {
+			m_Start = now;
+			m_Frame = 0;
+			m_bStarted = true;
+			return true;
+		}
+
+		m_Frame++;
+		const std::chrono::steady_clock::time_point deadline = m_Start + FrameTime(m_Frame);
+		if (now >= deadline) {
+			m_Missed++;
+			// More than a frame late, restart from now
+			if (now - deadline > FrameTime(1)) {
+				m_Start = now;
+				m_Frame = 0;
+			}
+			return false;
+		}
+
+		// Sleep until the spin time before the deadline
+		const std::chrono::steady_clock::time_point wake = deadline - std::chrono::microseconds(m_SpinTime);
+		if (now < wake) {
+#if defined(TARGET_WIN32)
+			timeBeginPeriod(1);
+#endif
+			std::this_thread::sleep_until(wake);
+#if defined(TARGET_WIN32)
+			timeEndPeriod(1);
+#endif
+		}
+
+		// Yield until the deadline
+		while (std::chrono::steady_clock::now() < deadline)
+			std::this_thread::yield();
+
+		return true;
+	}
+
+#if defined(TARGET_WIN32)
+	// -----------------------------------------------
+	// Reduce Windows timing period to the minimum
+	// supported by the system (usually 1 msec)
+	void StartTimePeriod()
+	{
+		TIMECAPS tc={};
+		PeriodMin = 0; // To allow for errors
+		MMRESULT mres = timeGetDevCaps(&tc, sizeof(TIMECAPS));
+		if (mres == MMSYSERR_NOERROR) {
+			mres = timeBeginPeriod(tc.wPeriodMin);
+			if (mres == TIMERR_NOERROR)
+				PeriodMin = tc.wPeriodMin;
+		}
+	}
+
+
+	// -----------------------------------------------
+	// Reset Windows timing period
+	void EndTimePeriod()
+	{
+		if (PeriodMin > 0) {
+			timeEndPeriod(PeriodMin);
+			PeriodMin = 0;
+		}
+	}
+#endif
+
+#endif
+
+	//
+	// Stage timing
+	//
+	// Each thread records into its own histograms, so recording takes no
+	// lock and there is no contention between threads. Counts are atomic
+	// and only written by the owning thread. A snapshot adds together the
+	// histograms of all threads. Histograms of threads that have finished
+	// are kept so that their results remain.
+	//
+	// Durations in nanoseconds are binned by power of two with 8 sub-bins
+	// for each, so that the bin middle is within 1/16 of any value in it.
+	//
+#if defined(USE_STAGE_TIMING)
+
+	static const unsigned int MaxStages = 32;
+	static const unsigned int TimingBins = 16 + 32 * 8; // To 2^36 nsec (68 sec)
+
+	struct ThreadTimings {
+		std::atomic<uint32_t> bins[MaxStages][TimingBins];
+		std::atomic<uint64_t> total[MaxStages]; // nsec
+		std::atomic<uint64_t> max[MaxStages]; // nsec
+	};
+
+	// Registered stage names and the histograms of each thread
+	struct TimingRegistry {
+		std::mutex mutex;
+		std::vector<std::string> names;
+		std::vector<ThreadTimings*> threads;
+	};
+
+	static TimingRegistry& Timings()
+	{
+		static TimingRegistry registry;
+		return registry;
+	}
+
+	static unsigned int TimingBin(uint64_t nsec)
+	{
+		if (nsec < 16)
+			return (unsigned int)nsec;
+		if (nsec >> 36)
+			return TimingBins - 1;
+		unsigned int e = 4; // Highest bit
+		while (nsec >> (e + 1))
+			e++;
+		return 16 + (e - 4) * 8 + (unsigned int)((nsec >> (e - 3)) & 7);
+	}
+
+	// Middle of the bin in nsec
+	static double TimingBinValue(unsigned int bin)
+	{
+		if (bin < 16)
+			return (double)bin;
+		const unsigned int e = 4 + (bin - 16) / 8;
+		const double width = (double)(1ULL << (e - 3));
+		return (double)(8 + (bin - 16) % 8) * width + width / 2.0;
+	}
+
+	int RegisterStage(const char* name)
+	{
+		if (!name)
+			return -1;
+		TimingRegistry& r = Timings();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (size_t i = 0; i < r.names.size(); i++) {
+			if (r.names[i] == name)
+				return (int)i;
+		}
+		if (r.names.size() >= MaxStages)
+			return -1;
+		r.names.push_back(name);
+		return (int)r.names.size() - 1;
+	}
+
+	void RecordStage(int stage, uint64_t nsec)
+	{
+		if (stage < 0 || stage >= (int)MaxStages)
+			return;
+
+		// Histograms of this thread, created on first use
+		static thread_local ThreadTimings* t = nullptr;
+		if (!t) {
+			t = new ThreadTimings(); // zero initialized
+			TimingRegistry& r = Timings();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.threads.push_back(t);
+		}
+
+		// Only this thread writes, so load and store do not need a locked add
+		std::atomic<uint32_t>& bin = t->bins[stage][TimingBin(nsec)];
+		bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		t->total[stage].store(t->total[stage].load(std::memory_order_relaxed) + nsec, std::memory_order_relaxed);
+		if (nsec > t->max[stage].load(std::memory_order_relaxed))
+			t->max[stage].store(nsec, std::memory_order_relaxed);
+	}
+
+	std::vector<StageTiming> GetStageTimings()
+	{
+		std::vector<StageTiming> timings;
+		TimingRegistry& r = Timings();
+		std::lock_guard<std::mutex> lock(r.mutex);
+
+		std::vector<uint64_t> bins(TimingBins);
+		for (size_t stage = 0; stage < r.names.size(); stage++) {
+			uint64_t count = 0;
+			uint64_t total = 0;
+			uint64_t max = 0;
+			std::fill(bins.begin(), bins.end(), 0);
+			for (ThreadTimings* t : r.threads) {
+				for (unsigned int i = 0; i < TimingBins; i++) {
+					const uint32_t n = t->bins[stage][i].load(std::memory_order_relaxed);
+					bins[i] += n;
+					count += n;
+				}
+				total += t->total[stage].load(std::memory_order_relaxed);
+				max = std::max(max, t->max[stage].load(std::memory_order_relaxed));
+			}
+			if (count == 0)
+				continue;
+
+			// Bin of the sample at each percentile
+			double percentile[2] = { 0.0, 0.0 };
+			const uint64_t rank[2] = { (count + 1) / 2, count - count / 100 };
+			for (int p = 0; p < 2; p++) {
+				uint64_t sum = 0;
+				for (unsigned int i = 0; i < TimingBins; i++) {
+					sum += bins[i];
+					if (sum >= rank[p]) {
+						percentile[p] = std::min(TimingBinValue(i), (double)max);
+						break;
+					}
+				}
+			}
+
+			StageTiming timing;
+			timing.name = r.names[stage];
+			timing.count = count;
+			timing.mean = (double)total / (double)count / 1000000.0;
+			timing.p50 = percentile[0] / 1000000.0;
+			timing.p99 = percentile[1] / 1000000.0;
+			timing.max = (double)max / 1000000.0;
+			timings.push_back(timing);
+		}
+		return timings;
+	}
+
+	void ResetStageTimings()
+	{
+		TimingRegistry& r = Timings();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (ThreadTimings* t : r.threads) {
+			for (unsigned int stage = 0; stage < MaxStages; stage++) {
+				for (unsigned int i = 0; i < TimingBins; i++)
+					t->bins[stage][i].store(0, std::memory_order_relaxed);
+				t->total[stage].store(0, std::memory_order_relaxed);
+				t->max[stage].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+#else
+
+	std::vector<StageTiming> GetStageTimings()
+	{
+		return std::vector<StageTiming>();
+	}
+
+	void ResetStageTimings()
+	{
+	}
+
+#endif
+
+	//
+	// Audio sample conversion
+	//
+
+	// Samples per channel converted at once
+	// Float and integer blocks of 16 channels are 16k bytes
+	static const int AudioBlock = 128;
+
+	// Dither generators are seeded differently for each call
+	static std::atomic<uint32_t> AudioDitherCalls(0);
+
+	static size_t AudioSampleSize(AudioFormat format)
+	{
+		return (format == AUDIO_INT16) ? 2 : 4;
+	}
+
+	// Integer full scale
+	static float AudioScale(AudioFormat format)
+	{
+		if (format == AUDIO_INT16) return 32768.0f;
+		if (format == AUDIO_INT32) return 2147483648.0f;
+		return 1.0f;
+	}
+
+	static void AudioDitherSeed(uint32_t* state, uint32_t seed)
+	{
+		for (int i = 0; i < 4; i++) {
+			// Integer hash, never zero for xorshift
+			uint32_t x = seed + (uint32_t)i * 0x9E3779B9u;
+			x ^= x >> 16;
+			x *= 0x7FEB352Du;
+			x ^= x >> 15;
+			x *= 0x846CA68Bu;
+			x ^= x >> 16;
+			state[i] = x ? x : 1;
+		}
+	}
+
+	template <typename T>
+	static void InterleaveSamples(const T* const* planes, T* dest, size_t n, int channels)
+	{
+		for (size_t i = 0; i < n; i++) {
+			for (int c = 0; c < channels; c++)
+				dest[i * channels + c] = planes[c][i];
+		}
+	}
+
+	template <typename T>
+	static void DeinterleaveSamples(const T* source, T* const* planes, size_t n, int channels)
+	{
+		for (size_t i = 0; i < n; i++) {
+			for (int c = 0; c < channels; c++)
+				planes[c][i] = source[i * channels + c];
+		}
+	}
+
+	// Planar block to interleaved samples of 2 or 4 bytes
+	static void InterleaveBlock(const ImageKernels& k, const void* const* planes, void* dest,
+		size_t n, int channels, size_t sampleSize)
+	{
+		if (channels == 1)
+			memcpy(dest, planes[0], n * sampleSize);
+		else if (channels == 2 && sampleSize == 2)
+			k.interleave2_16((const uint16_t*)planes[0], (const uint16_t*)planes[1], (uint16_t*)dest, n);
+		else if (channels == 2)
+			k.interleave2_32((const uint32_t*)planes[0], (const uint32_t*)planes[1], (uint32_t*)dest, n);
+		else if (sampleSize == 2)
+			InterleaveSamples((const uint16_t* const*)planes, (uint16_t*)dest, n, channels);
+		else
+			InterleaveSamples((const uint32_t* const*)planes, (uint32_t*)dest, n, channels);
+	}
+
+	// Interleaved samples of 2 or 4 bytes to a planar block
+	static void DeinterleaveBlock(const ImageKernels& k, const void* source, void* const* planes,
+		size_t n, int channels, size_t sampleSize)
+	{
+		if (channels == 1)
+			memcpy(planes[0], source, n * sampleSize);
+		else if (channels == 2 && sampleSize == 2)
+			k.deinterleave2_16((const uint16_t*)source, (uint16_t*)planes[0], (uint16_t*)planes[1], n);
+		else if (channels == 2)
+			k.deinterleave2_32((const uint32_t*)source, (uint32_t*)planes[0], (uint32_t*)planes[1], n);
+		else if (sampleSize == 2)
+			DeinterleaveSamples((const uint16_t*)source, (uint16_t* const*)planes, n, channels);
+		else
+			DeinterleaveSamples((const uint32_t*)source, (uint32_t* const*)planes, n, channels);
+	}
+
+	//
+	// Convert audio format, layout and gain
+	//
+	// Each block of samples is converted to planar float,
+	// with the gain if the source is integer, and then to the dest.
+	// Planar float source is read directly.
+	//
+	bool ConvertAudio(const void* source, AudioFormat sourceFormat, bool bSourceInterleaved, int sourceStride,
+		void* dest, AudioFormat destFormat, bool bDestInterleaved, int destStride,
+		int samples, int channels, float gain, bool bDither)
+	{
+		if (!source || !dest || channels < 1 || channels > MaxAudioChannels)
+			return false;
+		if (samples <= 0)
+			return true;
+		if (sourceStride <= 0) sourceStride = samples;
+		if (destStride <= 0) destStride = samples;
+
+		const ImageKernels& k = Kernels();
+		const size_t srcSize = AudioSampleSize(sourceFormat);
+		const size_t dstSize = AudioSampleSize(destFormat);
+		const unsigned char* src = static_cast<const unsigned char*>(source);
+		unsigned char* dst = static_cast<unsigned char*>(dest);
+
+		float fblock[MaxAudioChannels][AudioBlock];
+		uint32_t iblock[MaxAudioChannels][AudioBlock]; // 16 or 32 bit samples
+		void* fplanes[MaxAudioChannels];
+		void* iplanes[MaxAudioChannels];
+		for (int c = 0; c < channels; c++) {
+			fplanes[c] = fblock[c];
+			iplanes[c] = iblock[c];
+		}
+
+		const bool bIntDest = (destFormat != AUDIO_FLOAT);
+		uint32_t dither[MaxAudioChannels][4];
+		if (bDither && bIntDest) {
+			const uint32_t seed = (AudioDitherCalls++) * 0x85EBCA6Bu;
+			for (int c = 0; c < channels; c++)
+				AudioDitherSeed(dither[c], seed + (uint32_t)c * 4);
+		}
+
+		for (int start = 0; start < samples; start += AudioBlock) {
+			const size_t n = (size_t)std::min(AudioBlock, samples - start);
+			const float* planar[MaxAudioChannels];
+			float g = gain;
+
+			// Source to planar float
+			if (sourceFormat == AUDIO_FLOAT && !bSourceInterleaved) {
+				for (int c = 0; c < channels; c++)
+					planar[c] = reinterpret_cast<const float*>(src + ((size_t)c * sourceStride + start) * srcSize);
+			}
+			else {
+				if (bSourceInterleaved) {
+					const unsigned char* s = src + (size_t)start * channels * srcSize;
+					DeinterleaveBlock(k, s, (sourceFormat == AUDIO_FLOAT) ? fplanes : iplanes, n, channels, srcSize);
+				}
+				for (int c = 0; c < channels; c++) {
+					planar[c] = fblock[c];
+					if (sourceFormat == AUDIO_FLOAT)
+						continue;
+					const void* s = bSourceInterleaved ? iblock[c]
+						: (const void*)(src + ((size_t)c * sourceStride + start) * srcSize);
+					if (sourceFormat == AUDIO_INT16)
+						k.audio_from_int16((const int16_t*)s, fblock[c], n, gain / AudioScale(sourceFormat));
+					else
+						k.audio_from_int32((const int32_t*)s, fblock[c], n, gain / AudioScale(sourceFormat));
+				}
+				if (sourceFormat != AUDIO_FLOAT)
+					g = 1.0f;
+			}
+
+			// Planar float to the dest
+			// Interleaved float without gain directly from the planar source
+			const bool bDirect = (bDestInterleaved && !bIntDest && g == 1.0f);
+			const float scale = g * AudioScale(destFormat);
+			for (int c = 0; c < channels && !bDirect; c++) {
+				void* d = bDestInterleaved ? (void*)((destFormat == AUDIO_FLOAT) ? fblock[c] : (float*)iblock[c])
+					: (void*)(dst + ((size_t)c * destStride + start) * dstSize);
+				uint32_t* state = (bDither && bIntDest) ? dither[c] : nullptr;
+				if (destFormat == AUDIO_INT16)
+					k.audio_to_int16(planar[c], (int16_t*)d, n, scale, state);
+				else if (destFormat == AUDIO_INT32)
+					k.audio_to_int32(planar[c], (int32_t*)d, n, scale, state);
+				else if (g != 1.0f)
+					k.audio_gain(planar[c], (float*)d, n, g);
+				else if (planar[c] != d)
+					memcpy(d, planar[c], n * sizeof(float));
+			}
+			if (bDestInterleaved) {
+				const void* planes[MaxAudioChannels];
+				for (int c = 0; c < channels; c++)
+					planes[c] = bIntDest ? iplanes[c] : bDirect ? (const void*)planar[c] : fplanes[c];
+				InterleaveBlock(k, planes, dst + (size_t)start * channels * dstSize, n, channels, dstSize);
+			}
+		}
+		return true;
+	}
+
+	// Planar float to interleaved float
+	bool InterleaveAudio(const float* source, float* dest, int samples, int channels, int sourceStride)
+	{
+		return ConvertAudio(source, AUDIO_FLOAT, false, sourceStride, dest, AUDIO_FLOAT, true, 0, samples, channels);
+	}
+
+	// Interleaved float to planar float
+	bool DeinterleaveAudio(const float* source, float* dest, int samples, int channels, int destStride)
+	{
+		return ConvertAudio(source, AUDIO_FLOAT, true, 0, dest, AUDIO_FLOAT, false, destStride, samples, channels);
+	}
+
+	// Multiply float samples in place
+	void AudioGain(float* data, size_t count, float gain)
+	{
+		if (data && gain != 1.0f)
+			Kernels().audio_gain(data, data, count, gain);
+	}
+
+	// -----------------------------------------------
+	// Class: AudioFifo
+	//
+	// m_Write and m_Read count samples per channel since Reset.
+	// Only the producer changes m_Write and only the consumer
+	// changes m_Read. Each publishes with a release store after
+	// copying samples, and loads the other with acquire.
+	//
+	AudioFifo::AudioFifo()
+	{
+		m_Channels = 0;
+		m_Capacity = 0;
+		m_Write = 0;
+		m_Read = 0;
+		m_Dropped = 0;
+	}
+
+	void AudioFifo::Allocate(int channels, int capacity)
+	{
+		if (channels < 1 || capacity < 1) {
+			m_Buffer.clear();
+			m_Channels = 0;
+			m_Capacity = 0;
+		}
+		else {
+			size_t size = 1;
+			while (size < (size_t)capacity)
+				size <<= 1;
+			m_Buffer.assign(size * (size_t)channels, 0.0f);
+			m_Channels = channels;
+			m_Capacity = size;
+		}
+		Reset();
+	}
+
+	void AudioFifo::Reset()
+	{
+		m_Write.store(0);
+		m_Read.store(0);
+		m_Dropped.store(0);
+	}
+
+	int AudioFifo::Push(const float* data, int samples, bool bInterleaved, int channelStride)
+	{
+		if (!data || samples <= 0 || m_Channels == 0)
+			return 0;
+
+		const uint64_t write = m_Write.load(std::memory_order_relaxed);
+		const uint64_t read = m_Read.load(std::memory_order_acquire);
+		const size_t space = m_Capacity - (size_t)(write - read);
+		const size_t n = std::min((size_t)samples, space);
+		if (n < (size_t)samples)
+			m_Dropped.fetch_add((uint64_t)samples - n, std::memory_order_relaxed);
+		if (n == 0)
+			return 0;
+
+		const size_t mask = m_Capacity - 1;
+		const size_t pos = (size_t)write & mask;
+		const size_t first = std::min(n, m_Capacity - pos); // Before the end of the ring
+		const size_t stride = channelStride > 0 ? (size_t)channelStride : (size_t)samples;
+		for (int c = 0; c < m_Channels; c++) {
+			float* ring = m_Buffer.data() + (size_t)c * m_Capacity;
+			if (bInterleaved) {
+				const float* src = data + c;
+				for (size_t i = 0; i < n; i++)
+					ring[(pos + i) & mask] = src[i * (size_t)m_Channels];
+			}
+			else {
+				const float* src = data + (size_t)c * stride;
+				memcpy(ring + pos, src, first * sizeof(float));
+				memcpy(ring, src + first, (n - first) * sizeof(float));
+			}
+		}
+		m_Write.store(write + n, std::memory_order_release);
+
+		return (int)n;
+	}
+
+	int AudioFifo::Pop(float* dest, int samples, int destStride)
+	{
+		if (samples <= 0 || m_Channels == 0)
+			return 0;
+
+		const uint64_t read = m_Read.load(std::memory_order_relaxed);
+		const uint64_t write = m_Write.load(std::memory_order_acquire);
+		const size_t n = std::min((size_t)samples, (size_t)(write - read));
+		if (n == 0)
+			return 0;
+
+		// Discard
+		if (!dest) {
+			m_Read.store(read + n, std::memory_order_release);
+			return (int)n;
+		}
+
+		const size_t mask = m_Capacity - 1;
+		const size_t pos = (size_t)read & mask;
+		const size_t first = std::min(n, m_Capacity - pos);
+		const size_t stride = destStride > 0 ? (size_t)destStride : (size_t)samples;
+		for (int c = 0; c < m_Channels; c++) {
+			const float* ring = m_Buffer.data() + (size_t)c * m_Capacity;
+			float* dst = dest + (size_t)c * stride;
+			memcpy(dst, ring + pos, first * sizeof(float));
+			memcpy(dst + first, ring, (n - first) * sizeof(float));
+		}
+		m_Read.store(read + n, std::memory_order_release);
+
+		return (int)n;
+	}
+
+	int AudioFifo::Available() const
+	{
+		// Read first so that write is never behind it
+		const uint64_t read = m_Read.load(std::memory_order_acquire);
+		const uint64_t write = m_Write.load(std::memory_order_acquire);
+		return (int)(write - read);
+	}
+
+	int AudioFifo::GetChannels() const
+	{
+		return m_Channels;
+	}
+
+	int AudioFifo::GetCapacity() const
+	{
+		return (int)m_Capacity;
+	}
+
+	uint64_t AudioFifo::GetDropped() const
+	{
+		return m_Dropped.load(std::memory_order_relaxed);
+	}
 
 } // end namespace
 
@@ -29,6 +29,30 @@
 	06.12.19 - Remove SSE functions for Linux
 	07.12.19 - remove includes emmintrin.h, xmmintrin.h, iostream, cstdint
 	16.09.24 - #define USE_CHRONO for OSX
+	15.10.26 - Enable SSE2 functions for Linux x86-64
+			   Add runtime CPU dispatch of SSE2, AVX2 and AVX-512 image functions
+			   Add worker threads for image functions (USE_THREADS)
+			   Add RGBA_to_YUV422 and YUVmatrix
+			   Add NV12_to_RGBA and I420_to_RGBA
+			   Add 16 bit P216 and PA16 conversions
+			   Add single pass CopyImage with pitch, bgra<>rgba and invert
+			   Add in place FlipVertical
+			   Add YUVcolorimetry with BT.2020 and full range
+			   Add ScaleImage and ScaleYUV422_to_RGBA
+			   Add CopyBuffer with cache size based non-temporal stores
+			   Add VerifyKernels
+			   Add NEON image functions for ARM (USE_NEON)
+			   #define USE_CHRONO for Linux
+			   Add FramePacer. HoldFps uses a FramePacer.
+			   Add stage timers (OFXNDI_TIMER) and GetStageTimings
+			   Add AlignedAlloc and AlignedFree
+	16.10.26 - Add AudioFifo
+			   YUV422_to_RGBA - add bInvert
+			   NEON functions only with ENABLE_NEON until verified on ARM
+			   Add FramesToTime
+			   Add ConvertAudio, InterleaveAudio, DeinterleaveAudio and AudioGain
+			   AudioFifo::Pop - discard samples for null dest
+			   Remove NEON functions, not built or verified on ARM
 
 
 */
@@ -42,6 +66,32 @@
 #include <string.h>
 #include <iostream> // for cout
 
+//
+// SIMD image functions
+//
+// x86/x64 : SSE2 is always available. AVX2 and AVX-512 versions are
+// compiled in as well and selected at runtime if the CPU supports them.
+// OSX arm64 : SSE2 functions are mapped to NEON by "sse2neon.h"
+// Other ARM platforms use the C++ functions.
+//
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__)
+#define USE_SSE2
+#define USE_AVX
+#elif defined(TARGET_OSX) && defined(__aarch64__)
+#define USE_SSE2
+#endif
+
+//
+// Multi-threaded image functions
+//
+// Large images are divided into horizontal stripes
+// and converted in parallel by a pool of worker threads.
+// Not available for single threaded platforms (emscripten).
+//
+#if !defined(TARGET_NO_THREADS) && !defined(__EMSCRIPTEN__)
+#define USE_THREADS
+#endif
+
 // TODO : test includes for OSX
 #if defined(TARGET_OSX)
 #define USE_CHRONO
@@ -54,7 +104,12 @@
 #include <windows.h>
 #include <intrin.h> // for _movsd
 #pragma comment (lib, "winmm.lib") // for timeBeginPeriod
-// #else // Linux
+#elif defined(TARGET_LINUX)
+#define USE_CHRONO
+#endif
+
+#if defined(USE_AVX)
+#include <immintrin.h> // SSE2, AVX2 and AVX-512 intrinsics
 #endif
 
 #include <cstring>
@@ -77,11 +132,78 @@
 #include <thread>
 #endif
 
+#include <vector>
+#include <atomic>
+
+//
+// Stage timing
+//
+// Named timers for the stages of sending and receiving.
+// Each scope records its duration in histograms of the calling thread.
+// See GetStageTimings for the results.
+// Define NO_STAGE_TIMING to remove the timers at compile time.
+//
+// OFXNDI_TIMER(var, "name") - time from here to the end of the scope
+// OFXNDI_TIMER_STOP(var)    - or stop before the end of the scope
+//
+#if defined(USE_CHRONO) && !defined(NO_STAGE_TIMING)
+#define USE_STAGE_TIMING
+#define OFXNDI_TIMER(var, name) \
+	static const int var##_stage = ofxNDIutils::RegisterStage(name); \
+	ofxNDIutils::StageTimer var(var##_stage)
+#define OFXNDI_TIMER_STOP(var) var.Stop()
+#else
+#define OFXNDI_TIMER(var, name)
+#define OFXNDI_TIMER_STOP(var)
+#endif
+
 namespace ofxNDIutils {
 
 	// ofxNDI version number
 	std::string GetVersion();
 
+	// Instruction sets for the image functions
+	enum SimdLevel {
+		SIMD_NONE = 0, // C++ only
+		SIMD_SSE2,
+		SIMD_AVX2,
+		SIMD_AVX512, // AVX-512 F and BW
+		SIMD_NEON
+	};
+
+	// Instruction set supported by this CPU
+	SimdLevel GetCpuSimdLevel();
+
+	// Instruction set currently used by the image functions
+	// Selected from the CPU when first used
+	SimdLevel GetSimdLevel();
+
+	// Set the instruction set used by the image functions
+	// Limited to the level supported by the CPU.
+	// SIMD_NONE uses C++ functions only.
+	void SetSimdLevel(SimdLevel level);
+
+	// Instruction set name
+	std::string GetSimdName(SimdLevel level);
+
+	// Set the number of threads used by the image functions
+	// including the calling thread.
+	// 0 - number of processors (maximum 4)
+	// 1 - single threaded
+	// Worker threads are created when first used.
+	void SetThreadCount(unsigned int nThreads = 0);
+
+	// Number of threads used by the image functions
+	unsigned int GetThreadCount();
+
+	// Set the minimum image size in pixels for multi-threaded conversion
+	// Smaller images are converted by the calling thread.
+	// Initialized 1920x1080
+	void SetThreadMinimum(unsigned int nPixels = 1920*1080);
+
+	// Minimum image size for multi-threaded conversion
+	unsigned int GetThreadMinimum();
+
 	// Copy rgba source image to dest.
 	// Images must be the same size with no line padding.
 	// Option flip image vertically (invert).
@@ -90,7 +212,7 @@ namespace ofxNDIutils {
 		bool bInvert = false);
 
 	// Copy rgba source image to dest.
-	// Source line pitch (unused).
+	// Source line pitch, dest has no line padding.
 	// Option convert bgra<>rgba.
 	// Option flip image vertically (invert).
 	void CopyImage(const unsigned char *source, unsigned char *dest,
@@ -105,8 +227,44 @@ namespace ofxNDIutils {
 		unsigned int sourcePitch, unsigned int destPitch,
 		bool bInvert = false);
 
-// TODO : check it works for OSX
-#if defined(TARGET_WIN32) || defined(TARGET_OSX)
+	// Copy rgba or bgra image buffers in a single pass.
+	// Allow for both source and destination line pitch.
+	// Option convert bgra<>rgba.
+	// Option flip image vertically (invert).
+	void CopyImage(const void* source, void* dest,
+		unsigned int width, unsigned int height,
+		unsigned int sourcePitch, unsigned int destPitch,
+		bool bSwapRB, bool bInvert);
+
+	// Copy memory of any size and alignment
+	// Non-temporal stores for sizes larger than the streaming threshold
+	void CopyBuffer(void* dst, const void* src, size_t size);
+
+	// Last level cache size in bytes detected at runtime
+	size_t GetCacheSize();
+
+	// Copy size in bytes for non-temporal stores
+	// Default 0 for the last level cache size
+	void SetStreamingThreshold(size_t bytes = 0);
+
+	// Current copy size for non-temporal stores
+	size_t GetStreamingThreshold();
+
+	// Prefetch distance in bytes for non-temporal copies
+	// Default 512, 0 for no prefetch
+	void SetPrefetchDistance(unsigned int bytes = 512);
+
+	// Current prefetch distance
+	unsigned int GetPrefetchDistance();
+
+	// Allocate memory aligned for SIMD loads and cache lines
+	// Alignment is a power of two. Returns nullptr on failure.
+	void* AlignedAlloc(size_t size, size_t alignment = 64);
+
+	// Free memory allocated by AlignedAlloc
+	void AlignedFree(void* ptr);
+
+#if defined(USE_SSE2)
 	void memcpy_sse2(void* dst, const void* src, size_t Size);
 	void memcpy_movsd(void* dst, const void* src, size_t Size);
 	void rgba_bgra_sse2(const void *source, void *dest, unsigned int width, unsigned int height, bool bInvert = false);
@@ -114,7 +272,206 @@ namespace ofxNDIutils {
 
 	void rgba_bgra(const void *rgba_source, void *bgra_dest, unsigned int width, unsigned int height, bool bInvert = false);
 	void FlipBuffer(const unsigned char *src, unsigned char *dst, unsigned int width, unsigned int height);
-	void YUV422_to_RGBA(const unsigned char * source, unsigned char * dest, unsigned int width, unsigned int height, unsigned int stride);
+
+	// Flip an image vertically in place
+	// - buffer | image data
+	// - lineBytes | bytes of each line to flip
+	// - height | number of lines
+	// - pitch | line pitch in bytes (0 for lineBytes)
+	bool FlipVertical(void* buffer, unsigned int lineBytes, unsigned int height, unsigned int pitch = 0);
+
+	// YUV colour matrix
+	// Auto selects BT.601 for SD (width < 1920) and BT.709 for HD
+	enum YUVmatrix {
+		YUV_MATRIX_AUTO = 0,
+		YUV_MATRIX_BT601,
+		YUV_MATRIX_BT709,
+		YUV_MATRIX_BT2020
+	};
+
+	// YUV range
+	// Limited : Y 16-235, U and V 16-240 (8 bit)
+	// Full : Y, U and V 0-255 (8 bit)
+	enum YUVrange {
+		YUV_RANGE_LIMITED = 0,
+		YUV_RANGE_FULL
+	};
+
+	// YUV colorimetry
+	// Matrix and range for YUV conversions.
+	// A YUVmatrix alone converts to limited range of that matrix.
+	struct YUVcolorimetry {
+		YUVmatrix matrix;
+		YUVrange range;
+		YUVcolorimetry(YUVmatrix m = YUV_MATRIX_AUTO, YUVrange r = YUV_RANGE_LIMITED)
+			: matrix(m), range(r) {}
+	};
+
+	// Convert YUV422 (UYVY) to RGBA
+	// - stride | source line pitch in bytes
+	// - bInvert | flip the image
+	void YUV422_to_RGBA(const unsigned char * source, unsigned char * dest, unsigned int width, unsigned int height, unsigned int stride,
+		YUVcolorimetry colorimetry = YUVcolorimetry(), bool bInvert = false);
+
+	// Convert NV12 (YUV 4:2:0) to RGBA
+	// - y  | Y plane
+	// - uv | interleaved UV plane, half width and height
+	// - yStride, uvStride | plane line pitch in bytes
+	// - bSwapRB | BGRA output
+	// - bInvert | flip the image
+	void NV12_to_RGBA(const unsigned char* y, const unsigned char* uv, unsigned char* dest,
+		unsigned int width, unsigned int height, unsigned int yStride, unsigned int uvStride,
+		bool bSwapRB = false, bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Convert I420 or YV12 (YUV 4:2:0) to RGBA
+	// - y | Y plane
+	// - u, v | U and V planes, half width and height
+	//   (YV12 has the V plane first)
+	// - yStride, uvStride | plane line pitch in bytes
+	// - bSwapRB | BGRA output
+	// - bInvert | flip the image
+	void I420_to_RGBA(const unsigned char* y, const unsigned char* u, const unsigned char* v, unsigned char* dest,
+		unsigned int width, unsigned int height, unsigned int yStride, unsigned int uvStride,
+		bool bSwapRB = false, bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Convert RGBA to YUV422 (UYVY)
+	// - dest  | YUV data, line pitch width*2
+	// - alpha | optional alpha plane for UYVA, line pitch width
+	//           (NULL for UYVY)
+	// - sourcePitch | source line pitch in bytes
+	// - bSwapRB | source is BGRA
+	// - bInvert | flip the image
+	void RGBA_to_YUV422(const unsigned char* source, unsigned char* dest, unsigned char* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch,
+		bool bSwapRB = false, bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Convert P216 or PA16 (16 bit YUV 4:2:2) to 16 bit RGBA
+	// - y  | Y plane
+	// - uv | interleaved UV plane, half width
+	// - alpha | alpha plane for PA16 (NULL for P216)
+	// - stride | line pitch of each plane in bytes
+	// - destPitch | dest line pitch in bytes
+	// - bInvert | flip the image
+	void P216_to_RGBA16(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha, uint16_t* dest,
+		unsigned int width, unsigned int height, unsigned int stride, unsigned int destPitch,
+		bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Convert P216 or PA16 to float RGBA (0-1)
+	// Arguments as for P216_to_RGBA16
+	void P216_to_RGBAF(const uint16_t* y, const uint16_t* uv, const uint16_t* alpha, float* dest,
+		unsigned int width, unsigned int height, unsigned int stride, unsigned int destPitch,
+		bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Convert 16 bit RGBA to P216 or PA16
+	// - y, uv | Y and UV planes
+	// - alpha | optional alpha plane for PA16 (NULL for P216)
+	// - sourcePitch | source line pitch in bytes
+	// - stride | line pitch of each plane in bytes
+	// - bInvert | flip the image
+	void RGBA16_to_P216(const uint16_t* source, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int stride,
+		bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Convert float RGBA (0-1) to P216 or PA16
+	// Arguments as for RGBA16_to_P216
+	void RGBAF_to_P216(const float* source, uint16_t* y, uint16_t* uv, uint16_t* alpha,
+		unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int stride,
+		bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// RGB to YUV coefficients for a shader
+	// identical to those used by RGBA_to_YUV422
+	// - coeffs | 3 rows of (r, g, b, offset) for Y, U and V
+	//            with RGB 0-1 and YUV 0-1
+	// - width | image width for YUV_MATRIX_AUTO
+	void GetRGBtoYUVshaderCoefficients(YUVcolorimetry colorimetry, unsigned int width, float coeffs[12]);
+
+	// Scale RGBA or BGRA to RGBA of a different size
+	// Box filter for exactly half or quarter size, otherwise bilinear
+	// - sourcePitch | source line pitch in bytes
+	// - destWidth, destHeight | dest size, line pitch destWidth*4
+	// - bSwapRB | source is BGRA
+	// - bInvert | flip the image
+	void ScaleImage(const unsigned char* source, unsigned char* dest,
+		unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+		unsigned int destWidth, unsigned int destHeight,
+		bool bSwapRB = false, bool bInvert = false);
+
+	// Scale YUV422 (UYVY) to RGBA of a different size
+	// Filters as for ScaleImage
+	// - stride | source line pitch in bytes
+	// - bSwapRB | BGRA output
+	void ScaleYUV422_to_RGBA(const unsigned char* source, unsigned char* dest,
+		unsigned int sourceWidth, unsigned int sourceHeight, unsigned int stride,
+		unsigned int destWidth, unsigned int destHeight,
+		bool bSwapRB = false, bool bInvert = false, YUVcolorimetry colorimetry = YUVcolorimetry());
+
+	// Expand 8 bit RGBA to 16 bit or float RGBA
+	// - destPitch | dest line pitch in bytes
+	void RGBA_to_RGBA16(const unsigned char* source, uint16_t* dest,
+		unsigned int width, unsigned int height, unsigned int destPitch);
+	void RGBA_to_RGBAF(const unsigned char* source, float* dest,
+		unsigned int width, unsigned int height, unsigned int destPitch);
+
+	// Verify that every instruction set supported by the CPU
+	// gives the same result as the C++ functions.
+	// Random and edge case images : odd widths, single lines,
+	// unaligned buffers and padded line pitch.
+	// Call before using the image functions from other threads.
+	// - bVerbose | print failures and a summary
+	// Returns false if any result differs
+	bool VerifyKernels(bool bVerbose = false);
+
+	//
+	// Audio sample conversion
+	//
+	// Float samples are -1 to 1, as for NDI planar float audio.
+	// Samples are converted in blocks that fit the first level cache.
+	// Two channel interleave and the sample formats use SSE2.
+	// More channels are interleaved from the cached block.
+	//
+
+	// Audio sample formats
+	enum AudioFormat {
+		AUDIO_FLOAT = 0, // 32 bit float
+		AUDIO_INT16,     // 16 bit signed integer
+		AUDIO_INT32      // 32 bit signed integer
+	};
+
+	// Maximum number of channels for ConvertAudio
+	const int MaxAudioChannels = 16;
+
+	// Convert format, layout and gain in one pass
+	// Integer samples are clamped to the integer range.
+	// - source | source samples
+	// - sourceFormat | AUDIO_FLOAT, AUDIO_INT16 or AUDIO_INT32
+	// - bSourceInterleaved | samples of all channels in turn
+	// - sourceStride | planar channel stride in samples (0 for samples)
+	// - dest, destFormat, bDestInterleaved, destStride | the same for the dest
+	// - samples | samples per channel
+	// - channels | 1 - MaxAudioChannels
+	// - gain | multiplier for the samples
+	// - bDither | triangular dither of 1 LSB for integer dest
+	// Source and dest must not overlap.
+	// Returns false for no buffer or an unsupported number of channels
+	bool ConvertAudio(const void* source, AudioFormat sourceFormat, bool bSourceInterleaved, int sourceStride,
+		void* dest, AudioFormat destFormat, bool bDestInterleaved, int destStride,
+		int samples, int channels, float gain = 1.0f, bool bDither = false);
+
+	// Planar float to interleaved float
+	// - sourceStride | channel stride in samples (0 for samples)
+	bool InterleaveAudio(const float* source, float* dest, int samples, int channels, int sourceStride = 0);
+
+	// Interleaved float to planar float
+	// - destStride | channel stride in samples (0 for samples)
+	bool DeinterleaveAudio(const float* source, float* dest, int samples, int channels, int destStride = 0);
+
+	// Multiply float samples in place
+	void AudioGain(float* data, size_t count, float gain);
+
+	// Time of a number of frames at N/D frames per second
+	// in 100ns units, as used for NDI timecodes.
+	// Exact for any number of frames without overflow.
+	int64_t FramesToTime(uint64_t frames, int rate_N, int rate_D);
 
 #ifdef USE_CHRONO
 
@@ -123,7 +480,75 @@ namespace ofxNDIutils {
 	// Stop timing and return microseconds elapsed.
 	// Code console output can be enabled for quick timing tests.
 	double EndTiming();
+
+	// Hold a frame rate for an application without frame rate control
+	// Must be called every frame. The pacer is shared by all callers,
+	// use a FramePacer for each sender or loop instead.
 	void HoldFps(int fps);
+
+	//
+	// Frame pacer
+	//
+	// Holds a frame rate of N/D frames per second, e.g. 60000/1001 for 59.94.
+	// Each frame has an absolute deadline counted from the first frame,
+	// so that time spent between calls does not accumulate as drift.
+	// The thread sleeps until shortly before the deadline and then
+	// yields until it is reached, for precision better than the sleep.
+	// If a deadline is missed by more than a frame, the schedule restarts
+	// instead of sending a burst of frames to catch up.
+	//
+	class FramePacer {
+
+	public:
+
+		// - rate_N | frame rate numerator
+		// - rate_D | frame rate denominator
+		FramePacer(int rate_N = 60000, int rate_D = 1000);
+
+		// Set frame rate
+		// The schedule restarts if the rate has changed
+		void SetRate(int rate_N, int rate_D);
+
+		// Get frame rate
+		void GetRate(int &rate_N, int &rate_D) const;
+
+		// Set the time before each deadline to yield instead of sleep
+		// - usec | microseconds
+		// Initialized 2000
+		void SetSpinTime(unsigned int usec = 2000);
+
+		// Get the spin time in microseconds
+		unsigned int GetSpinTime() const;
+
+		// Wait until the deadline of the next frame
+		// Call once for each frame. The first call starts the schedule.
+		// Returns false if the deadline had already passed.
+		bool Wait();
+
+		// Restart the schedule at the next call to Wait
+		void Reset();
+
+		// Number of frames paced
+		uint64_t GetFrameCount() const;
+
+		// Number of deadlines missed
+		uint64_t GetMissedCount() const;
+
+	private:
+
+		std::chrono::steady_clock::duration FrameTime(uint64_t frame) const;
+
+		int m_rate_N; // Frame rate numerator
+		int m_rate_D; // Frame rate denominator
+		unsigned int m_SpinTime; // Microseconds
+		bool m_bStarted; // Schedule started
+		std::chrono::steady_clock::time_point m_Start; // Time of frame 0 of the schedule
+		uint64_t m_Frame; // Frame number in the schedule
+		uint64_t m_Frames; // Frames paced
+		uint64_t m_Missed; // Deadlines missed
+
+	};
+
 #if defined(TARGET_WIN32)
 	// Windows minimum time period
 	void StartTimePeriod();
@@ -132,6 +557,132 @@ namespace ofxNDIutils {
 
 #endif
 
+	// Timing statistics of a stage in milliseconds
+	// Percentiles are within 6%
+	struct StageTiming {
+		std::string name;
+		uint64_t count; // Number of times recorded
+		double mean;
+		double p50; // Median
+		double p99;
+		double max;
+	};
+
+	// Snapshot of the timings of all stages and threads
+	// Stages that have not been recorded are not included.
+	// Empty if stage timing is not compiled (NO_STAGE_TIMING).
+	std::vector<StageTiming> GetStageTimings();
+
+	// Clear the timings of all stages
+	// Results recorded at the same time may be partly cleared.
+	void ResetStageTimings();
+
+#if defined(USE_STAGE_TIMING)
+
+	// Stage index for a name, the same for every call with the name
+	// Returns -1 if the maximum number of stages (32) is reached
+	int RegisterStage(const char* name);
+
+	// Record a duration for a stage from the calling thread
+	void RecordStage(int stage, uint64_t nsec);
+
+	// Records the time from construction to Stop or destruction
+	// Use OFXNDI_TIMER so that timers can be removed at compile time.
+	class StageTimer {
+
+	public:
+
+		explicit StageTimer(int stage)
+			: m_Stage(stage), m_Start(std::chrono::steady_clock::now()) {}
+
+		~StageTimer() { Stop(); }
+
+		// Record the time now. Later calls have no effect.
+		void Stop()
+		{
+			if (m_Stage >= 0) {
+				RecordStage(m_Stage, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - m_Start).count());
+				m_Stage = -1;
+			}
+		}
+
+	private:
+
+		StageTimer(const StageTimer&) = delete;
+		StageTimer& operator=(const StageTimer&) = delete;
+
+		int m_Stage;
+		std::chrono::steady_clock::time_point m_Start;
+
+	};
+
+#endif
+
+	//
+	// Audio FIFO
+	//
+	// Lock-free queue of float audio samples for one producer thread
+	// (e.g. an audio callback) and one consumer thread (the sender).
+	// Samples are stored planar, one ring per channel. Push never waits.
+	// Samples that do not fit are dropped and counted.
+	//
+	class AudioFifo {
+
+	public:
+
+		AudioFifo();
+
+		// Allocate for a number of channels and samples per channel
+		// Capacity is rounded up to a power of two.
+		// The FIFO is emptied. Not thread safe, call before use.
+		void Allocate(int channels, int capacity);
+
+		// Empty the FIFO
+		// Not thread safe, call while no samples are pushed or popped
+		void Reset();
+
+		// Push samples (producer thread)
+		// - data | planar or interleaved float samples
+		// - samples | samples per channel
+		// - bInterleaved | samples of all channels in turn
+		// - channelStride | planar channel stride in samples (0 for samples)
+		// Returns the number of samples pushed
+		int Push(const float* data, int samples, bool bInterleaved = false, int channelStride = 0);
+
+		// Pop samples (consumer thread)
+		// - dest | planar float samples, nullptr to discard the samples
+		// - samples | samples per channel
+		// - destStride | channel stride of dest in samples (0 for samples)
+		// Returns the number of samples popped, up to the number available
+		int Pop(float* dest, int samples, int destStride = 0);
+
+		// Samples per channel available to pop
+		int Available() const;
+
+		// Number of channels
+		int GetChannels() const;
+
+		// Samples per channel that can be held
+		int GetCapacity() const;
+
+		// Samples per channel dropped because the FIFO was full
+		uint64_t GetDropped() const;
+
+	private:
+
+		AudioFifo(const AudioFifo&) = delete;
+		AudioFifo& operator=(const AudioFifo&) = delete;
+
+		std::vector<float> m_Buffer; // Ring of each channel in turn
+		int m_Channels;
+		size_t m_Capacity; // Power of two
+		std::atomic<uint64_t> m_Write; // Samples pushed
+		std::atomic<uint64_t> m_Read; // Samples popped
+		std::atomic<uint64_t> m_Dropped;
+
+	};
+
 }
 
 
@@ -0,0 +1,140 @@
+/*
+	ofxNDI sender test
+
+	Checks of ofxNDIsend that need the NDI runtime but not Openframeworks.
+	The tally is set by the test, so results do not depend on receivers
+	on the network. See readme.md for the build.
+
+	- Leased buffers while the tally policy scales images
+	  On preview and on neither program nor preview, a leased frame
+	  is the size of the sender (GetWidth x GetHeight), not the scaled
+	  video frame, and is sent at that size.
+
+	Exit code 0 for pass, 1 for failure and 2 if not tested.
+
+	16.10.26 - Create file
+			 - Set the tally with ofxNDIsendTest instead of polling it
+
+*/
+#define OFXNDI_TEST
+#include "ofxNDIsend.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Access to the sender state for the tests
+class ofxNDIsendTest {
+
+public:
+
+	// Set the tally as if it had been polled.
+	// The next poll is after the last time, so the tally is kept.
+	static void SetTally(ofxNDIsend &sender, bool bOnProgram, bool bOnPreview)
+	{
+		sender.m_ConnectionPoll = INT64_MAX;
+		sender.m_bOnProgram = bOnProgram;
+		sender.m_bOnPreview = bOnPreview;
+	}
+
+	// Image size divisor applied by the tally policy
+	static unsigned int GetTallyScale(ofxNDIsend &sender)
+	{
+		return sender.m_TallyScale;
+	}
+
+	// Size of the video frame sent last
+	static void GetFrameSize(ofxNDIsend &sender, int &xres, int &yres)
+	{
+		xres = sender.video_frame.xres;
+		yres = sender.video_frame.yres;
+	}
+
+	// Size of a leased buffer, 0 if not leased
+	static size_t GetLeaseSize(ofxNDIsend &sender, const unsigned char* buffer)
+	{
+		const int index = sender.FindLease(buffer);
+		return (index < 0) ? 0 : sender.m_Leases[index].size;
+	}
+
+};
+
+// Lease, fill and send frames in between images scaled for the tally
+static int TestTallyLease(bool bOnPreview)
+{
+	const char* name = bOnPreview ? "TallyLease preview" : "TallyLease idle";
+	const unsigned int width = 640;
+	const unsigned int height = 360;
+	const unsigned int scale = bOnPreview ? 2 : 4;
+
+	ofxNDIsend sender;
+	sender.SetAsync(true);
+	if (!sender.CreateSender("ofxNDI lease test", width, height)) {
+		printf("%s : NDI runtime not available - not tested\n", name);
+		return 2;
+	}
+	sender.SetTallyPolicy(true, 2, 4, true);
+	ofxNDIsendTest::SetTally(sender, false, bOnPreview);
+
+	// Images are sent at reduced size
+	std::vector<unsigned char> pixels((size_t)width * height * 4, 128);
+	for (int i = 0; i < 8; i++)
+		sender.SendImage(pixels.data(), width, height, false, false);
+	if (ofxNDIsendTest::GetTallyScale(sender) != scale) {
+		printf("%s : FAIL - image scale %u, expected %u\n", name,
+			ofxNDIsendTest::GetTallyScale(sender), scale);
+		return 1;
+	}
+
+	// Some leased frames follow a scaled frame
+	// and some follow a frame skipped by the tally policy
+	const size_t size = (size_t)sender.GetWidth() * sender.GetHeight() * 4;
+	for (int i = 0; i < 16; i++) {
+		unsigned char* buffer = sender.LeaseFrame();
+		if (!buffer) {
+			printf("%s : FAIL - no buffer at frame %d\n", name, i);
+			return 1;
+		}
+		if (ofxNDIsendTest::GetLeaseSize(sender, buffer) < size) {
+			printf("%s : FAIL - leased %u bytes for %u at frame %d\n", name,
+				(unsigned int)ofxNDIsendTest::GetLeaseSize(sender, buffer), (unsigned int)size, i);
+			return 1;
+		}
+		memset(buffer, i, size);
+		if (!sender.SendLeasedFrame(buffer)) {
+			printf("%s : FAIL - leased frame %d not sent\n", name, i);
+			return 1;
+		}
+		int xres = 0;
+		int yres = 0;
+		ofxNDIsendTest::GetFrameSize(sender, xres, yres);
+		if (xres != (int)sender.GetWidth() || yres != (int)sender.GetHeight()) {
+			printf("%s : FAIL - leased frame %d sent at %dx%d\n", name, i, xres, yres);
+			return 1;
+		}
+		sender.SendImage(pixels.data(), width, height, false, false);
+	}
+
+	sender.ReleaseSender();
+	printf("%s : PASS\n", name);
+	return 0;
+}
+
+int main()
+{
+	int passed = 0;
+	int failed = 0;
+	const bool bPreview[2] = { true, false };
+	for (int i = 0; i < 2; i++) {
+		const int result = TestTallyLease(bPreview[i]);
+		if (result == 2)
+			return 2;
+		if (result == 0)
+			passed++;
+		else
+			failed++;
+	}
+	printf("%d passed, %d failed\n", passed, failed);
+	return (failed > 0) ? 1 : 0;
+}